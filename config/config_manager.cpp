@@ -2,13 +2,23 @@
 #include "utils/logging.h"
 #include <iostream>
 #include <filesystem>
+#include <algorithm>
+
+static const int kDefaultSegmentCount = 4;
+static const int kMaxSegmentCount = 16;
+static const int kDefaultRetryCount = 2;
+static const int kMaxRetryCount = 5;
+static const int kDefaultRetryBaseDelayMs = 1000;
+static const int kDefaultRetryMaxDelayMs = 15000;
+static const int kDefaultDownloadWorkers = 4;
+static const int kMaxDownloadWorkers = 8;
 
 ConfigManager& ConfigManager::Instance() {
     static ConfigManager instance;
     return instance;
 }
 
-ConfigManager::ConfigManager() : m_autoOpen(true), m_mirrorIndex(0), m_metadataMirrorIndex(0), m_clipboardEnabled(true) {
+ConfigManager::ConfigManager() : m_autoOpen(true), m_mirrorIndex(0), m_metadataMirrorIndex(0), m_clipboardEnabled(true), m_memoryMappedOutput(false), m_hedgedDownloads(true), m_globalLimitKBps(0), m_backgroundLimitKBps(0), m_retryCount(kDefaultRetryCount), m_retryBaseDelayMs(kDefaultRetryBaseDelayMs), m_retryMaxDelayMs(kDefaultRetryMaxDelayMs), m_downloadWorkers(kDefaultDownloadWorkers) {
     // Set config path to be next to the DLL
     wchar_t dllPath[MAX_PATH];
     GetModuleFileNameW(GetModuleHandle(NULL), dllPath, MAX_PATH);
@@ -40,6 +50,24 @@ bool ConfigManager::LoadConfig() {
     // Load Clipboard Enabled
     m_clipboardEnabled = GetPrivateProfileIntW(L"General", L"ClipboardEnabled", 1, m_configPath.c_str()) != 0;
 
+    // Load Memory Mapped Output
+    m_memoryMappedOutput = GetPrivateProfileIntW(L"General", L"MemoryMappedOutput", 0, m_configPath.c_str()) != 0;
+
+    // Load Hedged Downloads
+    m_hedgedDownloads = GetPrivateProfileIntW(L"General", L"HedgedDownloads", 1, m_configPath.c_str()) != 0;
+
+    // Load Bandwidth Limits
+    m_globalLimitKBps = (std::max)(0, (int)GetPrivateProfileIntW(L"Bandwidth", L"GlobalLimitKBps", 0, m_configPath.c_str()));
+    m_backgroundLimitKBps = (std::max)(0, (int)GetPrivateProfileIntW(L"Bandwidth", L"BackgroundLimitKBps", 0, m_configPath.c_str()));
+
+    // Load Retry Policy
+    m_retryCount = (std::max)(0, (std::min)((int)GetPrivateProfileIntW(L"Retry", L"Retries", kDefaultRetryCount, m_configPath.c_str()), kMaxRetryCount));
+    m_retryBaseDelayMs = (std::max)(0, (int)GetPrivateProfileIntW(L"Retry", L"BaseDelayMs", kDefaultRetryBaseDelayMs, m_configPath.c_str()));
+    m_retryMaxDelayMs = (std::max)(m_retryBaseDelayMs, (int)GetPrivateProfileIntW(L"Retry", L"MaxDelayMs", kDefaultRetryMaxDelayMs, m_configPath.c_str()));
+
+    // Load Queue
+    m_downloadWorkers = (std::max)(1, (std::min)((int)GetPrivateProfileIntW(L"Queue", L"Workers", kDefaultDownloadWorkers, m_configPath.c_str()), kMaxDownloadWorkers));
+
     LogInfo("Config loaded.");
     return true;
 }
@@ -51,6 +79,19 @@ void ConfigManager::SaveConfig() {
     WritePrivateProfileStringW(L"General", L"AutoOpen", m_autoOpen ? L"1" : L"0", m_configPath.c_str());
 
     WritePrivateProfileStringW(L"General", L"ClipboardEnabled", m_clipboardEnabled ? L"1" : L"0", m_configPath.c_str());
+
+    WritePrivateProfileStringW(L"General", L"MemoryMappedOutput", m_memoryMappedOutput ? L"1" : L"0", m_configPath.c_str());
+
+    WritePrivateProfileStringW(L"General", L"HedgedDownloads", m_hedgedDownloads ? L"1" : L"0", m_configPath.c_str());
+
+    WritePrivateProfileStringW(L"Bandwidth", L"GlobalLimitKBps", std::to_wstring(m_globalLimitKBps).c_str(), m_configPath.c_str());
+    WritePrivateProfileStringW(L"Bandwidth", L"BackgroundLimitKBps", std::to_wstring(m_backgroundLimitKBps).c_str(), m_configPath.c_str());
+
+    WritePrivateProfileStringW(L"Retry", L"Retries", std::to_wstring(m_retryCount).c_str(), m_configPath.c_str());
+    WritePrivateProfileStringW(L"Retry", L"BaseDelayMs", std::to_wstring(m_retryBaseDelayMs).c_str(), m_configPath.c_str());
+    WritePrivateProfileStringW(L"Retry", L"MaxDelayMs", std::to_wstring(m_retryMaxDelayMs).c_str(), m_configPath.c_str());
+
+    WritePrivateProfileStringW(L"Queue", L"Workers", std::to_wstring(m_downloadWorkers).c_str(), m_configPath.c_str());
     
     LogInfo("Config saved");
 }
@@ -73,6 +114,56 @@ bool ConfigManager::IsClipboardEnabled() const {
     return m_clipboardEnabled;
 }
 
+bool ConfigManager::GetMemoryMappedOutput() const {
+    return m_memoryMappedOutput;
+}
+
+std::wstring ConfigManager::GetConfigDirectory() const {
+    return m_configPath.substr(0, m_configPath.find_last_of(L"\\/"));
+}
+
+bool ConfigManager::GetHedgedDownloads() const {
+    return m_hedgedDownloads;
+}
+
+int ConfigManager::GetGlobalLimitKBps() const {
+    return m_globalLimitKBps;
+}
+
+int ConfigManager::GetBackgroundLimitKBps() const {
+    return m_backgroundLimitKBps;
+}
+
+int ConfigManager::GetRetryCount() const {
+    return m_retryCount;
+}
+
+int ConfigManager::GetRetryBaseDelayMs() const {
+    return m_retryBaseDelayMs;
+}
+
+int ConfigManager::GetRetryMaxDelayMs() const {
+    return m_retryMaxDelayMs;
+}
+
+int ConfigManager::GetDownloadWorkers() const {
+    return m_downloadWorkers;
+}
+
+int ConfigManager::GetSegmentCount(const std::string& providerName) {
+    std::lock_guard<std::mutex> lock(m_segmentMutex);
+    auto it = m_segmentCounts.find(providerName);
+    if (it != m_segmentCounts.end()) {
+        return it->second;
+    }
+
+    std::wstring key(providerName.begin(), providerName.end());
+    int segments = GetPrivateProfileIntW(L"Segments", key.c_str(), kDefaultSegmentCount, m_configPath.c_str());
+    segments = (std::max)(1, (std::min)(segments, kMaxSegmentCount));
+    m_segmentCounts[providerName] = segments;
+    return segments;
+}
+
 
 
 void ConfigManager::SetDownloadMirrorIndex(int index) {
@@ -94,3 +185,35 @@ void ConfigManager::SetClipboardEnabled(bool enabled) {
     m_clipboardEnabled = enabled;
     SaveConfig();
 }
+
+void ConfigManager::SetMemoryMappedOutput(bool enabled) {
+    m_memoryMappedOutput = enabled;
+    SaveConfig();
+}
+
+void ConfigManager::SetHedgedDownloads(bool enabled) {
+    m_hedgedDownloads = enabled;
+    SaveConfig();
+}
+
+void ConfigManager::SetBandwidthLimits(int globalKBps, int backgroundKBps) {
+    m_globalLimitKBps = (std::max)(0, globalKBps);
+    m_backgroundLimitKBps = (std::max)(0, backgroundKBps);
+    SaveConfig();
+}
+
+void ConfigManager::SetRetryCount(int retries) {
+    m_retryCount = (std::max)(0, (std::min)(retries, kMaxRetryCount));
+    SaveConfig();
+}
+
+void ConfigManager::SetSegmentCount(const std::string& providerName, int segments) {
+    segments = (std::max)(1, (std::min)(segments, kMaxSegmentCount));
+    {
+        std::lock_guard<std::mutex> lock(m_segmentMutex);
+        m_segmentCounts[providerName] = segments;
+    }
+
+    std::wstring key(providerName.begin(), providerName.end());
+    WritePrivateProfileStringW(L"Segments", key.c_str(), std::to_wstring(segments).c_str(), m_configPath.c_str());
+}
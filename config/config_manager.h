@@ -1,5 +1,7 @@
 #pragma once
 #include <string>
+#include <map>
+#include <mutex>
 #include <windows.h>
 
 class ConfigManager {
@@ -13,11 +15,33 @@ public:
     int GetMetadataMirrorIndex() const;
     bool GetAutoOpen() const;
     bool IsClipboardEnabled() const;
+    // Write downloads through a memory-mapped view instead of WriteFile
+    bool GetMemoryMappedOutput() const;
+    // Race a second mirror when the selected one is slow to start or slow to download
+    bool GetHedgedDownloads() const;
+    // Bandwidth caps in KB/s, 0 = unlimited. Background applies to downloads only.
+    int GetGlobalLimitKBps() const;
+    int GetBackgroundLimitKBps() const;
+    // Extra passes over the mirrors that failed transiently, and the backoff before each
+    int GetRetryCount() const;
+    int GetRetryBaseDelayMs() const;
+    int GetRetryMaxDelayMs() const;
+    // Downloads the queue runs at once, across all mirrors
+    int GetDownloadWorkers() const;
+    // Parallel Range connections used for one download from the given provider
+    int GetSegmentCount(const std::string& providerName);
+    // Folder holding config.ini, for other files that live next to it
+    std::wstring GetConfigDirectory() const;
 
     void SetDownloadMirrorIndex(int index);
     void SetMetadataMirrorIndex(int index);
     void SetAutoOpen(bool autoOpen);
     void SetClipboardEnabled(bool enabled);
+    void SetMemoryMappedOutput(bool enabled);
+    void SetHedgedDownloads(bool enabled);
+    void SetBandwidthLimits(int globalKBps, int backgroundKBps);
+    void SetRetryCount(int retries);
+    void SetSegmentCount(const std::string& providerName, int segments);
 
 private:
     ConfigManager();
@@ -31,6 +55,17 @@ private:
     int m_metadataMirrorIndex;
     bool m_autoOpen;
     bool m_clipboardEnabled;
+    bool m_memoryMappedOutput;
+    bool m_hedgedDownloads;
+    int m_globalLimitKBps;
+    int m_backgroundLimitKBps;
+    int m_retryCount;
+    int m_retryBaseDelayMs;
+    int m_retryMaxDelayMs;
+    int m_downloadWorkers;
 
+    // Per-provider values from the [Segments] section, read on first use
+    std::map<std::string, int> m_segmentCounts;
+    std::mutex m_segmentMutex;
 
 };
@@ -0,0 +1,227 @@
+#include "BulkImport.h"
+#include "download_manager.h"
+#include "download_queue.h"
+#include "config/config_manager.h"
+#include "utils/logging.h"
+#include <nlohmann/json.hpp>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <unordered_set>
+
+// How many of the import's items the queue holds at once, per transfer slot.
+// Enough to keep every stage busy with a few to spare; the rest of the list waits here.
+static const size_t kWindowPerWorker = 3;
+
+// Digits right after marker in token, e.g. "beatmapsets/" in a link
+static bool IdAfter(const std::string& token, const char* marker, uint32_t& id) {
+    size_t pos = token.find(marker);
+    if (pos == std::string::npos) return false;
+    pos += strlen(marker);
+    size_t end = pos;
+    while (end < token.size() && isdigit((unsigned char)token[end])) end++;
+    if (end == pos || end - pos > 9) return false;
+    id = (uint32_t)std::stoul(token.substr(pos, end - pos));
+    return id != 0;
+}
+
+static void ParseToken(const std::string& token, std::vector<BulkImport::Item>& items) {
+    uint32_t id = 0;
+    // Set links first: "beatmapsets/1#osu/2" names the set, not the beatmap
+    if (IdAfter(token, "beatmapsets/", id) || IdAfter(token, "/s/", id) || IdAfter(token, "osu://dl/", id)) {
+        items.push_back({ id, false });
+    } else if (IdAfter(token, "beatmaps/", id) || IdAfter(token, "/b/", id)) {
+        items.push_back({ id, true });
+    } else if (token.size() <= 9 && token.find_first_not_of("0123456789") == std::string::npos) {
+        id = (uint32_t)std::stoul(token);
+        if (id != 0) items.push_back({ id, false });
+    }
+}
+
+static void ParseJson(const nlohmann::json& node, bool isBeatmapId, std::vector<BulkImport::Item>& items) {
+    if (node.is_number_integer()) {
+        int64_t id = node.get<int64_t>();
+        if (id > 0 && id <= 0xFFFFFFFFLL) items.push_back({ (uint32_t)id, isBeatmapId });
+    } else if (node.is_string()) {
+        ParseToken(node.get<std::string>(), items);
+    } else if (node.is_array()) {
+        for (const auto& child : node) ParseJson(child, isBeatmapId, items);
+    } else if (node.is_object()) {
+        // A known field names the item; otherwise the object is a wrapper, e.g. {"sets": [...]}
+        for (const char* key : { "beatmapset_id", "set_id", "beatmapsetId", "setId" }) {
+            if (node.contains(key)) return ParseJson(node[key], false, items);
+        }
+        for (const char* key : { "beatmap_id", "beatmapId" }) {
+            if (node.contains(key)) return ParseJson(node[key], true, items);
+        }
+        if (node.contains("id")) return ParseJson(node["id"], isBeatmapId, items);
+        for (const auto& child : node) ParseJson(child, isBeatmapId, items);
+    }
+}
+
+void BulkImport::Parse(const std::string& text, std::vector<Item>& items) {
+    size_t start = text.find_first_not_of(" \t\r\n");
+    if (start != std::string::npos && (text[start] == '[' || text[start] == '{')) {
+        try {
+            ParseJson(nlohmann::json::parse(text), false, items);
+            return;
+        } catch (const std::exception& e) {
+            LogWarning(std::string("Import list is not valid JSON, reading it as text: ") + e.what());
+        }
+    }
+
+    std::string token;
+    for (size_t i = 0; i <= text.size(); ++i) {
+        char c = i < text.size() ? text[i] : ' ';
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == ',' || c == ';' || c == '"') {
+            if (!token.empty()) ParseToken(token, items);
+            token.clear();
+        } else {
+            token += c;
+        }
+    }
+}
+
+bool BulkImport::StartFromFile(const std::wstring& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_stats.running) m_stats.error = "Could not open the file";
+        return false;
+    }
+    std::stringstream contents;
+    contents << in.rdbuf();
+    std::string text = contents.str();
+    if (text.compare(0, 3, "\xEF\xBB\xBF") == 0) text.erase(0, 3);
+    return StartFromText(text);
+}
+
+bool BulkImport::StartFromText(const std::string& text) {
+    std::vector<Item> parsed;
+    Parse(text, parsed);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_stats.running) return false;
+    if (m_thread.joinable()) m_thread.join();
+
+    m_stats = BulkImportStats();
+    m_items.clear();
+    std::unordered_set<uint64_t> seen;
+    seen.reserve(parsed.size());
+    for (const Item& item : parsed) {
+        if (!seen.insert(((uint64_t)item.id << 1) | (item.isBeatmapId ? 1 : 0)).second) {
+            m_stats.duplicates++;
+        } else if (IsInOsuDatabase((int)item.id, item.isBeatmapId)) {
+            m_stats.alreadyInstalled++;
+        } else {
+            m_items.push_back(item);
+        }
+    }
+    m_stats.total = seen.size();
+
+    if (m_items.empty()) {
+        m_stats.error = parsed.empty() ? "No beatmap IDs found" : "Everything in the list is already installed";
+        LogInfo("Bulk import: " + m_stats.error);
+        return false;
+    }
+    LogInfo("Bulk import of " + std::to_string(m_items.size()) + " sets (" + std::to_string(m_stats.alreadyInstalled) +
+            " already installed, " + std::to_string(m_stats.duplicates) + " duplicates)");
+
+    m_next = 0;
+    m_inQueue = 0;
+    m_tickets.clear();
+    m_stop = false;
+    m_stats.running = true;
+    m_startedAt = Clock::now();
+    m_thread = std::thread(&BulkImport::FeederThread, this, ++m_generation);
+    return true;
+}
+
+void BulkImport::FeederThread(uint64_t generation) {
+    const size_t window = (size_t)ConfigManager::Instance().GetDownloadWorkers() * kWindowPerWorker;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        // Backpressure: the next item waits until one of ours leaves the queue
+        m_cv.wait(lock, [&] {
+            if (m_stop) return true;
+            return m_next < m_items.size() ? m_inQueue < window : m_inQueue == 0;
+        });
+        if (m_stop || m_next >= m_items.size()) break;
+
+        Item item = m_items[m_next++];
+        m_inQueue++;
+        lock.unlock();
+        uint64_t ticket = DownloadQueue::Instance().Push(std::to_wstring(item.id), item.isBeatmapId, L"", L"",
+                                                         DownloadPriority::Background,
+                                                         [this, generation](bool success) { OnFinished(generation, success); });
+        lock.lock();
+        m_tickets.push_back(ticket);
+    }
+
+    if (!m_stop) {
+        LogInfo("Bulk import finished: " + std::to_string(m_stats.succeeded) + " downloaded, " +
+                std::to_string(m_stats.failed) + " failed");
+    }
+    m_stats.running = false;
+    // The list is done with; don't hold on to it until the next import
+    std::vector<Item>().swap(m_items);
+    m_next = 0;
+}
+
+void BulkImport::OnFinished(uint64_t generation, bool success) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (generation != m_generation) return;
+        if (m_inQueue > 0) m_inQueue--;
+        if (success) m_stats.succeeded++;
+        else m_stats.failed++;
+    }
+    m_cv.notify_all();
+}
+
+void BulkImport::Cancel() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_stats.running) return;
+        m_stop = true;
+        m_stats.cancelled = true;
+        // Results of the downloads cancelled below no longer count
+        m_generation++;
+        m_inQueue = 0;
+    }
+    m_cv.notify_all();
+    if (m_thread.joinable()) m_thread.join();
+
+    std::vector<uint64_t> tickets;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        tickets.swap(m_tickets);
+    }
+    LogInfo("Bulk import cancelled");
+    for (uint64_t ticket : tickets) DownloadQueue::Instance().Cancel(ticket);
+}
+
+void BulkImport::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    if (m_thread.joinable()) m_thread.join();
+}
+
+BulkImportStats BulkImport::GetStats() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    BulkImportStats stats = m_stats;
+    stats.waiting = m_items.size() - m_next;
+    stats.inQueue = m_inQueue;
+    size_t finished = stats.succeeded + stats.failed;
+    if (stats.running && finished > 0) {
+        // The import's own pace so far: it covers resolving, metadata and the transfer alike
+        double seconds = std::chrono::duration<double>(Clock::now() - m_startedAt).count();
+        stats.etaSeconds = (stats.waiting + stats.inQueue) * seconds / finished;
+    }
+    return stats;
+}
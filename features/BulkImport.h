@@ -0,0 +1,76 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct BulkImportStats {
+    bool running = false;
+    size_t total = 0;             // Unique IDs in the list
+    size_t alreadyInstalled = 0;  // Filtered out against osu!.db
+    size_t duplicates = 0;
+    size_t waiting = 0;           // Not handed to the queue yet
+    size_t inQueue = 0;           // Queued or downloading
+    size_t succeeded = 0;
+    size_t failed = 0;
+    bool cancelled = false;
+    double etaSeconds = -1;       // -1 until the first download finishes
+    std::string error;            // Why the last import didn't start
+};
+
+// Imports a long list of beatmap sets (a mappool, a fresh install) without
+// flooding the queue. The list is parsed, deduplicated and checked against
+// osu!.db up front, then a feeder thread keeps a bounded window of it in the
+// download queue as background work and tops it up as downloads finish. The
+// list itself is 8 bytes per ID, so even 10k IDs cost next to nothing.
+class BulkImport {
+public:
+    static BulkImport& Instance() {
+        static BulkImport instance;
+        return instance;
+    }
+
+    // Set IDs, beatmap IDs and links in any mix of separators, or JSON: an array of
+    // IDs, or objects with beatmapset_id / set_id / beatmap_id / id fields.
+    // False if an import is already running or nothing usable was found.
+    bool StartFromText(const std::string& text);
+    bool StartFromFile(const std::wstring& path);
+    // Stops feeding the queue and cancels the imported downloads still in it
+    void Cancel();
+    // Shutdown: stops feeding; what is already queued stays in the queue journal
+    void Stop();
+
+    BulkImportStats GetStats();
+
+    struct Item {
+        uint32_t id;
+        bool isBeatmapId;
+    };
+
+private:
+    BulkImport() = default;
+    ~BulkImport() { Stop(); }
+    BulkImport(const BulkImport&) = delete;
+    BulkImport& operator=(const BulkImport&) = delete;
+
+    static void Parse(const std::string& text, std::vector<Item>& items);
+    void FeederThread(uint64_t generation);
+    void OnFinished(uint64_t generation, bool success);
+
+    using Clock = std::chrono::steady_clock;
+
+    std::vector<Item> m_items;
+    size_t m_next = 0;                  // First item not handed to the queue yet
+    size_t m_inQueue = 0;
+    std::vector<uint64_t> m_tickets;    // Queue tickets of this import, for Cancel
+    BulkImportStats m_stats;
+    Clock::time_point m_startedAt;
+    uint64_t m_generation = 0;          // Callbacks from an earlier import are ignored
+    bool m_stop = false;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::thread m_thread;
+};
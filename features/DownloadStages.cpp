@@ -0,0 +1,113 @@
+#include "DownloadStages.h"
+#include <algorithm>
+
+// Starting limits; Transfer follows the queue's worker setting (see DownloadQueue::Start).
+// osu! imports one file at a time anyway.
+static const int kDefaultLimits[kPipelineStageCount] = { 4, 4, 4, 1 };
+// Throughput is counted over this window
+static const std::chrono::seconds kThroughputWindow(60);
+// Weight of the newest timing sample
+static const double kSmoothing = 0.2;
+
+static const std::chrono::milliseconds kPollInterval(100);
+
+const char* PipelineStageName(PipelineStage stage) {
+    switch (stage) {
+        case PipelineStage::Resolve: return "Resolve";
+        case PipelineStage::Metadata: return "Metadata";
+        case PipelineStage::Transfer: return "Transfer";
+        case PipelineStage::Import: return "Import";
+    }
+    return "";
+}
+
+DownloadStages::DownloadStages() {
+    for (int i = 0; i < kPipelineStageCount; ++i) m_stages[i].limit = kDefaultLimits[i];
+}
+
+void DownloadStages::Smooth(double& average, double sample) {
+    average = average > 0 ? average + kSmoothing * (sample - average) : sample;
+}
+
+void DownloadStages::SetLimit(PipelineStage stage, int limit) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stages[(int)stage].limit = (std::max)(1, limit);
+    }
+    m_cv.notify_all();
+}
+
+bool DownloadStages::Enter(PipelineStage stage, const StageRank& rank, const network::CancelTokenPtr& cancel,
+                           const std::function<void()>& onWait) {
+    auto queuedAt = Clock::now();
+    std::unique_lock<std::mutex> lock(m_mutex);
+    Stage& state = m_stages[(int)stage];
+    if (state.waiters.empty() && state.active < state.limit) {
+        state.active++;
+        Smooth(state.waitSeconds, 0);
+        return true;
+    }
+
+    Waiter waiter(rank.tier, rank.due, ++m_nextWaiter);
+    state.waiters.insert(waiter);
+    if (onWait) {
+        lock.unlock();
+        onWait();
+        lock.lock();
+    }
+    // Polled so a cancelled token is noticed without a wakeup from Leave
+    // A better-ranked waiter arriving meanwhile goes first
+    while (!(*state.waiters.begin() == waiter && state.active < state.limit)) {
+        if (cancel && cancel->IsCancelled()) {
+            state.waiters.erase(waiter);
+            lock.unlock();
+            // The next in line may be able to go now
+            m_cv.notify_all();
+            return false;
+        }
+        m_cv.wait_for(lock, kPollInterval);
+    }
+    state.waiters.erase(state.waiters.begin());
+    state.active++;
+    Smooth(state.waitSeconds, std::chrono::duration<double>(Clock::now() - queuedAt).count());
+    lock.unlock();
+    // A limit above one may let the next waiter in too
+    m_cv.notify_all();
+    return true;
+}
+
+void DownloadStages::Leave(PipelineStage stage, Clock::time_point enteredAt) {
+    auto now = Clock::now();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Stage& state = m_stages[(int)stage];
+        if (state.active > 0) state.active--;
+        state.completed++;
+        state.recent.push_back(now);
+        while (now - state.recent.front() > kThroughputWindow) state.recent.pop_front();
+        Smooth(state.serviceSeconds, std::chrono::duration<double>(now - enteredAt).count());
+    }
+    m_cv.notify_all();
+}
+
+std::vector<StageStats> DownloadStages::GetStats() {
+    auto now = Clock::now();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<StageStats> stats;
+    for (int i = 0; i < kPipelineStageCount; ++i) {
+        Stage& state = m_stages[i];
+        while (!state.recent.empty() && now - state.recent.front() > kThroughputWindow) state.recent.pop_front();
+
+        StageStats entry;
+        entry.stage = (PipelineStage)i;
+        entry.active = state.active;
+        entry.limit = state.limit;
+        entry.waiting = (int)state.waiters.size();
+        entry.completed = state.completed;
+        entry.perMinute = (double)state.recent.size() * 60.0 / kThroughputWindow.count();
+        entry.serviceSeconds = state.serviceSeconds;
+        entry.waitSeconds = state.waitSeconds;
+        stats.push_back(entry);
+    }
+    return stats;
+}
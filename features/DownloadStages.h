@@ -0,0 +1,120 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <tuple>
+#include <vector>
+#include "network/CancellationToken.h"
+
+// The steps every download goes through, in order
+enum class PipelineStage {
+    Resolve,   // Beatmap ID -> set ID on osu.ppy.sh
+    Metadata,  // Artist and title from the metadata mirror
+    Transfer,  // The archive itself, checked by the transport before it is moved into place
+    Import     // Handing it to osu!
+};
+static const int kPipelineStageCount = 4;
+
+const char* PipelineStageName(PipelineStage stage);
+
+// Where a download stands in every stage's queue, lowest first. Queued items
+// carry the download queue's own rank (see DownloadQueue::MakeKey), so an
+// interactive click goes ahead of batch work that got to the stage earlier.
+struct StageRank {
+    int tier;                                   // 0 for interactive
+    std::chrono::steady_clock::time_point due;  // Ties within a tier go by this
+
+    // Ranks like an overlay request made right now; for downloads started outside the queue
+    static StageRank Now() { return { 1, std::chrono::steady_clock::now() }; }
+};
+
+struct StageStats {
+    PipelineStage stage = PipelineStage::Resolve;
+    int active = 0;
+    int limit = 0;
+    int waiting = 0;
+    uint64_t completed = 0;
+    double perMinute = 0;       // Items that left the stage in the last minute
+    double serviceSeconds = 0;  // Smoothed time an item spends in the stage
+    double waitSeconds = 0;     // Smoothed time an item waits to get in
+};
+
+// Each stage of a download has its own concurrency limit and queue, so
+// the stages of different downloads overlap: while one item transfers, the
+// next ones resolve and fetch metadata instead of waiting behind it. The
+// download queue runs more workers than there are transfer slots to feed the
+// early stages; an item holds a slot only for the stage it is in.
+class DownloadStages {
+public:
+    static DownloadStages& Instance() {
+        static DownloadStages instance;
+        return instance;
+    }
+
+    void SetLimit(PipelineStage stage, int limit);
+
+    // Waits in the stage's queue for a slot, behind everything ranked lower
+    // (onWait is called once if it has to). False if the token was cancelled first.
+    bool Enter(PipelineStage stage, const StageRank& rank, const network::CancelTokenPtr& cancel,
+               const std::function<void()>& onWait = nullptr);
+    void Leave(PipelineStage stage, std::chrono::steady_clock::time_point enteredAt);
+
+    std::vector<StageStats> GetStats();
+
+private:
+    DownloadStages();
+    ~DownloadStages() = default;
+    DownloadStages(const DownloadStages&) = delete;
+    DownloadStages& operator=(const DownloadStages&) = delete;
+
+    using Clock = std::chrono::steady_clock;
+    // (tier, due, arrival); the arrival number keeps equal ranks first come, first served
+    using Waiter = std::tuple<int, Clock::time_point, uint64_t>;
+
+    struct Stage {
+        int active = 0;
+        int limit = 1;
+        std::set<Waiter> waiters;           // In the order they get in
+        uint64_t completed = 0;
+        std::deque<Clock::time_point> recent; // Completions in the last minute
+        double serviceSeconds = 0;
+        double waitSeconds = 0;
+    };
+
+    static void Smooth(double& average, double sample);
+
+    Stage m_stages[kPipelineStageCount];
+    uint64_t m_nextWaiter = 0;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+};
+
+// Holds a slot in one stage until it is released or goes out of scope
+class StageSlot {
+public:
+    StageSlot(PipelineStage stage, const StageRank& rank, const network::CancelTokenPtr& cancel,
+              const std::function<void()>& onWait = nullptr)
+        : m_stage(stage), m_held(DownloadStages::Instance().Enter(stage, rank, cancel, onWait)),
+          m_enteredAt(std::chrono::steady_clock::now()) {}
+    ~StageSlot() { Release(); }
+    StageSlot(const StageSlot&) = delete;
+    StageSlot& operator=(const StageSlot&) = delete;
+
+    // False if the token was cancelled while waiting
+    explicit operator bool() const { return m_held; }
+
+    void Release() {
+        if (!m_held) return;
+        m_held = false;
+        DownloadStages::Instance().Leave(m_stage, m_enteredAt);
+    }
+
+private:
+    PipelineStage m_stage;
+    bool m_held;
+    std::chrono::steady_clock::time_point m_enteredAt;
+};
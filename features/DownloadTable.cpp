@@ -0,0 +1,243 @@
+#include "DownloadTable.h"
+#include "utils/Utf8.h"
+#include <algorithm>
+
+// Progress alone publishes a new snapshot at most this often
+static const std::chrono::milliseconds kPublishInterval(50);
+// Rate samples closer together than this are too noisy to use
+static const std::chrono::milliseconds kRateSampleInterval(500);
+// Weight of the newest rate sample
+static const double kRateSmoothing = 0.3;
+// Finished downloads stay in the list this long, and only the newest few of them
+static const std::chrono::seconds kFinishedLinger(15);
+static const size_t kMaxFinished = 10;
+
+const char* DownloadPhaseName(DownloadPhase phase) {
+    switch (phase) {
+        case DownloadPhase::Resolving: return "Resolving";
+        case DownloadPhase::Metadata: return "Fetching metadata";
+        case DownloadPhase::Connecting: return "Connecting";
+        case DownloadPhase::Transferring: return "Downloading";
+        case DownloadPhase::Importing: return "Importing";
+        case DownloadPhase::Complete: return "Complete";
+        case DownloadPhase::Skipped: return "Skipped";
+        case DownloadPhase::Failed: return "Failed";
+        case DownloadPhase::Cancelled: return "Cancelled";
+    }
+    return "";
+}
+
+DownloadTable::DownloadTable() : m_snapshot(std::unique_ptr<const DownloadSnapshot>(new DownloadSnapshot())) {}
+
+DownloadTable::~DownloadTable() {
+    Stop();
+}
+
+void DownloadTable::Start() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_running) return;
+    m_running = true;
+    m_thread = std::thread(&DownloadTable::ExpiryThread, this);
+}
+
+void DownloadTable::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_running) return;
+        m_running = false;
+    }
+    m_cv.notify_all();
+    if (m_thread.joinable()) m_thread.join();
+}
+
+void DownloadTable::ExpiryThread() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (m_running) {
+        // Sleeps until the next record is due, or until a publish moves that time
+        if (m_nextExpiry.time_since_epoch().count() == 0) m_cv.wait(lock);
+        else if (m_cv.wait_until(lock, m_nextExpiry) == std::cv_status::timeout) Publish(true);
+    }
+}
+
+DownloadTable::Entry* DownloadTable::Find(const std::wstring& key) {
+    auto it = m_entries.find(key);
+    return it != m_entries.end() ? &it->second : nullptr;
+}
+
+std::string DownloadTable::IdText(const std::wstring& key) {
+    return ToUtf8(key.compare(0, 1, L"b") == 0 ? key.substr(1) : key);
+}
+
+void DownloadTable::Begin(const std::wstring& key, const std::wstring& name) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Entry* existing = Find(key);
+    if (existing && !IsFinished(existing->record.phase)) {
+        // Already tracked by the caller one level up
+        if (!name.empty()) existing->record.name = ToUtf8(name);
+        Publish(true);
+        return;
+    }
+    Entry entry;
+    entry.record.setId = IdText(key);
+    entry.record.name = name.empty() ? entry.record.setId : ToUtf8(name);
+    entry.order = m_nextOrder++;
+    m_entries[key] = entry;
+    Publish(true);
+}
+
+void DownloadTable::Rekey(const std::wstring& from, const std::wstring& to) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(from);
+    if (it == m_entries.end() || from == to) return;
+    Entry entry = it->second;
+    m_entries.erase(it);
+    Entry* existing = Find(to);
+    if (existing && !IsFinished(existing->record.phase)) {
+        // Tracked already; the beatmap's own record would only duplicate it
+        Publish(true);
+        return;
+    }
+    if (entry.record.name == entry.record.setId) entry.record.name = IdText(to);
+    entry.record.setId = IdText(to);
+    m_entries[to] = entry;
+    Publish(true);
+}
+
+void DownloadTable::SetName(const std::wstring& key, const std::wstring& name) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (Entry* entry = Find(key)) {
+        entry->record.name = ToUtf8(name);
+        Publish(true);
+    }
+}
+
+void DownloadTable::SetPhase(const std::wstring& key, DownloadPhase phase, const std::wstring& detail) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (Entry* entry = Find(key)) {
+        entry->record.phase = phase;
+        entry->record.detail = ToUtf8(detail);
+        if (phase == DownloadPhase::Connecting) {
+            // A new attempt starts over; its rate is measured afresh
+            entry->record.rateBps = 0;
+            entry->record.etaSeconds = -1;
+            entry->sampleTime = Clock::time_point();
+        }
+        Publish(true);
+    }
+}
+
+void DownloadTable::SetMirror(const std::wstring& key, const std::string& mirror) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (Entry* entry = Find(key)) {
+        entry->record.mirror = mirror;
+        Publish(true);
+    }
+}
+
+void DownloadTable::Progress(const std::wstring& key, double downloadedBytes, double totalBytes) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Entry* entry = Find(key);
+    if (!entry || IsFinished(entry->record.phase)) return;
+
+    DownloadRecord& record = entry->record;
+    bool phaseChanged = record.phase == DownloadPhase::Connecting;
+    if (phaseChanged) {
+        record.phase = DownloadPhase::Transferring;
+        record.detail.clear();
+    }
+    record.downloadedBytes = (uint64_t)downloadedBytes;
+    record.totalBytes = (uint64_t)(std::max)(0.0, totalBytes);
+
+    auto now = Clock::now();
+    if (entry->sampleTime.time_since_epoch().count() == 0 || downloadedBytes < entry->sampleBytes) {
+        entry->sampleTime = now;
+        entry->sampleBytes = downloadedBytes;
+    } else if (now - entry->sampleTime >= kRateSampleInterval) {
+        double seconds = std::chrono::duration<double>(now - entry->sampleTime).count();
+        double sample = (downloadedBytes - entry->sampleBytes) / seconds;
+        record.rateBps = record.rateBps > 0 ? record.rateBps + kRateSmoothing * (sample - record.rateBps) : sample;
+        entry->sampleTime = now;
+        entry->sampleBytes = downloadedBytes;
+    }
+    record.etaSeconds = (record.totalBytes > 0 && record.rateBps > 0)
+        ? (record.totalBytes - (std::min)(record.downloadedBytes, record.totalBytes)) / record.rateBps
+        : -1;
+    Publish(phaseChanged);
+}
+
+void DownloadTable::Finish(const std::wstring& key, DownloadPhase result, const std::wstring& detail) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Entry* entry = Find(key);
+    if (!entry) {
+        // Failed before it was tracked, e.g. while resolving a beatmap ID
+        Entry added;
+        added.record.setId = added.record.name = IdText(key);
+        added.order = m_nextOrder++;
+        entry = &(m_entries[key] = added);
+    }
+    entry->record.phase = result;
+    entry->record.detail = ToUtf8(detail);
+    entry->record.rateBps = 0;
+    entry->record.etaSeconds = -1;
+    entry->finishedAt = Clock::now();
+    Publish(true);
+}
+
+void DownloadTable::Remove(const std::wstring& key) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_entries.erase(key)) Publish(true);
+}
+
+void DownloadTable::Publish(bool force) {
+    auto now = Clock::now();
+    if (!force && now - m_lastPublish < kPublishInterval) return;
+    m_lastPublish = now;
+
+    std::vector<const Entry*> entries;
+    size_t finished = 0;
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        const Entry& entry = it->second;
+        if (IsFinished(entry.record.phase) && now - entry.finishedAt >= kFinishedLinger) {
+            it = m_entries.erase(it);
+            continue;
+        }
+        if (IsFinished(entry.record.phase)) finished++;
+        entries.push_back(&entry);
+        ++it;
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry* a, const Entry* b) { return a->order < b->order; });
+
+    std::unique_ptr<DownloadSnapshot> snapshot(new DownloadSnapshot());
+    Clock::time_point nextExpiry;
+    for (const Entry* entry : entries) {
+        const DownloadRecord& record = entry->record;
+        if (IsFinished(record.phase)) {
+            // Oldest finished ones drop out first
+            if (finished-- > kMaxFinished) continue;
+            Clock::time_point expiry = entry->finishedAt + kFinishedLinger;
+            if (nextExpiry.time_since_epoch().count() == 0 || expiry < nextExpiry) nextExpiry = expiry;
+        } else {
+            snapshot->active++;
+            if (record.totalBytes > 0) {
+                snapshot->downloadedBytes += (std::min)(record.downloadedBytes, record.totalBytes);
+                snapshot->totalBytes += record.totalBytes;
+            }
+            snapshot->rateBps += record.rateBps;
+        }
+        snapshot->items.push_back(record);
+    }
+    if (snapshot->rateBps > 0 && snapshot->totalBytes > 0) {
+        snapshot->etaSeconds = (snapshot->totalBytes - snapshot->downloadedBytes) / snapshot->rateBps;
+    }
+
+    if (nextExpiry != m_nextExpiry) {
+        m_nextExpiry = nextExpiry;
+        m_cv.notify_all();
+    }
+    m_snapshot.Store(std::move(snapshot));
+}
+
+const DownloadSnapshot& DownloadTable::Snapshot() {
+    // The render thread calls this every frame; it must not allocate or wait for a download thread
+    return m_snapshot.Load();
+}
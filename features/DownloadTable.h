@@ -0,0 +1,120 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <string>
+#include <thread>
+#include <vector>
+#include "utils/SnapshotCell.h"
+
+enum class DownloadPhase {
+    Resolving,    // Beatmap ID -> set ID
+    Metadata,     // Artist and title for the file name
+    Connecting,   // Waiting for a mirror, or for its first byte
+    Transferring,
+    Importing,    // Handing the file to osu!
+    // Finished; the record stays visible for a moment
+    Complete,
+    Skipped,
+    Failed,
+    Cancelled
+};
+
+const char* DownloadPhaseName(DownloadPhase phase);
+inline bool IsFinished(DownloadPhase phase) { return phase >= DownloadPhase::Complete; }
+
+struct DownloadRecord {
+    std::string setId;            // UTF-8; the beatmap ID until it is resolved
+    std::string name;             // UTF-8 display name
+    DownloadPhase phase = DownloadPhase::Resolving;
+    std::string detail;           // UTF-8, e.g. "Retrying in 3 s...", empty if the phase says it all
+    std::string mirror;
+    uint64_t downloadedBytes = 0;
+    uint64_t totalBytes = 0;      // 0 until the mirror reports a size
+    double rateBps = 0;
+    double etaSeconds = -1;       // -1 if unknown
+};
+
+struct DownloadSnapshot {
+    std::vector<DownloadRecord> items; // Oldest first
+    int active = 0;                    // Items not finished yet
+    uint64_t downloadedBytes = 0;      // Over the active items that know their size
+    uint64_t totalBytes = 0;
+    double rateBps = 0;
+    double etaSeconds = -1;
+};
+
+// Every download in flight, keyed by set ID, so parallel downloads don't overwrite
+// each other's progress. A beatmap ID waiting to be resolved goes under BeatmapKey,
+// so beatmap N and set N never share a record. Writers update their own record;
+// each change publishes an immutable snapshot through a SnapshotCell, which the
+// overlay reads without locking, allocating or waiting on the writers.
+class DownloadTable {
+public:
+    static DownloadTable& Instance() {
+        static DownloadTable instance;
+        return instance;
+    }
+
+    // Runs the thread that drops finished records once they have been shown long enough
+    void Start();
+    void Stop();
+
+    static std::wstring BeatmapKey(const std::wstring& beatmapId) { return L"b" + beatmapId; }
+
+    // Starts a record, or renames the unfinished one already under key
+    void Begin(const std::wstring& key, const std::wstring& name);
+    // Moves a record to its set ID once the beatmap ID is resolved. A finished record
+    // of the set gives way; an unfinished one already shows the set, and absorbs it.
+    void Rekey(const std::wstring& from, const std::wstring& to);
+    void SetName(const std::wstring& key, const std::wstring& name);
+    void SetPhase(const std::wstring& key, DownloadPhase phase, const std::wstring& detail = L"");
+    void SetMirror(const std::wstring& key, const std::string& mirror);
+    // Also moves a connecting download to Transferring
+    void Progress(const std::wstring& key, double downloadedBytes, double totalBytes);
+    void Finish(const std::wstring& key, DownloadPhase result, const std::wstring& detail = L"");
+    // Drops a record without showing a result, e.g. when it turned out to duplicate another
+    void Remove(const std::wstring& key);
+
+    // Render thread only. Never takes a lock, allocates or frees; the snapshot stays
+    // valid until the next call, so load it once per frame.
+    const DownloadSnapshot& Snapshot();
+
+private:
+    DownloadTable();
+    ~DownloadTable();
+    DownloadTable(const DownloadTable&) = delete;
+    DownloadTable& operator=(const DownloadTable&) = delete;
+
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        DownloadRecord record;
+        uint64_t order = 0;
+        Clock::time_point sampleTime;  // Last rate sample
+        double sampleBytes = 0;
+        Clock::time_point finishedAt;
+    };
+
+    // Builds and swaps in a new snapshot; progress-only changes are rate limited
+    void Publish(bool force);
+    // Publishes again whenever the oldest finished record is due to go
+    void ExpiryThread();
+    Entry* Find(const std::wstring& key);
+    // The ID a key stands for, as shown in the record
+    static std::string IdText(const std::wstring& key);
+
+    std::map<std::wstring, Entry> m_entries;
+    uint64_t m_nextOrder = 0;
+    Clock::time_point m_lastPublish;
+    Clock::time_point m_nextExpiry; // When the oldest finished record in m_snapshot is due to go
+    std::mutex m_mutex;
+    std::condition_variable m_cv;   // Wakes the expiry thread when m_nextExpiry changes
+    std::thread m_thread;
+    bool m_running = false;
+
+    SnapshotCell<DownloadSnapshot> m_snapshot; // Stored under m_mutex
+};
@@ -0,0 +1,477 @@
+#include "HedgedDownload.h"
+#include "MirrorConcurrency.h"
+#include "MirrorHealth.h"
+#include "RetryPolicy.h"
+#include "network/HttpRequest.h"
+#include "network/PartFile.h"
+#include "network/RateLimiter.h"
+#include "utils/logging.h"
+#include <windows.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+using Clock = std::chrono::steady_clock;
+
+// Hedge if the first mirror has not answered after this long...
+static const std::chrono::milliseconds kFirstByteDeadline(3000);
+// ...or if, this long after answering, its rate needs more than kSlowFinishSeconds to finish
+static const std::chrono::milliseconds kEarlyWindow(4000);
+static const double kSlowFinishSeconds = 20.0;
+// Once the hedge answers both copies run this long, then the one finishing later is cancelled
+static const std::chrono::milliseconds kCompareWindow(3000);
+// At most this fraction of downloads may start a hedge (plus one)
+static const double kMaxHedgeRatio = 0.25;
+
+// Throughput is judged over this rolling window
+static const std::chrono::milliseconds kStallWindow(8000);
+// A mirror that has not answered after this long is stalled
+static const std::chrono::milliseconds kConnectStall(10000);
+// Stalled means below this fraction of the mirror's usual speed...
+static const double kStallFraction = 0.1;
+// ...and never less than this when the mirror has no history yet
+static const double kMinStallBps = 16 * 1024;
+
+static const std::chrono::milliseconds kPollInterval(200);
+
+static std::atomic<int> g_Downloads{0};
+static std::atomic<int> g_Hedges{0};
+
+static bool AcquireHedgeBudget() {
+    int hedges = g_Hedges.load();
+    while (hedges < 1 + kMaxHedgeRatio * g_Downloads.load()) {
+        if (g_Hedges.compare_exchange_weak(hedges, hedges + 1)) return true;
+    }
+    return false;
+}
+
+namespace {
+
+    // One copy of the file being downloaded. Slot 0 writes to the destination,
+    // slot 1 (the hedge) to "<dest>.hedge". A stalled racer is replaced by the
+    // next mirror in the same slot so its partial file can be continued.
+    struct Racer {
+        DownloadCandidate candidate;
+        std::wstring path;
+        network::CancelTokenPtr cancel = std::make_shared<network::CancellationToken>();
+        bool started = false;
+        bool done = false;
+        network::HttpResult result;
+        Clock::time_point startTime;
+        Clock::time_point firstByteTime;
+        Clock::time_point endTime;
+        bool gotFirstByte = false;
+        double startBytes = 0; // Already on disk from an earlier attempt
+        double bytes = 0;
+        double total = 0;
+        double baselineBps = 0; // Mirror's usual speed when this racer started
+        std::deque<std::pair<Clock::time_point, double>> samples;
+        std::string stallReason; // Set once the racer is cancelled for stalling
+        bool superseded = false; // Cancelled because the other copy won or is faster
+
+        bool Active() const { return started && !done; }
+
+        double Rate(Clock::time_point now) const {
+            double seconds = std::chrono::duration<double>(now - firstByteTime).count();
+            return (gotFirstByte && seconds > 0) ? (bytes - startBytes) / seconds : 0;
+        }
+
+        // Seconds left at the current rate; unknown counts as forever
+        double Eta(Clock::time_point now) const {
+            double rate = Rate(now);
+            if (total <= 0 || rate <= 0) return 1e9;
+            return (total - bytes) / rate;
+        }
+    };
+
+    struct Race {
+        std::mutex mutex;
+        std::condition_variable cv;
+        Racer racers[2];
+        std::function<void(double, double)> progressCb;
+        bool cancelled = false; // The caller gave up on the download
+    };
+
+}
+
+static void StartRacer(const std::shared_ptr<Race>& race, int index, long timeoutSeconds) {
+    DownloadCandidate candidate;
+    std::wstring path;
+    network::CancelTokenPtr cancel;
+    double baseline = 0;
+    {
+        std::lock_guard<std::mutex> lock(race->mutex);
+        candidate = race->racers[index].candidate;
+    }
+    if (!candidate.mirror.empty()) {
+        baseline = MirrorHealth::Instance().GetStats(candidate.mirror).throughputBps;
+    }
+    {
+        std::lock_guard<std::mutex> lock(race->mutex);
+        Racer& racer = race->racers[index];
+        racer.started = true;
+        racer.startTime = Clock::now();
+        racer.baselineBps = baseline;
+        path = racer.path;
+        cancel = racer.cancel;
+        // Cancelled while starting: the transfer ends right away with a cancelled result
+        if (race->cancelled) cancel->Cancel();
+    }
+
+    network::HttpRequest::StartDownload(candidate.url, path,
+        [race, index](double dlNow, double dlTotal) {
+            {
+                std::lock_guard<std::mutex> lock(race->mutex);
+                Racer& racer = race->racers[index];
+                auto now = Clock::now();
+                if (!racer.gotFirstByte) {
+                    racer.gotFirstByte = true;
+                    racer.firstByteTime = now;
+                    racer.startBytes = dlNow;
+                }
+                racer.bytes = dlNow;
+                racer.total = dlTotal;
+
+                // Keep one sample older than the window to measure across all of it
+                racer.samples.emplace_back(now, dlNow);
+                while (racer.samples.size() > 2 && racer.samples[1].first <= now - kStallWindow) {
+                    racer.samples.pop_front();
+                }
+
+                // Show whichever copy is further along
+                const Racer& other = race->racers[1 - index];
+                if (other.Active() && other.total > 0 && other.bytes / other.total > dlNow / dlTotal) return;
+            }
+            if (race->progressCb) race->progressCb(dlNow, dlTotal);
+        },
+        [race, index](const network::HttpResult& result) {
+            std::string mirror;
+            {
+                std::lock_guard<std::mutex> lock(race->mutex);
+                Racer& racer = race->racers[index];
+                racer.done = true;
+                racer.endTime = Clock::now();
+                racer.result = result;
+                mirror = racer.candidate.mirror;
+            }
+            // The racer's slot on its mirror, see TakeSlot
+            MirrorConcurrency::Instance().Release(mirror);
+            race->cv.notify_all();
+        },
+        timeoutSeconds, candidate.segments, cancel, network::ExpectedPayload::ZipArchive);
+}
+
+// Every racer holds a MirrorConcurrency slot on its mirror from before it starts until it ends.
+// The first candidate from next on whose mirror has a slot free takes it and moves up to next.
+// Waits while they are all busy unless wait is false; false if no slot was taken.
+static bool TakeSlot(std::vector<DownloadCandidate>& candidates, size_t next, bool wait,
+                     const network::CancelTokenPtr& cancel, const std::function<void()>& onWait = nullptr) {
+    std::vector<std::string> mirrors;
+    for (size_t i = next; i < candidates.size(); ++i) mirrors.push_back(candidates[i].mirror);
+    int slot = wait ? MirrorConcurrency::Instance().Acquire(mirrors, cancel, onWait)
+                    : MirrorConcurrency::Instance().TryAcquire(mirrors);
+    if (slot < 0) return false;
+    std::rotate(candidates.begin() + next, candidates.begin() + next + slot, candidates.begin() + next + slot + 1);
+    return true;
+}
+
+// Why the primary needs a hedge, or empty if it is doing fine
+static std::string HedgeReason(const Racer& primary, Clock::time_point now, bool rateLimited) {
+    if (primary.done) return "";
+    if (!primary.gotFirstByte) {
+        return (now - primary.startTime >= kFirstByteDeadline) ? "no response after 3 s" : "";
+    }
+    // Under a user bandwidth cap every mirror looks slow; racing would only split the cap
+    if (!rateLimited && now - primary.firstByteTime >= kEarlyWindow && primary.Eta(now) > kSlowFinishSeconds) {
+        return "slow, " + std::to_string((int)(primary.Rate(now) / 1024)) + " KB/s";
+    }
+    return "";
+}
+
+// Why a running transfer counts as stalled, or empty if it is making progress
+static std::string StallReason(const Racer& racer, Clock::time_point now, int64_t rateLimit) {
+    if (!racer.gotFirstByte) {
+        return (now - racer.startTime >= kConnectStall) ? "no response after 10 s" : "";
+    }
+    if (racer.samples.empty() || now - racer.samples.front().first < kStallWindow) return "";
+
+    double seconds = std::chrono::duration<double>(now - racer.samples.front().first).count();
+    double rate = (racer.bytes - racer.samples.front().second) / seconds;
+    // Nearly done; switching now would cost more than it saves
+    if (racer.total > 0 && racer.total - racer.bytes <= rate * seconds) return "";
+
+    double threshold = (std::max)(kMinStallBps, racer.baselineBps * kStallFraction);
+    if (rateLimit > 0) threshold = (std::min)(threshold, rateLimit * kStallFraction);
+    if (rate >= threshold) return "";
+
+    return std::to_string((int)(rate / 1024)) + " KB/s over " + std::to_string((int)seconds) + " s, usually " +
+           std::to_string((int)(racer.baselineBps / 1024)) + " KB/s";
+}
+
+static DownloadAttempt MakeAttempt(const Racer& racer, bool userCancelled) {
+    DownloadAttempt attempt;
+    attempt.mirror = racer.candidate.mirror;
+    attempt.success = racer.result.success;
+    attempt.statusCode = racer.result.statusCode;
+    attempt.seconds = std::chrono::duration<double>(racer.endTime - racer.startTime).count();
+    attempt.bytes = racer.bytes - racer.startBytes;
+    attempt.stalled = !racer.stallReason.empty();
+    attempt.superseded = racer.superseded;
+    attempt.cancelled = userCancelled && racer.result.cancelled && !attempt.stalled && !attempt.superseded;
+    attempt.invalidPayload = racer.result.invalidPayload;
+    attempt.localError = racer.result.localError;
+    attempt.rateLimited = racer.result.rateLimited;
+    attempt.retryAfterSeconds = racer.result.retryAfterSeconds;
+    if (!attempt.success) {
+        attempt.error = attempt.stalled ? "stalled, " + racer.stallReason
+                      : attempt.superseded ? "another mirror was faster"
+                      : racer.result.error;
+    }
+    return attempt;
+}
+
+static void RecordHealth(const Racer& racer) {
+    if (!racer.started || racer.candidate.mirror.empty()) return;
+    if (racer.result.success) {
+        double seconds = std::chrono::duration<double>(racer.endTime - racer.startTime).count();
+        double ttfb = racer.gotFirstByte ? std::chrono::duration<double>(racer.firstByteTime - racer.startTime).count() : 0;
+        MirrorHealth::Instance().RecordSuccess(racer.candidate.mirror, racer.bytes - racer.startBytes, seconds, ttfb);
+    } else if ((!racer.result.cancelled || !racer.stallReason.empty()) && !racer.result.rateLimited) {
+        // A rate-limited mirror is busy with us, not broken; the RateLimiter keeps it aside instead
+        MirrorHealth::Instance().RecordFailure(racer.candidate.mirror);
+    }
+}
+
+// Points the partial file at the next mirror's URL so StartDownload tries to continue it.
+// The mirror only answers the Range request if the If-Range validator matches its copy.
+static void RetargetPartFile(const std::wstring& path, const std::string& url) {
+    network::PartFileState state;
+    if (network::PartFile::Load(path, state)) {
+        state.url = url;
+        network::PartFile::Save(path, state);
+    }
+}
+
+HedgeOutcome RunHedgedDownload(const std::vector<DownloadCandidate>& rankedCandidates, const std::wstring& destPath,
+                               std::function<void(double dlNow, double dlTotal)> progressCb, long timeoutSeconds,
+                               bool allowHedge, network::CancelTokenPtr cancel, std::function<void()> onWaitForMirror) {
+    HedgeOutcome outcome;
+    if (rankedCandidates.empty()) {
+        outcome.error = "No mirror available";
+        return outcome;
+    }
+
+    // Mirrors that are rate limiting us go to the back, so the race starts on one that will answer
+    std::vector<DownloadCandidate> candidates = rankedCandidates;
+    std::stable_partition(candidates.begin(), candidates.end(), [](const DownloadCandidate& candidate) {
+        return network::RateLimiter::Instance().Delay(candidate.url).count() == 0;
+    });
+    if (candidates[0].mirror != rankedCandidates[0].mirror) {
+        LogInfo(rankedCandidates[0].mirror + " is rate limited, starting with " + candidates[0].mirror);
+    }
+    // A busy mirror hands the start to the next one in line
+    if (!TakeSlot(candidates, 0, true, cancel, onWaitForMirror)) {
+        outcome.cancelled = true;
+        outcome.error = "Cancelled";
+        return outcome;
+    }
+    g_Downloads++;
+
+    auto race = std::make_shared<Race>();
+    race->progressCb = progressCb;
+    race->racers[0].candidate = candidates[0];
+    race->racers[0].path = destPath;
+    race->racers[1].path = destPath + L".hedge";
+    size_t nextCandidate = 1;
+
+    // The caller's token stops both copies; the loop below then winds down without failing over
+    size_t subscription = 0;
+    if (cancel) {
+        subscription = cancel->Subscribe([race] {
+            {
+                std::lock_guard<std::mutex> lock(race->mutex);
+                race->cancelled = true;
+                for (Racer& racer : race->racers) {
+                    if (racer.started) racer.cancel->Cancel();
+                }
+            }
+            race->cv.notify_all();
+        });
+    }
+
+    StartRacer(race, 0, timeoutSeconds);
+
+    int winner = -1;
+    bool compared = false;
+    bool hedgeAllowed = allowHedge;
+    std::unique_lock<std::mutex> lock(race->mutex);
+    Racer& primary = race->racers[0];
+    Racer& hedge = race->racers[1];
+    for (;;) {
+        auto now = Clock::now();
+
+        // The first complete copy wins; the other one is not needed any more
+        for (int i = 0; i < 2 && winner < 0; ++i) {
+            Racer& racer = race->racers[i];
+            if (racer.done && racer.result.success) {
+                winner = i;
+                Racer& other = race->racers[1 - i];
+                if (other.Active()) {
+                    other.superseded = true;
+                    other.cancel->Cancel();
+                }
+            }
+        }
+
+        // A stalled racer, or a failed one with nothing else running, has wound down;
+        // the next mirror takes over its slot and partial file
+        bool restarted = false;
+        for (int i = 0; i < 2 && winner < 0 && !restarted; ++i) {
+            Racer& racer = race->racers[i];
+            if (!racer.done || race->cancelled || nextCandidate >= candidates.size()) continue;
+            bool stalled = !racer.stallReason.empty();
+            bool failed = !racer.result.success && !racer.result.cancelled && !race->racers[1 - i].Active();
+            if (!stalled && !failed) continue;
+
+            // A local problem such as a full disk would only fail the next mirror too
+            DownloadAttempt attempt = MakeAttempt(racer, false);
+            if (ClassifyFailure(attempt) == FailureClass::Fatal) continue;
+
+            // Nothing else runs now; the next mirror may still be busy with other downloads
+            lock.unlock();
+            bool slot = TakeSlot(candidates, nextCandidate, true, cancel);
+            lock.lock();
+            // Cancelled while waiting: the loop winds down
+            if (!slot) continue;
+            outcome.attempts.push_back(attempt);
+
+            const DownloadCandidate& next = candidates[nextCandidate++];
+            std::string note = racer.candidate.mirror + (stalled ? " stalled (" + racer.stallReason + ")"
+                                                                 : " failed (" + racer.result.error + ")") +
+                               ", switched to " + next.mirror;
+            LogInfo(note);
+            outcome.switches.push_back(note);
+
+            lock.unlock();
+            RecordHealth(racer);
+            RetargetPartFile(racer.path, next.url);
+            lock.lock();
+
+            std::wstring path = racer.path;
+            racer = Racer();
+            racer.candidate = next;
+            racer.path = path;
+            lock.unlock();
+            StartRacer(race, i, timeoutSeconds);
+            lock.lock();
+            restarted = true;
+        }
+        if (restarted) continue;
+
+        if (!primary.Active() && !hedge.Active()) break;
+
+        bool rateLimited = network::HttpRequest::GetDownloadRateLimit() > 0;
+        if (race->cancelled) {
+            // Only waiting for the cancelled copies to wind down
+        } else if (winner < 0 && !hedge.started && nextCandidate < candidates.size()) {
+            std::string reason = HedgeReason(primary, now, rateLimited);
+            // A hedge doesn't wait for a slot; with every other mirror busy it is tried again next round
+            if (!reason.empty() && hedgeAllowed && TakeSlot(candidates, nextCandidate, false, nullptr)) {
+                if (!AcquireHedgeBudget()) {
+                    MirrorConcurrency::Instance().Release(candidates[nextCandidate].mirror);
+                    LogDebug("Hedge budget used up, staying on " + primary.candidate.mirror);
+                    hedgeAllowed = false;
+                    continue;
+                }
+                hedge.candidate = candidates[nextCandidate++];
+                LogInfo("Hedging " + primary.candidate.mirror + " (" + reason + ") with " + hedge.candidate.mirror);
+                outcome.hedged = true;
+                outcome.switches.push_back(primary.candidate.mirror + " slow, raced with " + hedge.candidate.mirror);
+                lock.unlock();
+                StartRacer(race, 1, timeoutSeconds);
+                lock.lock();
+                continue;
+            }
+        } else if (winner < 0 && !compared && primary.Active() && hedge.Active() &&
+                   hedge.gotFirstByte && now - hedge.firstByteTime >= kCompareWindow) {
+            // Keep the copy that finishes first and stop paying for the other
+            compared = true;
+            int loser = (primary.Eta(now) <= hedge.Eta(now)) ? 1 : 0;
+            race->racers[loser].superseded = true;
+            race->racers[loser].cancel->Cancel();
+            LogInfo("Hedge race: keeping " + race->racers[1 - loser].candidate.mirror + ", cancelled " +
+                    race->racers[loser].candidate.mirror);
+        }
+
+        // A racer running alone that stalls is handed to the next mirror once it has stopped
+        if (winner < 0 && !race->cancelled && nextCandidate < candidates.size()) {
+            int64_t rateLimit = network::HttpRequest::GetDownloadRateLimit();
+            for (int i = 0; i < 2; ++i) {
+                Racer& racer = race->racers[i];
+                if (!racer.Active() || !racer.stallReason.empty() || race->racers[1 - i].Active()) continue;
+                std::string reason = StallReason(racer, now, rateLimit);
+                if (reason.empty()) continue;
+                racer.stallReason = reason;
+                racer.cancel->Cancel();
+            }
+        }
+
+        race->cv.wait_for(lock, kPollInterval);
+    }
+    outcome.cancelled = race->cancelled && winner < 0;
+    // Both slots' last attempts, in the order they ended
+    int first = (hedge.started && hedge.endTime < primary.endTime) ? 1 : 0;
+    for (int i : { first, 1 - first }) {
+        if (race->racers[i].started) outcome.attempts.push_back(MakeAttempt(race->racers[i], race->cancelled));
+    }
+    lock.unlock();
+    if (cancel) cancel->Unsubscribe(subscription);
+
+    // A download the user stopped says nothing about the mirrors
+    if (!outcome.cancelled) {
+        RecordHealth(primary);
+        RecordHealth(hedge);
+    }
+
+    if (winner == 1) {
+        // The hedge's copy replaces whatever the primary left behind
+        if (MoveFileExW(hedge.path.c_str(), destPath.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+            network::PartFile::Discard(destPath);
+        } else {
+            winner = -1;
+            outcome.error = "Failed to move hedged download into place";
+            // The hedge's attempt did not deliver the file after all, and retrying can't fix the move
+            for (DownloadAttempt& attempt : outcome.attempts) {
+                if (attempt.mirror != hedge.candidate.mirror || !attempt.success) continue;
+                attempt.success = false;
+                attempt.localError = true;
+                attempt.error = outcome.error;
+            }
+        }
+    }
+    if (hedge.started && winner != 1) {
+        network::PartFile::Discard(hedge.path);
+    }
+
+    if (winner >= 0) {
+        Racer& racer = race->racers[winner];
+        outcome.success = true;
+        outcome.mirror = racer.candidate.mirror;
+        if (outcome.hedged) {
+            Racer& loser = race->racers[1 - winner];
+            LogInfo("Hedged download won by " + racer.candidate.mirror + "; " + loser.candidate.mirror + " spent " +
+                    std::to_string((long long)(loser.bytes - loser.startBytes) / 1024) + " KB");
+        }
+    } else if (outcome.cancelled) {
+        outcome.error = "Cancelled";
+    } else if (outcome.error.empty()) {
+        // Report the last mirror that actually failed rather than one we cancelled
+        const Racer& failed = (hedge.started && !hedge.result.cancelled) ? hedge : primary;
+        outcome.error = failed.result.error;
+    }
+    return outcome;
+}
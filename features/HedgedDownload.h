@@ -0,0 +1,57 @@
+#pragma once
+#include <functional>
+#include <string>
+#include <vector>
+#include "network/CancellationToken.h"
+
+struct DownloadCandidate {
+    std::string mirror; // Provider name, for MirrorHealth
+    std::string url;
+    int segments = 1;
+};
+
+// One mirror's try at the file, kept for diagnostics and the retry decision
+struct DownloadAttempt {
+    std::string mirror;
+    bool success = false;
+    long statusCode = 0;
+    std::string error;           // Why it ended without the file, empty on success
+    double seconds = 0;
+    double bytes = 0;            // Received by this attempt
+    bool stalled = false;        // Stopped for running far below the mirror's usual speed
+    bool superseded = false;     // Stopped because another copy won; not a failure
+    bool cancelled = false;      // Stopped through the caller's token
+    bool invalidPayload = false; // Mirror sent an error page or a broken archive
+    bool localError = false;     // Failed on our side, such as a full disk; no mirror would do better
+    bool rateLimited = false;    // Mirror answered 429, or we held the request back for it
+    double retryAfterSeconds = 0;
+};
+
+struct HedgeOutcome {
+    bool success = false;
+    std::string mirror; // Mirror whose copy was kept
+    std::string error;
+    bool hedged = false; // A second mirror was raced against the first
+    bool cancelled = false; // Stopped through the caller's token
+    std::vector<std::string> switches; // Mirror changes during the download, oldest first
+    std::vector<DownloadAttempt> attempts; // Every mirror tried, in the order they ended
+};
+
+// Downloads destPath from candidates[0], blocking the calling thread until done.
+// With allowHedge, the next candidate is raced against it when it has no first
+// byte after a few seconds, runs clearly slower than needed or fails; once both
+// have a measurable rate the one that would finish later is cancelled.
+// A transfer whose rolling throughput falls far below its mirror's usual speed
+// counts as stalled and is handed to the next candidate, which continues the
+// partial file by byte range if it recognises it. A mirror that fails is
+// replaced by the next candidate the same way, until the list runs out or the
+// failure is one no mirror can fix.
+// Every copy holds a MirrorConcurrency slot on its mirror while it runs. The
+// first copy waits for one (onWaitForMirror is called once if it has to) and
+// starts on the first candidate that has a slot free; a hedge only starts on a
+// mirror with a free slot, and failover waits for one.
+// Cancelling the token stops every copy at once; no other mirror is tried after that.
+HedgeOutcome RunHedgedDownload(const std::vector<DownloadCandidate>& candidates, const std::wstring& destPath,
+                               std::function<void(double dlNow, double dlTotal)> progressCb, long timeoutSeconds,
+                               bool allowHedge, network::CancelTokenPtr cancel = nullptr,
+                               std::function<void()> onWaitForMirror = nullptr);
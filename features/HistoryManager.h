@@ -9,6 +9,7 @@ struct HistoryEntry {
     std::wstring id;
     std::string status; // "Success", "Failed", etc.
     std::time_t timestamp;
+    std::string details; // Mirror attempts and other notes, one per line, may be empty
 };
 
 class HistoryManager {
@@ -0,0 +1,68 @@
+#include "InFlightDownloads.h"
+#include <chrono>
+
+// Waiters check their token this often
+static const std::chrono::milliseconds kPollInterval(100);
+
+InFlightDownloads::FlightPtr InFlightDownloads::Join(const std::wstring& key, bool& leader) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_flights.find(key);
+    if (it != m_flights.end()) {
+        leader = false;
+        it->second->followers++;
+        return it->second;
+    }
+    leader = true;
+    FlightPtr flight = std::make_shared<Flight>();
+    flight->keys.push_back(key);
+    m_flights[key] = flight;
+    return flight;
+}
+
+InFlightDownloads::FlightPtr InFlightDownloads::Alias(const std::wstring& key, const FlightPtr& flight) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_flights.find(key);
+    if (it != m_flights.end() && it->second != flight) {
+        it->second->followers++;
+        return it->second;
+    }
+    if (it == m_flights.end()) {
+        flight->keys.push_back(key);
+        m_flights[key] = flight;
+    }
+    return flight;
+}
+
+void InFlightDownloads::Complete(const FlightPtr& flight, FlightEnd end) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (flight->done) return;
+        flight->done = true;
+        flight->end = end;
+        for (const auto& key : flight->keys) {
+            auto it = m_flights.find(key);
+            if (it != m_flights.end() && it->second == flight) m_flights.erase(it);
+        }
+    }
+    m_cv.notify_all();
+}
+
+bool InFlightDownloads::HasFollowers(const std::wstring& key) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_flights.find(key);
+    return it != m_flights.end() && it->second->followers > 0;
+}
+
+FlightEnd InFlightDownloads::Wait(const FlightPtr& flight, const network::CancelTokenPtr& cancel) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    // Join or Alias counted this follower in
+    while (!flight->done) {
+        if (cancel && cancel->IsCancelled()) {
+            flight->followers--;
+            return FlightEnd::Abandoned;
+        }
+        m_cv.wait_for(lock, kPollInterval);
+    }
+    flight->followers--;
+    return flight->end;
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "network/CancellationToken.h"
+
+// How a flight ended
+enum class FlightEnd {
+    Succeeded,
+    Failed,
+    Abandoned   // The leader was paused or cancelled
+};
+
+// Single-flight registry for beatmap downloads. The first request for a set
+// leads and does the work; requests for the same set arriving from the shell
+// hook, the clipboard or the overlay meanwhile wait for its result instead of
+// resolving, fetching and downloading a second copy to the same path.
+//
+// Keys are "s<set ID>", or "b<beatmap ID>" until the beatmap is resolved.
+// A leader that is paused or cancelled abandons the flight; its followers
+// don't take that as a failure but join again, and one of them takes over.
+class InFlightDownloads {
+public:
+    struct Flight {
+        std::vector<std::wstring> keys; // Guarded by the registry's mutex, like the rest
+        bool done = false;
+        FlightEnd end = FlightEnd::Failed;
+        int followers = 0;              // Requests waiting on it right now
+    };
+    using FlightPtr = std::shared_ptr<Flight>;
+
+    static InFlightDownloads& Instance() {
+        static InFlightDownloads instance;
+        return instance;
+    }
+
+    static std::wstring SetKey(const std::wstring& setId) { return L"s" + setId; }
+    static std::wstring BeatmapKey(const std::wstring& beatmapId) { return L"b" + beatmapId; }
+
+    // Starts a flight under key, or joins the one already there (leader = false)
+    FlightPtr Join(const std::wstring& key, bool& leader);
+    // Files the flight under a second key too. If another flight already holds that
+    // key, nothing changes and that flight is returned for the caller to wait on.
+    FlightPtr Alias(const std::wstring& key, const FlightPtr& flight);
+    // Publishes the result to every follower and frees the keys
+    void Complete(const FlightPtr& flight, FlightEnd end);
+    // True if requests are waiting on the flight filed under key; its leader shouldn't be paused for others
+    bool HasFollowers(const std::wstring& key);
+    // Blocks until the flight completes and returns how it ended; Abandoned if the token was cancelled first
+    FlightEnd Wait(const FlightPtr& flight, const network::CancelTokenPtr& cancel);
+
+private:
+    InFlightDownloads() = default;
+    ~InFlightDownloads() = default;
+    InFlightDownloads(const InFlightDownloads&) = delete;
+    InFlightDownloads& operator=(const InFlightDownloads&) = delete;
+
+    std::map<std::wstring, FlightPtr> m_flights;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+};
+
+// Completes the flight when the leader leaves its scope, with whatever result it set last.
+// A failure with the leader's token cancelled abandons the flight instead.
+class FlightLeader {
+public:
+    FlightLeader(InFlightDownloads::FlightPtr flight, network::CancelTokenPtr cancel)
+        : m_flight(std::move(flight)), m_cancel(std::move(cancel)) {}
+    ~FlightLeader() {
+        FlightEnd end = m_success ? FlightEnd::Succeeded
+                      : m_cancel && m_cancel->IsCancelled() ? FlightEnd::Abandoned : FlightEnd::Failed;
+        InFlightDownloads::Instance().Complete(m_flight, end);
+    }
+    FlightLeader(const FlightLeader&) = delete;
+    FlightLeader& operator=(const FlightLeader&) = delete;
+
+    bool Finish(bool success) { m_success = success; return success; }
+    const InFlightDownloads::FlightPtr& Get() const { return m_flight; }
+
+private:
+    InFlightDownloads::FlightPtr m_flight;
+    network::CancelTokenPtr m_cancel;
+    bool m_success = false;
+};
@@ -0,0 +1,148 @@
+#include "MirrorConcurrency.h"
+#include "utils/logging.h"
+#include <algorithm>
+
+static const int kInitialLimit = 2;
+static const int kMinLimit = 1;
+static const int kMaxLimit = 6;
+// Total throughput is measured over this window of finished downloads
+static const std::chrono::seconds kRateWindow(30);
+// A new limit gets this long to show its effect before the next increase
+static const std::chrono::seconds kProbeInterval(5);
+// Several failures from one burst count as one decrease
+static const std::chrono::seconds kDecreaseHoldoff(2);
+// An increase has to raise the total rate by this much to be kept
+static const double kMinGain = 0.1;
+
+static const std::chrono::milliseconds kPollInterval(100);
+
+MirrorConcurrency::Mirror& MirrorConcurrency::Get(const std::string& mirror) {
+    Mirror& state = m_mirrors[mirror];
+    if (state.limit == 0) state.limit = kInitialLimit;
+    return state;
+}
+
+int MirrorConcurrency::TakeFree(const std::vector<std::string>& mirrors) {
+    for (size_t i = 0; i < mirrors.size(); ++i) {
+        Mirror& mirror = Get(mirrors[i]);
+        if (mirror.active < mirror.limit) {
+            mirror.active++;
+            mirror.peakActive = (std::max)(mirror.peakActive, mirror.active);
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+int MirrorConcurrency::Acquire(const std::vector<std::string>& mirrors, const network::CancelTokenPtr& cancel,
+                               const std::function<void()>& onWait) {
+    if (mirrors.empty()) return -1;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    bool waited = false;
+    for (;;) {
+        int slot = TakeFree(mirrors);
+        if (slot >= 0) return slot;
+        if (cancel && cancel->IsCancelled()) return -1;
+        if (!waited && onWait) {
+            waited = true;
+            lock.unlock();
+            onWait();
+            lock.lock();
+            continue;
+        }
+        // Polled so a cancelled token is noticed without a wakeup from Release
+        m_cv.wait_for(lock, kPollInterval);
+    }
+}
+
+int MirrorConcurrency::TryAcquire(const std::vector<std::string>& mirrors) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return TakeFree(mirrors);
+}
+
+void MirrorConcurrency::Release(const std::string& mirror) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Mirror& state = Get(mirror);
+        if (state.active > 0) state.active--;
+    }
+    m_cv.notify_all();
+}
+
+void MirrorConcurrency::Congested(const std::string& name, Mirror& mirror, Clock::time_point now) {
+    if (now - mirror.lastChange < kDecreaseHoldoff) return;
+    int limit = (std::max)(kMinLimit, mirror.limit / 2);
+    if (limit != mirror.limit) {
+        LogInfo(name + " is overloaded, " + std::to_string(limit) + " download(s) at once (was " + std::to_string(mirror.limit) + ")");
+    }
+    mirror.limit = limit;
+    mirror.probing = false;
+    mirror.baselineBps = 0;
+    mirror.peakActive = mirror.active;
+    mirror.completions.clear();
+    mirror.lastChange = now;
+}
+
+void MirrorConcurrency::Completed(const std::string& name, Mirror& mirror, double bytes, Clock::time_point now) {
+    mirror.completions.push_back({ now, bytes });
+    while (!mirror.completions.empty() && now - mirror.completions.front().first > kRateWindow) {
+        mirror.completions.pop_front();
+    }
+    if (now - mirror.lastChange < kProbeInterval) return;
+
+    // Total rate of the mirror since the window (or the last change) began
+    Clock::time_point since = (std::max)(mirror.lastChange, now - kRateWindow);
+    double seconds = (std::max)(1.0, std::chrono::duration<double>(now - since).count());
+    double total = 0;
+    for (const auto& completion : mirror.completions) {
+        if (completion.first >= since) total += completion.second;
+    }
+    double rate = total / seconds;
+
+    if (mirror.probing && rate < mirror.baselineBps * (1.0 + kMinGain)) {
+        // The extra download only split the same bandwidth further
+        mirror.limit = (std::max)(kMinLimit, mirror.limit - 1);
+        mirror.probing = false;
+        LogDebug(name + " gained nothing from another download, back to " + std::to_string(mirror.limit));
+    } else if (mirror.peakActive >= mirror.limit && mirror.limit < kMaxLimit) {
+        // Only a limit that was actually reached can be holding the mirror back
+        mirror.probing = true;
+        mirror.limit++;
+        LogDebug(name + " allows " + std::to_string(mirror.limit) + " downloads at once (" +
+                 std::to_string((int)(rate / 1024)) + " KB/s)");
+    } else {
+        return;
+    }
+    mirror.baselineBps = rate;
+    mirror.peakActive = mirror.active;
+    mirror.lastChange = now;
+}
+
+void MirrorConcurrency::Record(const std::vector<DownloadAttempt>& attempts) {
+    auto now = Clock::now();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const DownloadAttempt& attempt : attempts) {
+            if (attempt.cancelled || attempt.superseded) continue;
+            Mirror& mirror = Get(attempt.mirror);
+            if (attempt.rateLimited || attempt.statusCode == 429 || attempt.statusCode >= 500 || attempt.stalled) {
+                Congested(attempt.mirror, mirror, now);
+            } else if (attempt.success) {
+                Completed(attempt.mirror, mirror, attempt.bytes, now);
+            }
+        }
+    }
+    // A higher limit may let a waiting download start
+    m_cv.notify_all();
+}
+
+std::vector<MirrorSlots> MirrorConcurrency::GetSlots() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<MirrorSlots> slots;
+    for (const auto& entry : m_mirrors) {
+        if (entry.first.empty()) continue;
+        slots.push_back({ entry.first, entry.second.active, entry.second.limit });
+    }
+    return slots;
+}
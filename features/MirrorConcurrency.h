@@ -0,0 +1,70 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "HedgedDownload.h"
+
+struct MirrorSlots {
+    std::string mirror;
+    int active = 0;
+    int limit = 0;
+};
+
+// How many downloads each mirror gets at once. The limit is tuned AIMD-style:
+// it halves when a mirror answers 429/5xx or stalls, and grows by one while
+// adding a download keeps raising the mirror's total throughput. A probe that
+// gains nothing is taken back.
+class MirrorConcurrency {
+public:
+    static MirrorConcurrency& Instance() {
+        static MirrorConcurrency instance;
+        return instance;
+    }
+
+    // Takes a slot on the first of the mirrors that has one free, waiting while
+    // they are all busy (onWait is called once if it has to). Returns the index
+    // of that mirror, or -1 if the token was cancelled first.
+    int Acquire(const std::vector<std::string>& mirrors, const network::CancelTokenPtr& cancel,
+                const std::function<void()>& onWait = nullptr);
+    // Same without waiting; -1 if they are all busy
+    int TryAcquire(const std::vector<std::string>& mirrors);
+    void Release(const std::string& mirror);
+
+    // Feeds the attempts of a finished download into the limits
+    void Record(const std::vector<DownloadAttempt>& attempts);
+
+    std::vector<MirrorSlots> GetSlots() const;
+
+private:
+    MirrorConcurrency() = default;
+    ~MirrorConcurrency() = default;
+    MirrorConcurrency(const MirrorConcurrency&) = delete;
+    MirrorConcurrency& operator=(const MirrorConcurrency&) = delete;
+
+    using Clock = std::chrono::steady_clock;
+
+    struct Mirror {
+        int active = 0;
+        int limit = 0;
+        int peakActive = 0;          // Most downloads running at once since the last change
+        bool probing = false;        // Last change was an increase that has not paid off yet
+        double baselineBps = 0;      // Total throughput when the limit last changed
+        Clock::time_point lastChange;
+        std::deque<std::pair<Clock::time_point, double>> completions; // Finished bytes, for the total rate
+    };
+
+    Mirror& Get(const std::string& mirror);
+    // Index of the first mirror with a free slot, which it takes; m_mutex must be held
+    int TakeFree(const std::vector<std::string>& mirrors);
+    void Congested(const std::string& name, Mirror& mirror, Clock::time_point now);
+    void Completed(const std::string& name, Mirror& mirror, double bytes, Clock::time_point now);
+
+    std::map<std::string, Mirror> m_mirrors;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cv;
+};
@@ -0,0 +1,67 @@
+#include "MirrorHealth.h"
+#include "providers/ProviderRegistry.h"
+#include <algorithm>
+
+// Weight of the newest sample in the smoothed averages
+static const double kSmoothing = 0.3;
+
+static double Blend(double average, double sample) {
+    return average > 0 ? average + kSmoothing * (sample - average) : sample;
+}
+
+void MirrorHealth::RecordSuccess(const std::string& mirror, double bytes, double seconds, double ttfbSeconds) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    MirrorStats& stats = m_stats[mirror];
+    stats.successes++;
+    if (seconds > 0 && bytes > 0) stats.throughputBps = Blend(stats.throughputBps, bytes / seconds);
+    if (ttfbSeconds > 0) stats.ttfbSeconds = Blend(stats.ttfbSeconds, ttfbSeconds);
+}
+
+void MirrorHealth::RecordFailure(const std::string& mirror) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats[mirror].failures++;
+}
+
+MirrorStats MirrorHealth::GetStats(const std::string& mirror) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_stats.find(mirror);
+    return it != m_stats.end() ? it->second : MirrorStats();
+}
+
+double MirrorHealth::Score(const MirrorStats& stats) const {
+    // Throughput discounted by the success rate (Laplace smoothed so one failure is not fatal)
+    double successRate = (stats.successes + 1.0) / (stats.successes + stats.failures + 2.0);
+    return stats.throughputBps * successRate;
+}
+
+std::vector<std::string> MirrorHealth::Rank() const {
+    std::vector<std::string> names = ProviderRegistry::Instance().GetProviderNames();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<std::pair<double, std::string>> measured;
+    std::vector<std::string> unmeasured;
+    for (const auto& name : names) {
+        auto it = m_stats.find(name);
+        if (it != m_stats.end() && it->second.throughputBps > 0) {
+            measured.emplace_back(Score(it->second), name);
+        } else {
+            unmeasured.push_back(name);
+        }
+    }
+
+    std::stable_sort(measured.begin(), measured.end(),
+                     [](const auto& a, const auto& b) { return a.first > b.first; });
+    // Mirrors that only ever failed go last
+    std::stable_sort(unmeasured.begin(), unmeasured.end(), [this](const std::string& a, const std::string& b) {
+        auto failed = [this](const std::string& name) {
+            auto it = m_stats.find(name);
+            return it != m_stats.end() && it->second.failures > 0;
+        };
+        return !failed(a) && failed(b);
+    });
+
+    std::vector<std::string> ranked;
+    for (const auto& entry : measured) ranked.push_back(entry.second);
+    ranked.insert(ranked.end(), unmeasured.begin(), unmeasured.end());
+    return ranked;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct MirrorStats {
+    double throughputBps = 0;   // Smoothed download speed, 0 until measured
+    double ttfbSeconds = 0;     // Smoothed time to first byte
+    int successes = 0;
+    int failures = 0;
+};
+
+// Observed performance of each download mirror, fed by finished downloads and
+// speedtests. Used to pick which mirror to try next.
+class MirrorHealth {
+public:
+    static MirrorHealth& Instance() {
+        static MirrorHealth instance;
+        return instance;
+    }
+
+    void RecordSuccess(const std::string& mirror, double bytes, double seconds, double ttfbSeconds);
+    void RecordFailure(const std::string& mirror);
+    MirrorStats GetStats(const std::string& mirror) const;
+
+    // Registered mirrors, healthiest first; unmeasured ones follow in registry order
+    std::vector<std::string> Rank() const;
+
+private:
+    MirrorHealth() = default;
+    ~MirrorHealth() = default;
+    MirrorHealth(const MirrorHealth&) = delete;
+    MirrorHealth& operator=(const MirrorHealth&) = delete;
+
+    double Score(const MirrorStats& stats) const;
+
+    std::map<std::string, MirrorStats> m_stats;
+    mutable std::mutex m_mutex;
+};
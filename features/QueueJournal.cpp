@@ -0,0 +1,192 @@
+#include "QueueJournal.h"
+#include "utils/logging.h"
+#include "utils/Utf8.h"
+#include <windows.h>
+#include <nlohmann/json.hpp>
+#include <chrono>
+#include <fstream>
+
+// A burst of operations (a batch being queued) is collected for this long and written at once
+static const std::chrono::milliseconds kBatchDelay(250);
+// The file is rewritten once it is this long and mostly finished items
+static const size_t kCompactLines = 256;
+static const size_t kCompactRatio = 4;
+
+std::string QueueJournal::AddLine(const JournalItem& item) {
+    nlohmann::json json;
+    json["op"] = "add";
+    json["ticket"] = item.ticket;
+    json["id"] = ToUtf8(item.id);
+    json["beatmap"] = item.isBeatmapId;
+    json["artist"] = ToUtf8(item.artist);
+    json["title"] = ToUtf8(item.title);
+    json["priority"] = (int)item.priority;
+    json["paused"] = item.paused;
+    return json.dump();
+}
+
+bool QueueJournal::Apply(const std::string& line, std::map<uint64_t, JournalItem>& live) {
+    try {
+        nlohmann::json json = nlohmann::json::parse(line);
+        std::string op = json.at("op").get<std::string>();
+        uint64_t ticket = json.at("ticket").get<uint64_t>();
+        if (op == "add") {
+            JournalItem item;
+            item.ticket = ticket;
+            item.id = FromUtf8(json.at("id").get<std::string>());
+            item.isBeatmapId = json.value("beatmap", false);
+            item.artist = FromUtf8(json.value("artist", ""));
+            item.title = FromUtf8(json.value("title", ""));
+            item.priority = (DownloadPriority)json.value("priority", (int)DownloadPriority::UserAction);
+            item.paused = json.value("paused", false);
+            live[ticket] = item;
+        } else if (op == "remove") {
+            live.erase(ticket);
+        } else if (op == "priority") {
+            auto it = live.find(ticket);
+            if (it != live.end()) it->second.priority = (DownloadPriority)json.at("priority").get<int>();
+        } else if (op == "pause") {
+            auto it = live.find(ticket);
+            if (it != live.end()) it->second.paused = json.at("paused").get<bool>();
+        } else {
+            return false;
+        }
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+std::vector<JournalItem> QueueJournal::Open(const std::wstring& path) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_running) return {};
+    m_path = path;
+
+    std::map<uint64_t, JournalItem> live;
+    size_t skipped = 0;
+    std::ifstream in(path);
+    if (in.is_open()) {
+        std::string line;
+        while (std::getline(in, line)) {
+            if (!line.empty() && !Apply(line, live)) skipped++;
+        }
+    }
+    if (skipped > 0) {
+        LogWarning("Skipped " + std::to_string(skipped) + " unreadable line(s) in the queue journal");
+    }
+
+    std::vector<JournalItem> items;
+    for (const auto& entry : live) items.push_back(entry.second);
+
+    // The caller queues the items again under new tickets; the first write replaces the old file
+    m_live.clear();
+    m_pending.clear();
+    m_fileLines = 0;
+    m_compact = true;
+    m_running = true;
+    m_thread = std::thread(&QueueJournal::WriterThread, this);
+    return items;
+}
+
+void QueueJournal::Close() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_running) return;
+        m_running = false;
+    }
+    m_cv.notify_all();
+    if (m_thread.joinable()) m_thread.join();
+}
+
+void QueueJournal::Added(const JournalItem& item) {
+    std::string line = AddLine(item);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_running) return;
+    m_live[item.ticket] = item;
+    Append(std::move(line));
+}
+
+void QueueJournal::Removed(uint64_t ticket) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_running) return;
+    m_live.erase(ticket);
+    Append("{\"op\":\"remove\",\"ticket\":" + std::to_string(ticket) + "}");
+}
+
+void QueueJournal::PriorityChanged(uint64_t ticket, DownloadPriority priority) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_running) return;
+    auto it = m_live.find(ticket);
+    if (it != m_live.end()) it->second.priority = priority;
+    Append("{\"op\":\"priority\",\"ticket\":" + std::to_string(ticket) + ",\"priority\":" + std::to_string((int)priority) + "}");
+}
+
+void QueueJournal::PausedChanged(uint64_t ticket, bool paused) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_running) return;
+    auto it = m_live.find(ticket);
+    if (it != m_live.end()) it->second.paused = paused;
+    Append("{\"op\":\"pause\",\"ticket\":" + std::to_string(ticket) + ",\"paused\":" + (paused ? "true" : "false") + "}");
+}
+
+void QueueJournal::Append(std::string line) {
+    bool first = m_pending.empty();
+    m_pending.push_back(std::move(line));
+    if (first) m_cv.notify_all();
+}
+
+bool QueueJournal::WriteLines(const std::vector<std::string>& lines) {
+    std::ofstream out(m_path, std::ios::app | std::ios::binary);
+    if (!out.is_open()) return false;
+    for (const std::string& line : lines) out << line << '\n';
+    out.flush();
+    return out.good();
+}
+
+bool QueueJournal::Compact(const std::vector<std::string>& lines) {
+    // Written aside and moved over the journal, so a crash leaves either the old or the new file
+    std::wstring tempPath = m_path + L".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::trunc | std::ios::binary);
+        if (!out.is_open()) return false;
+        for (const std::string& line : lines) out << line << '\n';
+        out.flush();
+        if (!out.good()) return false;
+    }
+    return MoveFileExW(tempPath.c_str(), m_path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+}
+
+void QueueJournal::WriterThread() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_cv.wait(lock, [this] { return !m_pending.empty() || !m_running; });
+        if (m_pending.empty()) break;
+        if (m_running) {
+            m_cv.wait_for(lock, kBatchDelay, [this] { return !m_running; });
+        }
+
+        std::vector<std::string> lines;
+        lines.swap(m_pending);
+        size_t total = m_fileLines + lines.size();
+        bool compact = m_compact || (total > kCompactLines && total > kCompactRatio * m_live.size());
+        // m_live already includes every line taken above, so it replaces them too
+        std::vector<std::string> snapshot;
+        if (compact) {
+            for (const auto& entry : m_live) snapshot.push_back(AddLine(entry.second));
+        }
+
+        // The file is written without the lock, so queue operations never wait for the disk
+        lock.unlock();
+        bool written = compact ? Compact(snapshot) : WriteLines(lines);
+        lock.lock();
+
+        if (written) {
+            m_fileLines = compact ? snapshot.size() : total;
+            if (compact) m_compact = false;
+        } else {
+            LogWarning("Failed to write the queue journal");
+            // What the file holds is uncertain now; the next write replaces it
+            m_compact = true;
+        }
+    }
+}
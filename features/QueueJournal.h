@@ -0,0 +1,70 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "download_queue.h"
+
+// An item that was still queued, running or paused when the journal was last written
+struct JournalItem {
+    uint64_t ticket = 0;
+    std::wstring id;
+    bool isBeatmapId = false;
+    std::wstring artist;
+    std::wstring title;
+    DownloadPriority priority = DownloadPriority::UserAction;
+    bool paused = false;
+};
+
+// Append-only log of queue operations, one JSON object per line, so the queue
+// survives osu! closing or crashing. Operations are only buffered by the caller;
+// a writer thread appends them in batches and compacts the file to the live
+// items once most of its lines describe finished downloads. A torn last line
+// from a crash is skipped when the journal is read back.
+class QueueJournal {
+public:
+    static QueueJournal& Instance() {
+        static QueueJournal instance;
+        return instance;
+    }
+
+    // Reads the journal at path and starts the writer. Returns the items that were
+    // still live, oldest first; the caller queues them again under new tickets.
+    std::vector<JournalItem> Open(const std::wstring& path);
+    // Writes out everything still buffered and stops the writer
+    void Close();
+
+    void Added(const JournalItem& item);
+    // Finished, failed or cancelled
+    void Removed(uint64_t ticket);
+    void PriorityChanged(uint64_t ticket, DownloadPriority priority);
+    void PausedChanged(uint64_t ticket, bool paused);
+
+private:
+    QueueJournal() = default;
+    ~QueueJournal() { Close(); }
+    QueueJournal(const QueueJournal&) = delete;
+    QueueJournal& operator=(const QueueJournal&) = delete;
+
+    // Applies one line to the live items; false if it can't be parsed
+    static bool Apply(const std::string& line, std::map<uint64_t, JournalItem>& live);
+    static std::string AddLine(const JournalItem& item);
+    void Append(std::string line);
+    void WriterThread();
+    // Writer thread: appends lines, or rewrites the file from the live items
+    bool WriteLines(const std::vector<std::string>& lines);
+    bool Compact(const std::vector<std::string>& lines);
+
+    std::wstring m_path;
+    std::map<uint64_t, JournalItem> m_live;   // What the journal says once every buffered line is written
+    std::vector<std::string> m_pending;       // Lines not written yet
+    size_t m_fileLines = 0;                   // Lines in the file, live or not
+    bool m_compact = false;                   // Rewrite at the next write, e.g. after Open
+    bool m_running = false;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::thread m_thread;
+};
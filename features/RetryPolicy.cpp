@@ -0,0 +1,45 @@
+#include "RetryPolicy.h"
+#include "config/config_manager.h"
+#include <algorithm>
+#include <random>
+
+FailureClass ClassifyFailure(const DownloadAttempt& attempt) {
+    if (attempt.cancelled) return FailureClass::Fatal;
+    if (attempt.stalled || attempt.superseded) return FailureClass::Transient;
+    if (attempt.invalidPayload) return FailureClass::Mirror;
+    // Errors from our side of the transfer; another mirror would hit them too
+    if (attempt.localError) return FailureClass::Fatal;
+
+    long status = attempt.statusCode;
+    if (status == 408 || status == 425 || status == 429 || status >= 500) return FailureClass::Transient;
+    if (status >= 400) return FailureClass::Mirror;
+    // No HTTP status: DNS, connect, TLS, timeout or reset, all worth another try later
+    return FailureClass::Transient;
+}
+
+const char* FailureClassName(FailureClass failureClass) {
+    switch (failureClass) {
+        case FailureClass::Transient: return "transient";
+        case FailureClass::Mirror: return "mirror";
+        case FailureClass::Fatal: return "fatal";
+    }
+    return "";
+}
+
+RetryPolicy RetryPolicy::FromConfig() {
+    RetryPolicy policy;
+    policy.retries = ConfigManager::Instance().GetRetryCount();
+    policy.baseDelay = std::chrono::milliseconds(ConfigManager::Instance().GetRetryBaseDelayMs());
+    policy.maxDelay = std::chrono::milliseconds(ConfigManager::Instance().GetRetryMaxDelayMs());
+    return policy;
+}
+
+std::chrono::milliseconds RetryPolicy::Backoff(int retry) const {
+    long long delay = baseDelay.count();
+    for (int i = 1; i < retry && delay < maxDelay.count(); ++i) delay *= 2;
+    delay = (std::min)(delay, (long long)maxDelay.count());
+
+    static thread_local std::mt19937 random(std::random_device{}());
+    std::uniform_int_distribution<long long> jitter(0, delay / 2);
+    return std::chrono::milliseconds(delay - delay / 2 + jitter(random));
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <chrono>
+#include "HedgedDownload.h"
+
+// What a failed attempt says about trying again
+enum class FailureClass {
+    Transient, // Timeouts, resets, 5xx, 429 and stalls: the same mirror may work after a pause
+    Mirror,    // 404, error pages, broken archives: this mirror can't serve the file, the others might
+    Fatal      // Local problems such as a full disk, or the user cancelled: no mirror can help
+};
+
+FailureClass ClassifyFailure(const DownloadAttempt& attempt);
+const char* FailureClassName(FailureClass failureClass);
+
+// How often a download goes back over the mirrors that failed transiently, and how long it waits first
+struct RetryPolicy {
+    int retries = 2;
+    std::chrono::milliseconds baseDelay{1000};
+    std::chrono::milliseconds maxDelay{15000};
+
+    static RetryPolicy FromConfig();
+
+    // Pause before retry number retry (from 1): doubles each time up to maxDelay, and half of
+    // it is random so clients that failed together don't come back together
+    std::chrono::milliseconds Backoff(int retry) const;
+};
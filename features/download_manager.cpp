@@ -3,42 +3,41 @@
 #include <iostream>
 #include "utils/logging.h"
 #include "network/HttpRequest.h"
+#include "network/PartFile.h"
+#include "network/RateLimiter.h"
 #include <shlobj.h>
 #include <shellapi.h>
 #include "config/config_manager.h"
 #include "notification_manager.h"
 #include <filesystem>
-#include <mutex>
 #include <memory>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <algorithm>
 #include "providers/ProviderRegistry.h"
 #include "providers/Resolver.h"
 #include "HistoryManager.h"
 #include "features/database/database.h"
+#include "MirrorHealth.h"
+#include "MirrorConcurrency.h"
+#include "RetryPolicy.h"
+#include "DownloadTable.h"
+#include "InFlightDownloads.h"
+#include "DownloadStages.h"
 
 namespace fs = std::filesystem;
 
-// Global state
-static DownloadState g_DownloadState;
-static std::mutex g_StateMutex;
 static OsuDatabase g_OsuDb;
 
-DownloadState GetDownloadState() {
-    std::lock_guard<std::mutex> lock(g_StateMutex);
-    return g_DownloadState;
-}
-
-static void UpdateDownloadState(const std::wstring& id, const std::wstring& name, int prog, size_t dl, size_t total, bool active) {
-    std::lock_guard<std::mutex> lock(g_StateMutex);
-    g_DownloadState.beatmapId = id;
-    g_DownloadState.filename = name;
-    g_DownloadState.progress = prog;
-    g_DownloadState.downloadedBytes = dl;
-    g_DownloadState.totalBytes = total;
-    g_DownloadState.isDownloading = active;
-}
-
 bool InitializeDownloadManager() {
     network::HttpRequest::GlobalInit();
+    network::HttpRequest::SetMemoryMappedOutput(ConfigManager::Instance().GetMemoryMappedOutput());
+    network::HttpRequest::SetBandwidthLimits(ConfigManager::Instance().GetGlobalLimitKBps(),
+                                             ConfigManager::Instance().GetBackgroundLimitKBps());
+    network::HttpRequest::EnableResponseCache(ConfigManager::Instance().GetConfigDirectory() + L"\\cache");
+    network::HttpRequest::EnableSessionCache(ConfigManager::Instance().GetConfigDirectory() + L"\\sessions.json");
+    DownloadTable::Instance().Start();
     
     // Dynamic osu! root path
     wchar_t localAppData[MAX_PATH];
@@ -61,10 +60,26 @@ bool InitializeDownloadManager() {
 }
 
 void CleanupDownloadManager() {
+    DownloadTable::Instance().Stop();
     network::HttpRequest::GlobalCleanup();
     LogInfo("Download manager cleaned up");
 }
 
+void PrewarmConnections() {
+    std::vector<std::string> urls = { Resolver::GetOrigin() };
+
+    // Mirrors serve metadata from the same host as downloads, so a download URL names the host
+    int indices[] = { ConfigManager::Instance().GetDownloadMirrorIndex(), ConfigManager::Instance().GetMetadataMirrorIndex() };
+    for (int index : indices) {
+        std::unique_ptr<Provider> provider = ProviderRegistry::Instance().CreateProvider(index);
+        if (provider) {
+            urls.push_back(provider->GetDownloadUrl(L"1", false));
+        }
+    }
+
+    network::HttpRequest::Prewarm(urls);
+}
+
 bool CheckIfMapExists(const std::wstring& beatmapId) {
     try {
         int setId = std::stoi(beatmapId);
@@ -78,7 +93,53 @@ bool CheckIfMapExists(const std::wstring& beatmapId) {
     return false;
 }
 
-bool TryDownloadFromUrl(const std::string& downloadUrl, const std::wstring& filename, const std::wstring& beatmapId, const std::wstring& title) {
+bool IsInOsuDatabase(int id, bool isBeatmapId) {
+    return isBeatmapId ? g_OsuDb.GetBeatmapIds().count(id) != 0 : g_OsuDb.GetSetIds().count(id) != 0;
+}
+
+// One line of the attempt log, e.g. "Catboy: HTTP 503 (transient), 1.2 s"
+static std::string DescribeAttempt(const DownloadAttempt& attempt) {
+    char seconds[32];
+    snprintf(seconds, sizeof(seconds), "%.1f s", attempt.seconds);
+    std::string line = (attempt.mirror.empty() ? std::string("direct") : attempt.mirror) + ": ";
+    if (attempt.success) {
+        char size[32];
+        snprintf(size, sizeof(size), "%.1f MB", attempt.bytes / (1024.0 * 1024.0));
+        return line + "OK, " + size + " in " + seconds;
+    }
+    line += attempt.error.empty() ? std::string("failed") : attempt.error;
+    if (!attempt.superseded) line += std::string(" (") + FailureClassName(ClassifyFailure(attempt)) + ")";
+    return line + ", " + seconds;
+}
+
+// Shortest time until one of the mirrors accepts requests again, zero if one does now
+static std::chrono::milliseconds RateLimitDelay(const std::vector<DownloadCandidate>& chain) {
+    std::chrono::milliseconds shortest = std::chrono::milliseconds::max();
+    for (const auto& candidate : chain) {
+        shortest = (std::min)(shortest, network::RateLimiter::Instance().Delay(candidate.url));
+    }
+    return chain.empty() ? std::chrono::milliseconds(0) : shortest;
+}
+
+// Sleeps in short steps so the token can interrupt it; false if it did
+static bool WaitUnlessCancelled(std::chrono::milliseconds delay, const network::CancelTokenPtr& cancel) {
+    auto until = std::chrono::steady_clock::now() + delay;
+    while (std::chrono::steady_clock::now() < until && !(cancel && cancel->IsCancelled())) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    return !(cancel && cancel->IsCancelled());
+}
+
+// A paused download shows no result; the queue lists it until it runs again
+static void FinishCancelled(const std::wstring& key, const network::CancelTokenPtr& cancel) {
+    if (cancel && cancel->IsSuspended()) DownloadTable::Instance().Remove(key);
+    else DownloadTable::Instance().Finish(key, DownloadPhase::Cancelled);
+}
+
+bool TryDownloadFromMirrors(const std::vector<DownloadCandidate>& candidates, const std::wstring& filename, const std::wstring& beatmapId, const std::wstring& title,
+                            network::CancelTokenPtr cancel, const StageRank& rank) {
+    if (candidates.empty()) return false;
+
     // Dynamic download path
     wchar_t localAppData[MAX_PATH];
     std::wstring songsPath;
@@ -96,54 +157,132 @@ bool TryDownloadFromUrl(const std::string& downloadUrl, const std::wstring& file
     if (GetFileAttributesW(songsPath.c_str()) == INVALID_FILE_ATTRIBUTES) {
         if (!CreateDirectoryW(songsPath.c_str(), NULL)) {
              LogError("Downloads directory does not exist and could not be created.");
-             UpdateDownloadState(beatmapId, L"Error: No Downloads Dir", 0, 0, 0, false);
+             DownloadTable::Instance().Finish(beatmapId, DownloadPhase::Failed, L"No Downloads folder");
              HistoryManager::Instance().AddEntry({title, beatmapId, "Failed (No Downloads Dir)", std::time(nullptr)});
              return false;
         }
     }
 
-    LogInfo("Starting download from: " + downloadUrl);
+    LogInfo("Starting download from: " + candidates[0].url);
+
+    DownloadTable& table = DownloadTable::Instance();
+    table.Begin(beatmapId, title);
+    auto onProgress = [&](double dlNow, double dlTotal) {
+            table.Progress(beatmapId, dlNow, dlTotal);
+        };
+
+    // Every mirror is tried in order; the ones that failed transiently get further
+    // passes after a backoff, and a local failure stops the whole chain
+    RetryPolicy policy = RetryPolicy::FromConfig();
+    std::vector<DownloadCandidate> chain = candidates;
+    std::vector<DownloadAttempt> attempts;
+    HedgeOutcome outcome;
+
+    // A transfer slot first; each mirror the download then runs on takes a slot of its own (see RunHedgedDownload)
+    StageSlot transfer(PipelineStage::Transfer, rank, cancel, [&] {
+        table.SetPhase(beatmapId, DownloadPhase::Connecting, L"Waiting for other downloads...");
+    });
+    auto onWaitForMirror = [&] {
+        table.SetPhase(beatmapId, DownloadPhase::Connecting, L"Waiting for a free mirror...");
+    };
 
-    // Use HttpRequest
-    std::string error;
-    bool success = network::HttpRequest::Download(downloadUrl, fullPath, 
-        [&](double dlNow, double dlTotal) {
-            if (dlTotal > 0) {
-                int progress = (int)((dlNow / dlTotal) * 100.0);
-                UpdateDownloadState(beatmapId, filename, progress, (size_t)dlNow, (size_t)dlTotal, true);
+    for (int round = 0; transfer; ++round) {
+        // With every mirror rate limiting us, asking any of them only earns another 429
+        auto limited = RateLimitDelay(chain);
+        if (limited.count() > 0) {
+            LogInfo("All mirrors are rate limited, waiting " + std::to_string(limited.count()) + " ms");
+            table.SetPhase(beatmapId, DownloadPhase::Connecting,
+                           L"Waiting for rate limit (" + std::to_wstring((limited.count() + 999) / 1000) + L" s)...");
+            if (!WaitUnlessCancelled(limited, cancel)) {
+                outcome.cancelled = true;
+                break;
             }
-        }, 
-        &error
-    );
+        }
+
+        table.SetPhase(beatmapId, DownloadPhase::Connecting);
+        table.SetMirror(beatmapId, chain[0].mirror);
+        outcome = RunHedgedDownload(chain, fullPath, onProgress,
+                                    0, // Stall detection replaces an overall time limit
+                                    ConfigManager::Instance().GetHedgedDownloads(), cancel, onWaitForMirror);
+        attempts.insert(attempts.end(), outcome.attempts.begin(), outcome.attempts.end());
+        if (outcome.success || outcome.cancelled) break;
 
-    if (success) {
+        std::vector<DownloadCandidate> retry;
+        bool fatal = false;
+        for (const auto& candidate : chain) {
+            auto last = std::find_if(outcome.attempts.rbegin(), outcome.attempts.rend(),
+                                     [&](const DownloadAttempt& attempt) { return attempt.mirror == candidate.mirror; });
+            if (last == outcome.attempts.rend()) continue;
+            FailureClass failure = ClassifyFailure(*last);
+            if (failure == FailureClass::Fatal) fatal = true;
+            if (failure == FailureClass::Transient) retry.push_back(candidate);
+        }
+        if (fatal || retry.empty() || round >= policy.retries) break;
+
+        // A mirror's Retry-After outranks our own backoff when it is longer
+        auto delay = (std::max)(policy.Backoff(round + 1), RateLimitDelay(retry));
+        LogInfo("Retrying " + std::to_string(retry.size()) + " mirror(s) in " + std::to_string(delay.count()) +
+                " ms (retry " + std::to_string(round + 1) + " of " + std::to_string(policy.retries) + ")");
+        table.SetPhase(beatmapId, DownloadPhase::Connecting, L"Retrying in " + std::to_wstring((delay.count() + 999) / 1000) + L" s...");
+        if (!WaitUnlessCancelled(delay, cancel)) {
+            outcome.cancelled = true;
+            break;
+        }
+        chain = retry;
+    }
+    if (!transfer) outcome.cancelled = true;
+    else MirrorConcurrency::Instance().Record(attempts);
+    // Import has a stage of its own; the next download can start now
+    transfer.Release();
+    const std::string& error = outcome.error;
+
+    // Each attempt is kept with the history entry, one per line
+    std::string details;
+    if (attempts.size() > 1 || !outcome.success) {
+        for (size_t i = 0; i < attempts.size(); ++i) {
+            if (!details.empty()) details += "\n";
+            details += std::to_string(i + 1) + ". " + DescribeAttempt(attempts[i]);
+        }
+    }
+
+    // The transport checked the archive before moving it into place (see HttpResult::invalidPayload);
+    // a broken one failed its attempt and went on to the next mirror
+    if (outcome.success) {
+        if (!outcome.mirror.empty()) table.SetMirror(beatmapId, outcome.mirror);
         LogInfo("Successfully downloaded: " + std::string(filename.begin(), filename.end()));
-        UpdateDownloadState(beatmapId, L"Complete", 100, 0, 0, false);
-        HistoryManager::Instance().AddEntry({title, beatmapId, "Success", std::time(nullptr)});
+        HistoryManager::Instance().AddEntry({title, beatmapId, "Success", std::time(nullptr), details});
 
         if (ConfigManager::Instance().GetAutoOpen()) {
+            table.SetPhase(beatmapId, DownloadPhase::Importing);
+            StageSlot importing(PipelineStage::Import, rank, nullptr);
             ShellExecuteW(NULL, L"open", fullPath.c_str(), NULL, NULL, SW_HIDE);
         }
+        table.Finish(beatmapId, DownloadPhase::Complete);
         return true;
+    } else if (outcome.cancelled && cancel && cancel->IsSuspended()) {
+        // The partial file stays, so the download picks up where it stopped when it is resumed
+        LogInfo("Download paused: " + std::string(filename.begin(), filename.end()));
+        FinishCancelled(beatmapId, cancel);
+        return false;
+    } else if (outcome.cancelled) {
+        LogInfo("Download cancelled: " + std::string(filename.begin(), filename.end()));
+        network::PartFile::Discard(fullPath);
+        table.Finish(beatmapId, DownloadPhase::Cancelled);
+        HistoryManager::Instance().AddEntry({title, beatmapId, "Cancelled", std::time(nullptr), details});
+        return false;
     } else {
         LogError("Download failed: " + error);
-        UpdateDownloadState(beatmapId, L"Failed", 0, 0, 0, false);
-        HistoryManager::Instance().AddEntry({title, beatmapId, "Failed", std::time(nullptr)});
+        table.Finish(beatmapId, DownloadPhase::Failed, std::wstring(error.begin(), error.end()));
+        HistoryManager::Instance().AddEntry({title, beatmapId, "Failed", std::time(nullptr), details});
         return false;
     }
 }
 
-bool DownloadBeatmap(const std::wstring& id, bool isBeatmapId, const std::wstring& artist, const std::wstring& title) {
-    // 1. Resolve ID to SetID
-    std::wstring beatmapsetId = id;
-    if (isBeatmapId) {
-        beatmapsetId = Resolver::ResolveSetIdFromBeatmapId(id);
-        if (beatmapsetId.empty()) {
-            LogError("Failed to resolve BeatmapSet ID from Beatmap ID: " + std::string(id.begin(), id.end()));
-            UpdateDownloadState(id, L"Failed (ID Resolution)", 0, 0, 0, false);
-            return false;
-        }
-    }
+// Steps 2 and 3 of DownloadBeatmap, once the set ID is known
+static bool DownloadBeatmapSet(const std::wstring& id, const std::wstring& beatmapsetId, const std::wstring& artist,
+                               const std::wstring& title, const network::CancelTokenPtr& cancel, const StageRank& rank) {
+    auto cancelled = [&cancel]() { return cancel && cancel->IsCancelled(); };
+    DownloadTable& table = DownloadTable::Instance();
 
     // 2. Fetch Metadata using Metadata Mirror
     int metadataMirrorIndex = ConfigManager::Instance().GetMetadataMirrorIndex();
@@ -159,6 +298,22 @@ bool DownloadBeatmap(const std::wstring& id, bool isBeatmapId, const std::wstrin
         // Let's try to proceed with default filename if metadata fails, but user asked for specific format.
     }
 
+    // A metadata mirror that is rate limiting us would only refuse; ask another one, or go without
+    if (metadataProvider && artist.empty() && metadataProvider->GetBeatmapSetInfoDelay(beatmapsetId).count() > 0) {
+        std::unique_ptr<Provider> alternative;
+        for (const auto& name : MirrorHealth::Instance().Rank()) {
+            std::unique_ptr<Provider> candidate = ProviderRegistry::Instance().CreateProvider(name);
+            if (candidate && name != metadataProvider->GetName() && candidate->SupportsBeatmapSetInfo() &&
+                candidate->GetBeatmapSetInfoDelay(beatmapsetId).count() == 0) {
+                alternative = std::move(candidate);
+                break;
+            }
+        }
+        LogInfo(metadataProvider->GetName() + " is rate limited, " +
+                (alternative ? "fetching metadata from " + alternative->GetName() : std::string("skipping metadata")));
+        metadataProvider = std::move(alternative);
+    }
+
     std::wstring filename = beatmapsetId + L".osz";
     std::wstring finalTitle = beatmapsetId; // Default title is ID
 
@@ -182,7 +337,14 @@ bool DownloadBeatmap(const std::wstring& id, bool isBeatmapId, const std::wstrin
         filename = beatmapsetId + L" " + safeArtist + L" - " + safeTitle + L".osz";
         finalTitle = safeArtist + L" - " + safeTitle;
     } else if (metadataProvider) {
-        auto info = metadataProvider->GetBeatmapSetInfo(beatmapsetId);
+        table.SetPhase(beatmapsetId, DownloadPhase::Metadata);
+        std::optional<BeatmapSetInfo> info;
+        {
+            StageSlot fetching(PipelineStage::Metadata, rank, cancel, [&] {
+                table.SetPhase(beatmapsetId, DownloadPhase::Metadata, L"Queued...");
+            });
+            if (fetching) info = metadataProvider->GetBeatmapSetInfo(beatmapsetId, cancel);
+        }
         if (info.has_value()) {
             // Format: "{setid} Artist - Title"
             // We need to sanitize filename
@@ -201,44 +363,132 @@ bool DownloadBeatmap(const std::wstring& id, bool isBeatmapId, const std::wstrin
 
             filename = beatmapsetId + L" " + fetchedArtist + L" - " + fetchedTitle + L".osz";
             finalTitle = fetchedArtist + L" - " + fetchedTitle;
-        } else {
+            table.SetName(beatmapsetId, finalTitle);
+        } else if (!cancelled()) {
             LogInfo("Failed to fetch metadata using " + metadataProvider->GetName() + ", using default filename.");
         }
     }
 
+    if (cancelled()) {
+        FinishCancelled(beatmapsetId, cancel);
+        return false;
+    }
+
     // 3. Download using Download Mirror
     int downloadMirrorIndex = ConfigManager::Instance().GetDownloadMirrorIndex();
     std::unique_ptr<Provider> downloadProvider = ProviderRegistry::Instance().CreateProvider(downloadMirrorIndex);
 
     if (!downloadProvider) {
         LogError("Invalid download provider index: " + std::to_string(downloadMirrorIndex));
-        UpdateDownloadState(beatmapsetId, L"Failed (Invalid Provider)", 0, 0, 0, false);
+        table.Finish(beatmapsetId, DownloadPhase::Failed, L"Invalid download mirror");
         return false;
     }
 
     LogInfo("Starting download for ID: " + std::string(beatmapsetId.begin(), beatmapsetId.end()) + " using " + downloadProvider->GetName());
     
-    // Reset state
-    UpdateDownloadState(beatmapsetId, L"Initializing...", 0, 0, 0, true);
+    table.SetPhase(beatmapsetId, DownloadPhase::Connecting);
     
     if (CheckIfMapExists(beatmapsetId)) {
         LogInfo("Map already exists, skipping download.");
-        UpdateDownloadState(beatmapsetId, L"Skipped (Exists)", 100, 0, 0, false);
+        table.Finish(beatmapsetId, DownloadPhase::Skipped, L"Already in osu!");
         HistoryManager::Instance().AddEntry({finalTitle, beatmapsetId, "Skipped (Exists)", std::time(nullptr)});
         return true;
     }
 
-    std::string downloadUrl = downloadProvider->GetDownloadUrl(beatmapsetId, false); // We already resolved to SetID
-    LogDebug("Download URL: " + downloadUrl);
+    std::vector<DownloadCandidate> candidates;
+    candidates.push_back({ downloadProvider->GetName(), downloadProvider->GetDownloadUrl(beatmapsetId, false), // We already resolved to SetID
+                           ConfigManager::Instance().GetSegmentCount(downloadProvider->GetName()) });
+    LogDebug("Download URL: " + candidates[0].url);
+
+    // The other mirrors, healthiest first, take over if the selected one stalls or fails
+    for (const auto& name : MirrorHealth::Instance().Rank()) {
+        if (name == candidates[0].mirror) continue;
+        std::unique_ptr<Provider> backupProvider = ProviderRegistry::Instance().CreateProvider(name);
+        if (!backupProvider) continue;
+        candidates.push_back({ name, backupProvider->GetDownloadUrl(beatmapsetId, false),
+                               ConfigManager::Instance().GetSegmentCount(name) });
+    }
+
+    if (!TryDownloadFromMirrors(candidates, filename, beatmapsetId, finalTitle, cancel, rank)) {
+        // The user stopped it; the browser would only get in the way
+        if (cancelled()) return false;
 
-    if (!TryDownloadFromUrl(downloadUrl, filename, beatmapsetId, finalTitle)) {
         std::string osuUrl = "https://osu.ppy.sh/b/" + std::string(id.begin(), id.end()); // Use original ID for browser link if available
         LogInfo("Opening official osu! website...");
         ShellExecuteA(NULL, "open", osuUrl.c_str(), NULL, NULL, SW_SHOW);
         
-        UpdateDownloadState(beatmapsetId, L"Failed (Browser Opened)", 0, 0, 0, false);
+        table.Finish(beatmapsetId, DownloadPhase::Failed, L"Opened in the browser");
         return false;
     }
     
     return true;
 }
+
+bool DownloadBeatmap(const std::wstring& id, bool isBeatmapId, const std::wstring& artist, const std::wstring& title,
+                     network::CancelTokenPtr cancel, const StageRank& rank) {
+    auto cancelled = [&cancel]() { return cancel && cancel->IsCancelled(); };
+    std::string idText(id.begin(), id.end());
+
+    // A second request for a set already being downloaded shares that download's result
+    InFlightDownloads& flights = InFlightDownloads::Instance();
+    const std::wstring key = isBeatmapId ? InFlightDownloads::BeatmapKey(id) : InFlightDownloads::SetKey(id);
+    bool leader = false;
+    InFlightDownloads::FlightPtr flight = flights.Join(key, leader);
+    while (!leader) {
+        LogInfo("Already downloading " + idText + ", waiting for that download instead");
+        FlightEnd end = flights.Wait(flight, cancel);
+        // A paused or cancelled leader leaves the download to whoever still wants it
+        if (end != FlightEnd::Abandoned || cancelled()) return end == FlightEnd::Succeeded;
+        LogInfo("The download of " + idText + " was stopped, taking it over");
+        flight = flights.Join(key, leader);
+    }
+    FlightLeader lead(flight, cancel);
+
+    // Warms the mirrors while the ID is resolved; a no-op if they are already warm
+    PrewarmConnections();
+
+    DownloadTable& table = DownloadTable::Instance();
+    // Until it is resolved a beatmap ID has a key of its own, apart from the set with the same number
+    const std::wstring record = isBeatmapId ? DownloadTable::BeatmapKey(id) : id;
+    const std::wstring name = !artist.empty() && !title.empty() ? artist + L" - " + title : id;
+    table.Begin(record, name);
+
+    // 1. Resolve ID to SetID
+    std::wstring beatmapsetId = id;
+    if (isBeatmapId) {
+        {
+            StageSlot resolving(PipelineStage::Resolve, rank, cancel, [&] {
+                table.SetPhase(record, DownloadPhase::Resolving, L"Queued...");
+            });
+            if (!resolving) {
+                FinishCancelled(record, cancel);
+                return false;
+            }
+            beatmapsetId = Resolver::ResolveSetIdFromBeatmapId(id);
+        }
+        if (beatmapsetId.empty()) {
+            LogError("Failed to resolve BeatmapSet ID from Beatmap ID: " + idText);
+            table.Finish(record, DownloadPhase::Failed, L"Could not resolve the beatmap ID");
+            return false;
+        }
+
+        // The set may already be on its way under its own ID, or through another of its beatmaps
+        std::string setText(beatmapsetId.begin(), beatmapsetId.end());
+        InFlightDownloads::FlightPtr existing;
+        while ((existing = flights.Alias(InFlightDownloads::SetKey(beatmapsetId), flight)) != flight) {
+            LogInfo("Set " + setText + " of beatmap " + idText + " is already downloading, waiting for that download instead");
+            table.Remove(record);
+            FlightEnd end = flights.Wait(existing, cancel);
+            if (end != FlightEnd::Abandoned || cancelled()) return lead.Finish(end == FlightEnd::Succeeded);
+            LogInfo("The download of set " + setText + " was stopped, taking it over");
+            table.Begin(record, name);
+        }
+        table.Rekey(record, beatmapsetId);
+    }
+    if (cancelled()) {
+        FinishCancelled(beatmapsetId, cancel);
+        return false;
+    }
+
+    return lead.Finish(DownloadBeatmapSet(id, beatmapsetId, artist, title, cancel, rank));
+}
@@ -4,23 +4,24 @@
 
 #include <windows.h>
 #include <string>
-
-struct DownloadState {
-    std::wstring beatmapId;
-    std::wstring filename;
-    int progress;
-    size_t downloadedBytes;
-    size_t totalBytes;
-    bool isDownloading;
-};
-
-DownloadState GetDownloadState();
+#include <vector>
+#include "HedgedDownload.h"
+#include "DownloadTable.h"
+#include "DownloadStages.h"
 
 bool InitializeDownloadManager();
 void CleanupDownloadManager();
 bool CheckIfMapExists(const std::wstring& beatmapId);
-bool DownloadBeatmap(const std::wstring& id, bool isBeatmapId = false, const std::wstring& artist = L"", const std::wstring& title = L"");
-bool TryDownloadFromUrl(const std::string& downloadUrl, const std::wstring& filename, const std::wstring& beatmapId, const std::wstring& title);
+// Same check without logging, for filtering long lists; also knows single beatmaps
+bool IsInOsuDatabase(int id, bool isBeatmapId);
+// Cancelling the token stops the download at whatever step it is in; rank orders it in every stage's queue
+bool DownloadBeatmap(const std::wstring& id, bool isBeatmapId = false, const std::wstring& artist = L"", const std::wstring& title = L"",
+                     network::CancelTokenPtr cancel = nullptr, const StageRank& rank = StageRank::Now());
+// Downloads from the candidates in order, retrying transient failures with backoff (see RetryPolicy)
+bool TryDownloadFromMirrors(const std::vector<DownloadCandidate>& candidates, const std::wstring& filename, const std::wstring& beatmapId, const std::wstring& title,
+                            network::CancelTokenPtr cancel = nullptr, const StageRank& rank = StageRank::Now());
 void CheckClipboardForBeatmapLinks();
+// Opens connections to the selected mirrors and the resolver host in the background
+void PrewarmConnections();
 
 #endif
\ No newline at end of file
@@ -1,7 +1,30 @@
 #include "download_queue.h"
 #include "download_manager.h"
+#include "InFlightDownloads.h"
+#include "QueueJournal.h"
+#include "DownloadStages.h"
 #include "utils/logging.h"
+#include "utils/Utf8.h"
 #include "notification_manager.h"
+#include "config/config_manager.h"
+#include <algorithm>
+#include <iterator>
+
+// How long an item may wait before it ranks with a brand-new interactive one.
+// Interactive items themselves always run first.
+static const std::chrono::seconds kUserActionAging(30);
+static const std::chrono::seconds kBackgroundAging(300);
+// Workers per transfer slot, see Start
+static const int kWorkersPerTransfer = 2;
+
+const char* DownloadPriorityName(DownloadPriority priority) {
+    switch (priority) {
+        case DownloadPriority::Interactive: return "Interactive";
+        case DownloadPriority::UserAction: return "Normal";
+        case DownloadPriority::Background: return "Background";
+    }
+    return "";
+}
 
 DownloadQueue& DownloadQueue::Instance() {
     static DownloadQueue instance;
@@ -15,45 +38,336 @@ DownloadQueue::~DownloadQueue() {
 void DownloadQueue::Start() {
     if (m_running) return;
     m_running = true;
-    m_thread = std::thread(&DownloadQueue::WorkerThread, this);
-    LogInfo("Download queue worker started");
+
+    // Whatever was queued when osu! last closed or crashed; partial files pick up where they stopped
+    std::vector<JournalItem> restored =
+        QueueJournal::Instance().Open(ConfigManager::Instance().GetConfigDirectory() + L"\\queue.journal");
+    if (!restored.empty()) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const JournalItem& item : restored) {
+            std::wstring key = item.isBeatmapId ? InFlightDownloads::BeatmapKey(item.id) : InFlightDownloads::SetKey(item.id);
+            if (m_byKey.count(key)) continue;
+            AddItem(key, item.id, item.isBeatmapId, item.artist, item.title, item.priority, item.paused);
+        }
+        LogInfo("Restored " + std::to_string(restored.size()) + " download(s) from the last session");
+    }
+
+    // The worker setting is the number of transfers at once. Each worker walks one item
+    // through the stages, so twice as many let the next items resolve and fetch metadata
+    // while the current ones transfer.
+    int transfers = ConfigManager::Instance().GetDownloadWorkers();
+    DownloadStages::Instance().SetLimit(PipelineStage::Transfer, transfers);
+    int workers = transfers * kWorkersPerTransfer;
+    for (int i = 0; i < workers; ++i) {
+        m_threads.emplace_back(&DownloadQueue::WorkerThread, this);
+    }
+    LogInfo("Download queue started with " + std::to_string(workers) + " workers for " + std::to_string(transfers) + " transfers");
 }
 
 void DownloadQueue::Stop() {
     if (!m_running) return;
     m_running = false;
+    {
+        // Don't make shutdown wait for downloads to finish; their partial files are kept
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (uint64_t ticket : m_runningTickets) m_items.at(ticket).cancel->Suspend();
+    }
     m_cv.notify_all();
-    if (m_thread.joinable()) {
-        m_thread.join();
+    for (std::thread& thread : m_threads) {
+        if (thread.joinable()) thread.join();
     }
-    LogInfo("Download queue worker stopped");
+    m_threads.clear();
+    // What is left stays in the journal for the next start
+    QueueJournal::Instance().Close();
+    LogInfo("Download queue stopped");
 }
 
+DownloadQueue::RankKey DownloadQueue::MakeKey(const QueueItem& item) {
+    switch (item.priority) {
+        case DownloadPriority::Interactive: return RankKey(0, item.queuedAt, item.ticket);
+        case DownloadPriority::UserAction: return RankKey(1, item.queuedAt + kUserActionAging, item.ticket);
+        case DownloadPriority::Background: break;
+    }
+    return RankKey(1, item.queuedAt + kBackgroundAging, item.ticket);
+}
 
+void DownloadQueue::Enqueue(QueueItem& item) {
+    (item.priority == DownloadPriority::Background ? m_background : m_ready).insert(MakeKey(item));
+}
 
-void DownloadQueue::Push(const std::wstring& id, bool isBeatmapId) {
+void DownloadQueue::Dequeue(const QueueItem& item) {
+    (item.priority == DownloadPriority::Background ? m_background : m_ready).erase(MakeKey(item));
+}
+
+DownloadQueue::QueueItem& DownloadQueue::AddItem(const std::wstring& key, const std::wstring& id, bool isBeatmapId,
+                                                 const std::wstring& artist, const std::wstring& title,
+                                                 DownloadPriority priority, bool paused) {
+    uint64_t ticket = m_nextTicket++;
+    QueueItem& item = m_items[ticket];
+    item.ticket = ticket;
+    item.id = id;
+    item.isBeatmapId = isBeatmapId;
+    item.artist = artist;
+    item.title = title;
+    item.priority = priority;
+    item.queuedAt = Clock::now();
+    item.cancel = std::make_shared<network::CancellationToken>();
+    item.paused = paused;
+    if (!paused) Enqueue(item);
+    m_byKey[key] = ticket;
+    QueueJournal::Instance().Added({ ticket, id, isBeatmapId, artist, title, priority, paused });
+    return item;
+}
+
+void DownloadQueue::Erase(std::map<uint64_t, QueueItem>::iterator it, bool finished, bool success) {
+    QueueItem& item = it->second;
+    if (finished) {
+        QueueJournal::Instance().Removed(item.ticket);
+        for (auto& callback : item.onFinished) m_finished.emplace_back(std::move(callback), success);
+    }
+    Dequeue(item);
+    auto key = m_byKey.find(item.isBeatmapId ? InFlightDownloads::BeatmapKey(item.id) : InFlightDownloads::SetKey(item.id));
+    if (key != m_byKey.end() && key->second == item.ticket) m_byKey.erase(key);
+    m_items.erase(it);
+}
+
+bool DownloadQueue::SetPriority(QueueItem& item, DownloadPriority priority) {
+    if (item.priority == priority) return false;
+    // The key depends on the priority, so a waiting item is filed again
+    bool waiting = !item.running && !item.paused;
+    if (waiting) Dequeue(item);
+    item.priority = priority;
+    if (waiting) Enqueue(item);
+    QueueJournal::Instance().PriorityChanged(item.ticket, priority);
+    return true;
+}
+
+bool DownloadQueue::Unpause(QueueItem& item) {
+    if (!item.paused) return false;
+    item.paused = false;
+    QueueJournal::Instance().PausedChanged(item.ticket, false);
+    // Still running means its suspend is unwinding; the worker files it again when it returns
+    if (!item.running) Enqueue(item);
+    return true;
+}
+
+bool DownloadQueue::InteractiveActive() const {
+    if (!m_ready.empty() && std::get<0>(*m_ready.begin()) == 0) return true;
+    for (uint64_t ticket : m_runningTickets) {
+        if (m_items.at(ticket).priority == DownloadPriority::Interactive) return true;
+    }
+    return false;
+}
+
+std::set<DownloadQueue::RankKey>* DownloadQueue::NextReady() {
+    // Background work waits until the interactive items are done
+    bool background = !m_background.empty() && !InteractiveActive();
+    if (m_ready.empty()) return background ? &m_background : nullptr;
+    if (background && *m_background.begin() < *m_ready.begin()) return &m_background;
+    return &m_ready;
+}
+
+void DownloadQueue::PreemptBackground() {
+    if (!InteractiveActive()) return;
+    for (uint64_t ticket : m_runningTickets) {
+        QueueItem& item = m_items.at(ticket);
+        if (item.priority != DownloadPriority::Background || item.cancel->IsCancelled()) continue;
+        // Others are waiting on this download, maybe the interactive request itself.
+        // One that joins after the suspend takes the download over instead.
+        std::wstring key = item.isBeatmapId ? InFlightDownloads::BeatmapKey(item.id) : InFlightDownloads::SetKey(item.id);
+        if (InFlightDownloads::Instance().HasFollowers(key)) continue;
+        LogInfo("Pausing background download " + ToUtf8(item.id) + " for an interactive one");
+        item.cancel->Suspend();
+    }
+}
+
+void DownloadQueue::RunFinished() {
+    std::vector<std::pair<std::function<void(bool)>, bool>> finished;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        finished.swap(m_finished);
+    }
+    for (auto& callback : finished) callback.first(callback.second);
+}
+
+uint64_t DownloadQueue::Push(const std::wstring& id, bool isBeatmapId, const std::wstring& artist, const std::wstring& title,
+                             DownloadPriority priority, std::function<void(bool success)> onFinished) {
+    uint64_t ticket;
     {
         std::lock_guard<std::mutex> lock(m_mutex);
-        m_queue.push({id, isBeatmapId});
+        std::wstring key = isBeatmapId ? InFlightDownloads::BeatmapKey(id) : InFlightDownloads::SetKey(id);
+        auto found = m_byKey.find(key);
+        if (found != m_byKey.end()) {
+            // A second copy would only end up attached to the first one's download;
+            // asking again still raises it, and wakes it up if it was paused
+            QueueItem& item = m_items.at(found->second);
+            LogInfo("Already queued: " + ToUtf8(id));
+            if (priority < item.priority) SetPriority(item, priority);
+            Unpause(item);
+            if (onFinished) item.onFinished.push_back(std::move(onFinished));
+            ticket = item.ticket;
+        } else {
+            QueueItem& item = AddItem(key, id, isBeatmapId, artist, title, priority, false);
+            if (onFinished) item.onFinished.push_back(std::move(onFinished));
+            ticket = item.ticket;
+        }
+        PreemptBackground();
     }
-    m_cv.notify_one();
+    m_cv.notify_all();
+    return ticket;
+}
+
+bool DownloadQueue::Reprioritize(uint64_t ticket, DownloadPriority priority) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_items.find(ticket);
+        if (it == m_items.end() || !SetPriority(it->second, priority)) return false;
+        PreemptBackground();
+    }
+    m_cv.notify_all();
+    return true;
+}
+
+bool DownloadQueue::Cancel(uint64_t ticket) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_items.find(ticket);
+        if (it == m_items.end()) return false;
+        LogInfo("Cancelling download " + ToUtf8(it->second.id));
+        // A running item is dropped by its worker once the download has stopped
+        if (it->second.running) it->second.cancel->Cancel();
+        else Erase(it);
+    }
+    RunFinished();
+    return true;
+}
+
+bool DownloadQueue::Pause(uint64_t ticket) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_items.find(ticket);
+    if (it == m_items.end() || it->second.paused) return false;
+    QueueItem& item = it->second;
+    item.paused = true;
+    QueueJournal::Instance().PausedChanged(item.ticket, true);
+    if (item.running) item.cancel->Suspend();
+    else Dequeue(item);
+    return true;
+}
+
+bool DownloadQueue::Resume(uint64_t ticket) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_items.find(ticket);
+        if (it == m_items.end() || !Unpause(it->second)) return false;
+        PreemptBackground();
+    }
+    m_cv.notify_all();
+    return true;
+}
+
+void DownloadQueue::CancelCurrent() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_runningTickets.empty()) {
+        LogInfo("Cancelling " + std::to_string(m_runningTickets.size()) + " download(s) in progress");
+        for (uint64_t ticket : m_runningTickets) m_items.at(ticket).cancel->Cancel();
+    }
+}
+
+void DownloadQueue::CancelAll() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        size_t waiting = m_items.size() - m_runningTickets.size();
+        if (waiting > 0) {
+            LogInfo("Cancelling " + std::to_string(waiting) + " queued downloads");
+        }
+        for (auto it = m_items.begin(); it != m_items.end();) {
+            if (it->second.running) {
+                it->second.cancel->Cancel();
+                ++it;
+            } else {
+                Erase(it++);
+            }
+        }
+    }
+    RunFinished();
+}
+
+size_t DownloadQueue::GetPendingCount() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_ready.size() + m_background.size();
+}
+
+size_t DownloadQueue::GetActiveCount() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_runningTickets.size();
+}
+
+std::vector<QueueEntry> DownloadQueue::GetEntries() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<QueueEntry> entries;
+    auto add = [&entries](const QueueItem& item) {
+        QueueEntry entry;
+        entry.ticket = item.ticket;
+        entry.name = ToUtf8(!item.artist.empty() && !item.title.empty() ? item.artist + L" - " + item.title : item.id);
+        entry.priority = item.priority;
+        entry.running = item.running;
+        entry.paused = item.paused;
+        entries.push_back(entry);
+    };
+
+    for (uint64_t ticket : m_runningTickets) add(m_items.at(ticket));
+    std::vector<RankKey> order;
+    std::merge(m_ready.begin(), m_ready.end(), m_background.begin(), m_background.end(), std::back_inserter(order));
+    for (const RankKey& key : order) add(m_items.at(std::get<2>(key)));
+    for (const auto& item : m_items) {
+        if (item.second.paused && !item.second.running) add(item.second);
+    }
+    return entries;
 }
 
 void DownloadQueue::WorkerThread() {
+    std::unique_lock<std::mutex> lock(m_mutex);
     while (m_running) {
-        QueueItem item;
-        {
-            std::unique_lock<std::mutex> lock(m_mutex);
-            m_cv.wait(lock, [this] { return !m_queue.empty() || !m_running; });
+        std::set<RankKey>* next = nullptr;
+        m_cv.wait(lock, [&] { return !m_running || (next = NextReady()) != nullptr; });
+        if (!m_running) break;
 
-            if (!m_running && m_queue.empty()) {
-                break;
-            }
+        uint64_t ticket = std::get<2>(*next->begin());
+        next->erase(next->begin());
+        QueueItem& item = m_items.at(ticket);
+        item.running = true;
+        m_runningTickets.insert(ticket);
+        // A token left over from a pause can't be reused
+        if (item.cancel->IsCancelled()) item.cancel = std::make_shared<network::CancellationToken>();
+        QueueItem work = item;
+        // The item keeps its place in line through every stage of the download
+        RankKey key = MakeKey(item);
+        StageRank rank = { std::get<0>(key), std::get<1>(key) };
+        lock.unlock();
 
-            item = m_queue.front();
-            m_queue.pop();
-        }
+        bool success = DownloadBeatmap(work.id, work.isBeatmapId, work.artist, work.title, work.cancel, rank);
 
-        DownloadBeatmap(item.id, item.isBeatmapId);
+        lock.lock();
+        m_runningTickets.erase(ticket);
+        auto it = m_items.find(ticket);
+        if (it != m_items.end()) {
+            QueueItem& done = it->second;
+            done.running = false;
+            if (!success && work.cancel->IsSuspended() && m_running) {
+                // Paused or preempted: it waits for Resume, or for the interactive work to finish
+                done.cancel = std::make_shared<network::CancellationToken>();
+                if (!done.paused) Enqueue(done);
+            } else {
+                // Stopped by shutdown: still live in the journal, so it resumes on the next start
+                Erase(it, !(!success && work.cancel->IsSuspended()), success);
+            }
+        }
+        if (!m_finished.empty()) {
+            lock.unlock();
+            RunFinished();
+            lock.lock();
+        }
+        // An interactive item finishing may release the background ones
+        m_cv.notify_all();
     }
 }
@@ -1,18 +1,69 @@
 #pragma once
-#include <queue>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <set>
 #include <string>
+#include <tuple>
 #include <mutex>
 #include <condition_variable>
+#include <functional>
 #include <thread>
 #include <atomic>
+#include <vector>
+#include "network/CancellationToken.h"
 
+enum class DownloadPriority {
+    Interactive,  // A link clicked in osu!; runs ahead of everything and pauses background work
+    UserAction,   // A download button in the overlay
+    Background    // Batches and prefetch
+};
+
+const char* DownloadPriorityName(DownloadPriority priority);
+
+// One queued, running or paused item, for the overlay
+struct QueueEntry {
+    uint64_t ticket = 0;
+    std::string name;             // UTF-8
+    DownloadPriority priority = DownloadPriority::UserAction;
+    bool running = false;
+    bool paused = false;
+};
+
+// Downloads run in priority order. Interactive items always go first; between
+// the other classes an item ages, so a background item that has waited long
+// enough runs ahead of newer overlay requests and nothing starves.
+// Every item gets a ticket when it is pushed; the overlay uses it to
+// reprioritize, pause, resume or cancel the item, queued or running.
 class DownloadQueue {
 public:
     static DownloadQueue& Instance();
 
     void Start();
     void Stop();
-    void Push(const std::wstring& id, bool isBeatmapId);
+    // Returns the item's ticket. A set that is already queued or running keeps its
+    // ticket, and is raised to the new priority if that is higher.
+    // onFinished runs on a worker (or the cancelling thread) once the item is done,
+    // unless it is still unfinished at shutdown.
+    uint64_t Push(const std::wstring& id, bool isBeatmapId, const std::wstring& artist = L"", const std::wstring& title = L"",
+                  DownloadPriority priority = DownloadPriority::UserAction,
+                  std::function<void(bool success)> onFinished = nullptr);
+
+    // False if the ticket is gone (finished or cancelled) or the call changes nothing
+    bool Reprioritize(uint64_t ticket, DownloadPriority priority);
+    bool Cancel(uint64_t ticket);
+    // A running item is stopped and keeps its partial file; it resumes where it stopped
+    bool Pause(uint64_t ticket);
+    bool Resume(uint64_t ticket);
+
+    // Stops the downloads in progress; the workers move on to the next items
+    void CancelCurrent();
+    // Drops every waiting item and stops the ones in progress
+    void CancelAll();
+    size_t GetPendingCount();
+    size_t GetActiveCount();
+    // Running items first, then the queue in the order it will run, then the paused ones
+    std::vector<QueueEntry> GetEntries();
 
 private:
     DownloadQueue() = default;
@@ -20,16 +71,59 @@ private:
     DownloadQueue(const DownloadQueue&) = delete;
     DownloadQueue& operator=(const DownloadQueue&) = delete;
 
-    void WorkerThread();
+    using Clock = std::chrono::steady_clock;
+    // (0 for interactive, 1 otherwise; when it is due; ticket)
+    using RankKey = std::tuple<int, Clock::time_point, uint64_t>;
 
     struct QueueItem {
+        uint64_t ticket = 0;
         std::wstring id;
-        bool isBeatmapId;
+        bool isBeatmapId = false;
+        std::wstring artist;
+        std::wstring title;
+        DownloadPriority priority = DownloadPriority::UserAction;
+        Clock::time_point queuedAt;   // Kept across pauses, so a resumed item gets its place back
+        network::CancelTokenPtr cancel;
+        bool running = false;
+        bool paused = false;
+        std::vector<std::function<void(bool)>> onFinished;  // One per Push that ended up here
     };
 
-    std::queue<QueueItem> m_queue;
+    void WorkerThread();
+
+    static RankKey MakeKey(const QueueItem& item);
+    // The following expect m_mutex to be held
+    void Enqueue(QueueItem& item);
+    void Dequeue(const QueueItem& item);
+    // New item under its InFlightDownloads key, journaled and queued unless paused
+    QueueItem& AddItem(const std::wstring& key, const std::wstring& id, bool isBeatmapId, const std::wstring& artist,
+                       const std::wstring& title, DownloadPriority priority, bool paused);
+    // finished = false drops the item here only; the journal keeps it for the next start
+    void Erase(std::map<uint64_t, QueueItem>::iterator it, bool finished = true, bool success = false);
+    bool SetPriority(QueueItem& item, DownloadPriority priority);
+    bool Unpause(QueueItem& item);
+    // The set whose first item a worker should start next, or nullptr if none may start
+    std::set<RankKey>* NextReady();
+    bool InteractiveActive() const;
+    // Suspends running background items while interactive work is waiting or running,
+    // except those other requests are waiting on (see InFlightDownloads::HasFollowers)
+    void PreemptBackground();
+    // Runs the onFinished callbacks of erased items; m_mutex must not be held
+    void RunFinished();
+
+    // Items waiting for a worker, in the order they run. Background items are kept
+    // apart so they can be held back in O(1) while interactive work is active.
+    std::set<RankKey> m_ready;
+    std::set<RankKey> m_background;
+    std::map<uint64_t, QueueItem> m_items;    // Every queued, running or paused item by ticket
+    std::map<std::wstring, uint64_t> m_byKey; // InFlightDownloads key -> ticket, to catch duplicates
+    std::set<uint64_t> m_runningTickets;
+    std::vector<std::pair<std::function<void(bool)>, bool>> m_finished; // Callbacks waiting for RunFinished
+    uint64_t m_nextTicket = 1;
     std::mutex m_mutex;
     std::condition_variable m_cv;
-    std::thread m_thread;
+    // Several workers so a long queue fills the link; DownloadStages decides how many of
+    // them are in each stage, and MirrorConcurrency how many one mirror gets at a time
+    std::vector<std::thread> m_threads;
     std::atomic<bool> m_running{false};
 };
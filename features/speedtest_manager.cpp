@@ -1,7 +1,9 @@
 #include "speedtest_manager.h"
 #include "providers/ProviderRegistry.h"
 #include "network/HttpRequest.h"
+#include "network/PartFile.h"
 #include "config/config_manager.h"
+#include "MirrorHealth.h"
 #include "utils/logging.h"
 #include <chrono>
 #include <filesystem>
@@ -26,7 +28,8 @@ void SpeedtestManager::Update() {
 void SpeedtestManager::CancelTest() {
     std::lock_guard<std::mutex> lock(m_Mutex);
     if (m_State == SpeedtestState::Running) {
-        m_IsCancelled = true;
+        // Aborts the running download immediately instead of letting it finish or time out
+        if (m_Cancel) m_Cancel->Cancel();
         m_State = SpeedtestState::Idle; // Or Finished? Let's go to Idle.
         LogInfo("Speedtest cancelled by user.");
     }
@@ -42,11 +45,13 @@ void SpeedtestManager::RunNextTest() {
     // We need to find the next provider to test
     std::string providerName;
     size_t currentIndex;
+    network::CancelTokenPtr cancel;
 
     {
         std::lock_guard<std::mutex> lock(m_Mutex);
         
-        if (m_IsCancelled) return;
+        cancel = m_Cancel;
+        if (!cancel || cancel->IsCancelled()) return;
 
         if (m_CurrentProviderIndex >= m_ProviderNames.size()) {
             FinishTest();
@@ -110,21 +115,21 @@ void SpeedtestManager::RunNextTest() {
 
     // Download
     // Download with 10s timeout
-    network::HttpRequest::DownloadAsync(url, fullPath, 
+    network::HttpRequest::StartDownload(url, fullPath, 
         nullptr, 
-        [this, currentIndex, fullPath, startTime](bool success, const std::string& error) {
+        [this, currentIndex, providerName, fullPath, startTime, cancel](const network::HttpResult& result) {
             
             // Check cancellation first
-            {
-                std::lock_guard<std::mutex> lock(m_Mutex);
-                if (m_IsCancelled) {
-                    // Cleanup and exit
-                    if (fs::exists(fullPath)) {
-                        try { fs::remove(fullPath); } catch (...) {}
-                    }
-                    return;
+            if (cancel->IsCancelled()) {
+                // Cleanup and exit; the aborted transfer may have left a partial file behind
+                network::PartFile::Discard(fullPath);
+                if (fs::exists(fullPath)) {
+                    try { fs::remove(fullPath); } catch (...) {}
                 }
+                return;
             }
+            bool success = result.success;
+            const std::string& error = result.error;
 
             auto endTime = std::chrono::high_resolution_clock::now();
             std::chrono::duration<double> elapsed = endTime - startTime;
@@ -140,6 +145,13 @@ void SpeedtestManager::RunNextTest() {
                 }
             }
 
+            // Measured speeds seed the mirror ranking used for hedging
+            if (success) {
+                MirrorHealth::Instance().RecordSuccess(providerName, sizeMB * 1024.0 * 1024.0, seconds, 0);
+            } else {
+                MirrorHealth::Instance().RecordFailure(providerName);
+            }
+
             // Update Results
             {
                 std::lock_guard<std::mutex> lock(m_Mutex);
@@ -153,6 +165,8 @@ void SpeedtestManager::RunNextTest() {
                     // Check for timeout
                     if (error.find("timed out") != std::string::npos || error.find("Timeout") != std::string::npos) {
                          m_Results[currentIndex].status = "Timed Out";
+                    } else if (result.invalidPayload) {
+                         m_Results[currentIndex].status = "Invalid Archive";
                     } else {
                          m_Results[currentIndex].status = "Failed";
                     }
@@ -162,6 +176,7 @@ void SpeedtestManager::RunNextTest() {
             }
 
             // Cleanup
+            network::PartFile::Discard(fullPath);
             if (fs::exists(fullPath)) {
                 try {
                     fs::remove(fullPath);
@@ -171,7 +186,11 @@ void SpeedtestManager::RunNextTest() {
             // Next
             RunNextTest();
         },
-        10L // Timeout 10 seconds
+        10L, // Timeout 10 seconds
+        1,
+        cancel,
+        // A mirror answering with an error page must not look fast
+        network::ExpectedPayload::ZipArchive
     );
 }
 
@@ -223,7 +242,7 @@ void SpeedtestManager::StartTest() {
         if (m_State == SpeedtestState::Running) return;
 
         m_State = SpeedtestState::Running;
-        m_IsCancelled = false;
+        m_Cancel = std::make_shared<network::CancellationToken>();
         m_Results.clear();
         m_ProviderNames = ProviderRegistry::Instance().GetProviderNames();
         m_CurrentProviderIndex = 0;
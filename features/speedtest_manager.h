@@ -3,6 +3,7 @@
 #include <vector>
 #include <mutex>
 #include <functional>
+#include "network/CancellationToken.h"
 
 struct SpeedtestResult {
     std::string providerName;
@@ -45,7 +46,7 @@ private:
     
     // Test execution state
     int m_CurrentProviderIndex = 0;
-    bool m_IsCancelled = false;
+    network::CancelTokenPtr m_Cancel; // Replaced for every run, so late callbacks of an old run see it cancelled
     std::vector<std::string> m_ProviderNames;
     
     // Constants
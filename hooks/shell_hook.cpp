@@ -72,7 +72,7 @@ BOOL WINAPI HookedShellExecuteExW(SHELLEXECUTEINFOW* pExecInfo) {
                 }
                 
                 // Queue the beatmap for download
-                DownloadQueue::Instance().Push(extractedId, isBeatmapId);
+                DownloadQueue::Instance().Push(extractedId, isBeatmapId, L"", L"", DownloadPriority::Interactive);
                 LogInfo("Beatmap download queued from osu:// link");
                 return TRUE; // Prevent osu! client from handling
             }
@@ -88,14 +88,14 @@ BOOL WINAPI HookedShellExecuteExW(SHELLEXECUTEINFOW* pExecInfo) {
         if (std::regex_search(url, matches, beatmapsetRegex)) {
             std::wstring id = matches[1].str();
             LogInfo("[INFO] Intercepted HTTP(S) beatmapset link, ID: " + std::string(id.begin(), id.end()));
-            DownloadQueue::Instance().Push(id, false);
+            DownloadQueue::Instance().Push(id, false, L"", L"", DownloadPriority::Interactive);
             return TRUE;
         }
         // Check for individual beatmap links
         else if (std::regex_search(url, matches, beatmapRegex)) {
             std::wstring id = matches[1].str();
             LogInfo("[INFO] Intercepted HTTP(S) beatmap link, ID: " + std::string(id.begin(), id.end()));
-            DownloadQueue::Instance().Push(id, true);
+            DownloadQueue::Instance().Push(id, true, L"", L"", DownloadPriority::Interactive);
             return TRUE;
         }
     }
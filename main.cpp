@@ -17,6 +17,7 @@
 #include "features/notification_manager.h"
 
 #include "features/download_queue.h"
+#include "features/BulkImport.h"
 #include "overlay/opengl_hook.h"
 
 
@@ -58,6 +59,7 @@ void Cleanup() {
         OverlayGL::RemoveOpenGLHooks();
 
     
+    BulkImport::Instance().Stop();
     DownloadQueue::Instance().Stop();
     NotificationManager::Instance().Cleanup();
     CleanupDownloadManager();
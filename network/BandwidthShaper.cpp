@@ -0,0 +1,183 @@
+#include "BandwidthShaper.h"
+#include "NetworkEngine.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+namespace network {
+
+    // A bucket holds at most this much of a second's budget, so an idle period
+    // does not turn into a long burst
+    static const double kBurstSeconds = 0.25;
+    // ...but always enough for a few curl chunks (CURL_MAX_WRITE_SIZE is 16 KB)
+    static const double kMinCapacity = 64 * 1024;
+
+    BandwidthShaper& BandwidthShaper::Instance() {
+        static BandwidthShaper instance;
+        return instance;
+    }
+
+    void BandwidthShaper::Configure(Bucket& bucket, int64_t rate) {
+        bool wasLimited = bucket.rate > 0;
+        bucket.rate = (std::max)((int64_t)0, rate);
+        bucket.capacity = (std::max)(kMinCapacity, bucket.rate * kBurstSeconds);
+        if (!wasLimited) bucket.tokens = bucket.capacity;
+        bucket.tokens = (std::min)(bucket.tokens, bucket.capacity);
+    }
+
+    void BandwidthShaper::SetLimits(int64_t globalBytesPerSec, int64_t backgroundBytesPerSec) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            Refill();
+            Configure(m_global, globalBytesPerSec);
+            Configure(m_background, backgroundBytesPerSec);
+        }
+        // Wake the reactor so waiting transfers see the new budget on its next Tick
+        NetworkEngine::Instance().Post([]() {});
+    }
+
+    int64_t BandwidthShaper::GetDownloadLimit() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_global.rate <= 0) return m_background.rate;
+        if (m_background.rate <= 0) return m_global.rate;
+        return (std::min)(m_global.rate, m_background.rate);
+    }
+
+    void BandwidthShaper::Refill() {
+        auto now = std::chrono::steady_clock::now();
+        double elapsed = std::chrono::duration<double>(now - m_lastRefill).count();
+        m_lastRefill = now;
+
+        for (Bucket* bucket : { &m_global, &m_background }) {
+            if (bucket->rate <= 0) continue;
+            bucket->tokens = (std::min)(bucket->capacity, bucket->tokens + bucket->rate * elapsed);
+        }
+    }
+
+    bool BandwidthShaper::Available(size_t bytes) const {
+        for (const Bucket* bucket : { &m_global, &m_background }) {
+            if (bucket->rate <= 0) continue;
+            if (bucket->tokens < (std::min)((double)bytes, bucket->capacity)) return false;
+        }
+        return true;
+    }
+
+    void BandwidthShaper::Take(double bytes) {
+        for (Bucket* bucket : { &m_global, &m_background }) {
+            if (bucket->rate > 0) bucket->tokens -= bytes;
+        }
+    }
+
+    int BandwidthShaper::WaitMs(size_t bytes) const {
+        double wait = 0;
+        for (const Bucket* bucket : { &m_global, &m_background }) {
+            if (bucket->rate <= 0) continue;
+            double missing = (std::min)((double)bytes, bucket->capacity) - bucket->tokens;
+            if (missing > 0) wait = (std::max)(wait, missing * 1000.0 / bucket->rate);
+        }
+        return (std::max)(1, (int)std::ceil(wait));
+    }
+
+    bool BandwidthShaper::Admit(CURL* handle, size_t bytes) {
+        bool canDefer = NetworkEngine::Instance().CanDefer();
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        for (;;) {
+            Refill();
+
+            // Tokens reserved by Tick for this redelivery
+            auto it = m_transfers.find(handle);
+            if (it != m_transfers.end() && it->second.granted > 0) {
+                double extra = (double)bytes - it->second.granted;
+                it->second.granted = (std::max)(0.0, -extra);
+                if (extra > 0) Take(extra);
+                return true;
+            }
+
+            if (m_global.rate <= 0 && m_background.rate <= 0) return true;
+
+            // Newcomers queue behind waiting transfers so nobody is starved
+            if ((m_waiting.empty() || !canDefer) && Available(bytes)) {
+                Take((double)bytes);
+                return true;
+            }
+
+            if (!canDefer) {
+                int waitMs = WaitMs(bytes);
+                lock.unlock();
+                std::this_thread::sleep_for(std::chrono::milliseconds(waitMs));
+                lock.lock();
+                continue;
+            }
+
+            TransferState& state = m_transfers[handle];
+            state.want = bytes;
+            if (!state.waiting) {
+                state.waiting = true;
+                m_waiting.push_back(handle);
+            }
+            return false;
+        }
+    }
+
+    void BandwidthShaper::Refund(CURL* handle, size_t bytes) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_global.rate <= 0 && m_background.rate <= 0) return;
+        m_transfers[handle].granted += (double)bytes;
+    }
+
+    void BandwidthShaper::Charge(size_t bytes) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_global.rate <= 0) return;
+        Refill();
+        m_global.tokens -= (double)bytes;
+    }
+
+    void BandwidthShaper::Forget(CURL* handle) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_transfers.erase(handle);
+        auto it = std::find(m_waiting.begin(), m_waiting.end(), handle);
+        if (it != m_waiting.end()) m_waiting.erase(it);
+    }
+
+    int BandwidthShaper::Tick() {
+        std::vector<CURL*> resume;
+        int next = -1;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_waiting.empty()) return -1;
+            Refill();
+
+            bool limited = m_global.rate > 0 || m_background.rate > 0;
+            while (!m_waiting.empty()) {
+                CURL* handle = m_waiting.front();
+                auto it = m_transfers.find(handle);
+                if (it == m_transfers.end() || !it->second.waiting) {
+                    m_waiting.pop_front();
+                    continue;
+                }
+
+                size_t want = it->second.want;
+                if (limited) {
+                    if (!Available(want)) {
+                        next = WaitMs(want);
+                        break;
+                    }
+                    Take((double)want);
+                    it->second.granted += (double)want;
+                }
+                it->second.waiting = false;
+                m_waiting.pop_front();
+                resume.push_back(handle);
+            }
+        }
+
+        // Unpausing delivers the held chunk right away, which calls back into Admit
+        for (CURL* handle : resume) {
+            curl_easy_pause(handle, CURLPAUSE_CONT);
+        }
+        return next;
+    }
+
+}
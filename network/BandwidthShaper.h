@@ -0,0 +1,75 @@
+#pragma once
+
+#include <curl/curl.h>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+namespace network {
+
+    // Token-bucket bandwidth limits shared by every transfer.
+    // Downloads are background traffic: each chunk passes Admit, and when a bucket
+    // runs dry the transfer is paused and queued. Tick hands out tokens to the
+    // queue in FIFO order, so concurrent downloads split the budget evenly.
+    // API requests (search, metadata) are charged against the global bucket but
+    // never delayed, which keeps the overlay responsive under a tight cap.
+    class BandwidthShaper {
+    public:
+        static BandwidthShaper& Instance();
+
+        // Bytes per second, 0 = unlimited. Applies to running transfers right away.
+        void SetLimits(int64_t globalBytesPerSec, int64_t backgroundBytesPerSec);
+        // Tightest cap that applies to downloads, 0 = unlimited
+        int64_t GetDownloadLimit();
+
+        // Download write callbacks. Returns false if the chunk has to wait; the caller
+        // returns CURL_WRITEFUNC_PAUSE and Tick unpauses the handle once tokens are
+        // reserved for it. Transfers off the reactor loop sleep here instead.
+        bool Admit(CURL* handle, size_t bytes);
+        // Returns tokens for a chunk that was admitted but then not accepted
+        void Refund(CURL* handle, size_t bytes);
+        // Counts unshaped traffic against the global bucket
+        void Charge(size_t bytes);
+        // Drops the state of a finished transfer
+        void Forget(CURL* handle);
+
+        // Reactor thread: refills the buckets and resumes waiting transfers.
+        // Returns the milliseconds until the next tick is due, or -1 if nothing waits.
+        int Tick();
+
+    private:
+        struct Bucket {
+            int64_t rate = 0;     // Bytes per second, 0 = unlimited
+            double tokens = 0;    // May go negative when charged
+            double capacity = 0;
+        };
+
+        struct TransferState {
+            double granted = 0;   // Tokens reserved by Tick for the chunk curl will redeliver
+            size_t want = 0;
+            bool waiting = false;
+        };
+
+        BandwidthShaper() = default;
+        ~BandwidthShaper() = default;
+        BandwidthShaper(const BandwidthShaper&) = delete;
+        BandwidthShaper& operator=(const BandwidthShaper&) = delete;
+
+        static void Configure(Bucket& bucket, int64_t rate);
+        void Refill();
+        bool Available(size_t bytes) const;
+        void Take(double bytes);
+        // Milliseconds until bytes are available in every limited bucket
+        int WaitMs(size_t bytes) const;
+
+        std::mutex m_mutex;
+        Bucket m_global;
+        Bucket m_background;
+        std::chrono::steady_clock::time_point m_lastRefill = std::chrono::steady_clock::now();
+        std::unordered_map<CURL*, TransferState> m_transfers;
+        std::deque<CURL*> m_waiting;
+    };
+
+}
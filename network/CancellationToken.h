@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace network {
+
+    // Shared between the requester and running transfers. Cancel() wakes the
+    // network engine, which tears down every transfer holding the token right
+    // away; transfers outside the engine notice at their next progress tick.
+    // Suspend() stops the work the same way, but it is going to be resumed, so
+    // whatever it has on disk (e.g. a partial download) should be kept.
+    class CancellationToken {
+    public:
+        void Cancel() { Fire(false); }
+        void Suspend() { Fire(true); }
+
+        bool IsCancelled() const { return m_cancelled.load(); }
+        bool IsSuspended() const { return m_suspended.load(); }
+
+        // fn runs once, on the thread that calls Cancel(), or right away if that already happened.
+        // Returns an id for Unsubscribe.
+        size_t Subscribe(std::function<void()> fn) {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (!m_cancelled) {
+                    m_listeners.emplace_back(++m_nextId, std::move(fn));
+                    return m_nextId;
+                }
+            }
+            fn();
+            return 0;
+        }
+
+        void Unsubscribe(size_t id) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (auto it = m_listeners.begin(); it != m_listeners.end(); ++it) {
+                if (it->first == id) {
+                    m_listeners.erase(it);
+                    return;
+                }
+            }
+        }
+
+    private:
+        void Fire(bool suspend) {
+            std::vector<std::pair<size_t, std::function<void()>>> listeners;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                // A real cancel overrides an earlier suspend, but not the other way round
+                if (!suspend) m_suspended = false;
+                if (m_cancelled.exchange(true)) return;
+                m_suspended = suspend;
+                listeners.swap(m_listeners);
+            }
+            for (auto& listener : listeners) listener.second();
+        }
+
+        std::atomic<bool> m_cancelled{false};
+        std::atomic<bool> m_suspended{false};
+        std::mutex m_mutex;
+        std::vector<std::pair<size_t, std::function<void()>>> m_listeners;
+        size_t m_nextId = 0;
+    };
+
+    using CancelTokenPtr = std::shared_ptr<CancellationToken>;
+
+}
@@ -0,0 +1,150 @@
+#include "ConnectionPool.h"
+#include "ConnectionWarmer.h"
+#include "SessionCache.h"
+#include "utils/logging.h"
+
+namespace network {
+
+    // Idle handles kept around for reuse; anything beyond this is cleaned up.
+    static const size_t kMaxIdleHandles = 16;
+    // Live connections kept open per handle (curl's per-host connection cache).
+    static const long kMaxConnects = 16;
+    // Lifetime of entries in the shared DNS cache
+    static const long kDnsCacheSeconds = 300;
+
+    ConnectionPool& ConnectionPool::Instance() {
+        static ConnectionPool instance;
+        return instance;
+    }
+
+    void ConnectionPool::LockShare(CURL* handle, curl_lock_data data, curl_lock_access access, void* userptr) {
+        ConnectionPool* pool = (ConnectionPool*)userptr;
+        pool->m_shareLocks[data].lock();
+    }
+
+    void ConnectionPool::UnlockShare(CURL* handle, curl_lock_data data, void* userptr) {
+        ConnectionPool* pool = (ConnectionPool*)userptr;
+        pool->m_shareLocks[data].unlock();
+    }
+
+    void ConnectionPool::Initialize() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_share) return;
+
+        m_share = curl_share_init();
+        if (!m_share) {
+            LogError("Failed to create curl share handle, connections will not be reused");
+            return;
+        }
+
+        curl_share_setopt(m_share, CURLSHOPT_LOCKFUNC, LockShare);
+        curl_share_setopt(m_share, CURLSHOPT_UNLOCKFUNC, UnlockShare);
+        curl_share_setopt(m_share, CURLSHOPT_USERDATA, this);
+        curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+        curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+
+        LogInfo("Connection pool initialized");
+    }
+
+    void ConnectionPool::RestoreSessions(const std::wstring& path) {
+        PooledHandle handle;
+        if (!handle || !m_share) return;
+        SessionCache::Instance().Load(path, handle.get());
+    }
+
+    void ConnectionPool::Shutdown() {
+        if (m_share) {
+            // Exported through any handle attached to the share, before it goes away
+            PooledHandle handle;
+            if (handle) SessionCache::Instance().Save(handle.get());
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (CURL* handle : m_idle) {
+            curl_easy_cleanup(handle);
+        }
+        m_idle.clear();
+
+        if (m_share) {
+            curl_share_cleanup(m_share);
+            m_share = nullptr;
+        }
+
+        LogInfo("Connection pool shut down (" + std::to_string(m_transfers.load()) + " transfers, " +
+                std::to_string(m_reused.load()) + " reused connections)");
+    }
+
+    void ConnectionPool::ApplyPoolOptions(CURL* handle) {
+        if (m_share) {
+            curl_easy_setopt(handle, CURLOPT_SHARE, m_share);
+        }
+        curl_easy_setopt(handle, CURLOPT_SSL_VERIFYPEER, 0L); // For compatibility
+        curl_easy_setopt(handle, CURLOPT_SSL_VERIFYHOST, 0L);
+        curl_easy_setopt(handle, CURLOPT_USERAGENT, "osu! Beatmap Downloader/1.0");
+        curl_easy_setopt(handle, CURLOPT_MAXCONNECTS, kMaxConnects);
+        curl_easy_setopt(handle, CURLOPT_DNS_CACHE_TIMEOUT, kDnsCacheSeconds);
+        curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L);
+        curl_easy_setopt(handle, CURLOPT_TCP_KEEPIDLE, 60L);
+        curl_easy_setopt(handle, CURLOPT_TCP_KEEPINTVL, 30L);
+        // Keep idle mirror connections warm long enough to span a resolve -> metadata -> download chain
+        curl_easy_setopt(handle, CURLOPT_MAXAGE_CONN, 120L);
+        SessionCache::Instance().ApplyTo(handle);
+    }
+
+    CURL* ConnectionPool::Acquire() {
+        CURL* handle = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_idle.empty()) {
+                handle = m_idle.back();
+                m_idle.pop_back();
+            }
+        }
+
+        if (!handle) {
+            handle = curl_easy_init();
+            if (!handle) return nullptr;
+        }
+
+        ApplyPoolOptions(handle);
+        return handle;
+    }
+
+    void ConnectionPool::Release(CURL* handle) {
+        if (!handle) return;
+
+        // Reset drops per-request options but keeps the shared caches intact
+        curl_easy_reset(handle);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_share && m_idle.size() < kMaxIdleHandles) {
+            m_idle.push_back(handle);
+            return;
+        }
+        curl_easy_cleanup(handle);
+    }
+
+    void ConnectionPool::RecordTransfer(CURL* handle) {
+        long newConnections = 0;
+        if (curl_easy_getinfo(handle, CURLINFO_NUM_CONNECTS, &newConnections) != CURLE_OK) return;
+
+        m_transfers++;
+        if (newConnections == 0) {
+            m_reused++;
+        } else {
+            m_new += newConnections;
+        }
+        ConnectionWarmer::Instance().RecordTransfer(handle);
+        SessionCache::Instance().RecordTransfer(handle);
+    }
+
+    void ConnectionPool::RecordFailure(CURL* handle, CURLcode result) {
+        SessionCache::Instance().RecordConnectFailure(handle, result);
+    }
+
+    ConnectionStats ConnectionPool::GetStats() const {
+        return { m_transfers.load(), m_reused.load(), m_new.load() };
+    }
+
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <curl/curl.h>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace network {
+
+    struct ConnectionStats {
+        uint64_t transfers;
+        uint64_t reusedConnections;
+        uint64_t newConnections;
+    };
+
+    // Process-wide pool of curl easy handles. Every handle is attached to one
+    // CURLSH object, so DNS results, TLS sessions and live keep-alive
+    // connections are shared across all requests to the same mirror host.
+    class ConnectionPool {
+    public:
+        static ConnectionPool& Instance();
+
+        void Initialize();
+        // Saves the shared TLS sessions first if RestoreSessions was called
+        void Shutdown();
+
+        // Imports the TLS sessions and host addresses saved at path by the last Shutdown
+        void RestoreSessions(const std::wstring& path);
+
+        // Returns a handle with the shared caches, keep-alive, TLS and user agent options set.
+        CURL* Acquire();
+        // Resets the handle and keeps it for the next request.
+        void Release(CURL* handle);
+
+        // Called after each completed transfer to count connection reuse.
+        void RecordTransfer(CURL* handle);
+        // Called for transfers that never got an answer
+        void RecordFailure(CURL* handle, CURLcode result);
+        ConnectionStats GetStats() const;
+
+    private:
+        ConnectionPool() = default;
+        ~ConnectionPool() = default;
+        ConnectionPool(const ConnectionPool&) = delete;
+        ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+        static void LockShare(CURL* handle, curl_lock_data data, curl_lock_access access, void* userptr);
+        static void UnlockShare(CURL* handle, curl_lock_data data, void* userptr);
+
+        void ApplyPoolOptions(CURL* handle);
+
+        CURLSH* m_share = nullptr;
+        std::mutex m_shareLocks[CURL_LOCK_DATA_LAST];
+
+        std::vector<CURL*> m_idle;
+        std::mutex m_mutex;
+
+        std::atomic<uint64_t> m_transfers{0};
+        std::atomic<uint64_t> m_reused{0};
+        std::atomic<uint64_t> m_new{0};
+    };
+
+    // RAII lease on a pooled handle.
+    class PooledHandle {
+    public:
+        PooledHandle() : m_handle(ConnectionPool::Instance().Acquire()) {}
+        ~PooledHandle() { if (m_handle) ConnectionPool::Instance().Release(m_handle); }
+        PooledHandle(const PooledHandle&) = delete;
+        PooledHandle& operator=(const PooledHandle&) = delete;
+
+        CURL* get() const { return m_handle; }
+        explicit operator bool() const { return m_handle != nullptr; }
+
+    private:
+        CURL* m_handle;
+    };
+
+}
@@ -0,0 +1,122 @@
+#include "ConnectionWarmer.h"
+#include "ConnectionPool.h"
+#include "NetworkEngine.h"
+#include "utils/logging.h"
+
+namespace network {
+
+    // Origins are warmed again after this long; stays below the pool's CURLOPT_MAXAGE_CONN
+    static const std::chrono::seconds kRewarmInterval(60);
+    static const long kWarmupTimeoutSeconds = 10;
+
+    ConnectionWarmer& ConnectionWarmer::Instance() {
+        static ConnectionWarmer instance;
+        return instance;
+    }
+
+    std::string ConnectionWarmer::OriginOf(const std::string& url) {
+        size_t scheme = url.find("://");
+        if (scheme == std::string::npos) return "";
+        size_t end = url.find_first_of("/?#", scheme + 3);
+        return url.substr(0, end);
+    }
+
+    void ConnectionWarmer::Warm(const std::vector<std::string>& urls) {
+        // Inline transfers would block the caller, which is usually the render thread
+        if (!NetworkEngine::Instance().IsRunning()) return;
+
+        auto now = std::chrono::steady_clock::now();
+        for (const auto& url : urls) {
+            std::string origin = OriginOf(url);
+            if (origin.empty()) continue;
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                Origin& state = m_origins[origin];
+                if (state.pending) continue;
+                if (state.warmedAt.time_since_epoch().count() != 0 && now - state.warmedAt < kRewarmInterval) continue;
+                state.pending = true;
+            }
+
+            CURL* curl = ConnectionPool::Instance().Acquire();
+            if (!curl) {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_origins[origin].pending = false;
+                continue;
+            }
+
+            std::string target = origin + "/";
+            curl_easy_setopt(curl, CURLOPT_URL, target.c_str());
+            curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+            curl_easy_setopt(curl, CURLOPT_TIMEOUT, kWarmupTimeoutSeconds);
+
+            NetworkEngine::Instance().Submit(curl, [this, origin](CURL* handle, CURLcode result) {
+                Finish(origin, handle, result);
+            });
+        }
+    }
+
+    void ConnectionWarmer::Finish(const std::string& origin, CURL* handle, CURLcode result) {
+        // Any HTTP answer means the connection is up; the status of "/" does not matter
+        long response_code = 0;
+        curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &response_code);
+        bool connected = response_code != 0;
+
+        // TLS handshake end, or TCP connect for plain HTTP
+        curl_off_t setupUs = 0;
+        curl_easy_getinfo(handle, CURLINFO_APPCONNECT_TIME_T, &setupUs);
+        if (setupUs == 0) curl_easy_getinfo(handle, CURLINFO_CONNECT_TIME_T, &setupUs);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            Origin& state = m_origins[origin];
+            state.pending = false;
+            // Failed hosts are not retried before the interval either
+            state.warmedAt = std::chrono::steady_clock::now();
+            state.unused = connected;
+            if (connected) state.setupSeconds = setupUs / 1e6;
+        }
+
+        if (connected) {
+            m_warmed++;
+            LogInfo("Pre-warmed " + origin + " (setup " + std::to_string(setupUs / 1000) + " ms)");
+        } else {
+            LogDebug("Pre-warm of " + origin + " failed: " + curl_easy_strerror(result));
+        }
+    }
+
+    void ConnectionWarmer::RecordTransfer(CURL* handle) {
+        char* url = nullptr;
+        curl_easy_getinfo(handle, CURLINFO_EFFECTIVE_URL, &url);
+        if (!url) return;
+        std::string origin = OriginOf(url);
+
+        long newConnections = 0;
+        curl_easy_getinfo(handle, CURLINFO_NUM_CONNECTS, &newConnections);
+
+        double saved = 0;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto it = m_origins.find(origin);
+            if (it == m_origins.end() || !it->second.unused) return;
+
+            // Only the first request after a warm-up is credited
+            it->second.unused = false;
+            if (newConnections != 0) return;
+            saved = it->second.setupSeconds;
+            m_savedSeconds += saved;
+        }
+        m_hits++;
+
+        curl_off_t ttfbUs = 0;
+        curl_easy_getinfo(handle, CURLINFO_STARTTRANSFER_TIME_T, &ttfbUs);
+        LogInfo("Warm connection to " + origin + ": time to first byte " + std::to_string(ttfbUs / 1000) +
+                " ms, saved ~" + std::to_string((long long)(saved * 1000)) + " ms of connection setup");
+    }
+
+    WarmupStats ConnectionWarmer::GetStats() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return { m_warmed.load(), m_hits.load(), m_savedSeconds };
+    }
+
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <curl/curl.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace network {
+
+    struct WarmupStats {
+        uint64_t warmedOrigins;   // Warm-up connections opened
+        uint64_t hits;            // Later requests that reused one of them
+        double savedSeconds;      // DNS + TCP + TLS setup those requests skipped
+    };
+
+    // Opens idle keep-alive connections to hosts we are about to talk to, so the
+    // first real request skips DNS, TCP and TLS setup. The connections land in
+    // the ConnectionPool's shared cache and are picked up by any later transfer.
+    class ConnectionWarmer {
+    public:
+        static ConnectionWarmer& Instance();
+
+        // Fire-and-forget: sends a HEAD to the origin of each URL on the network
+        // thread, skipping origins warmed recently. Never blocks the caller.
+        void Warm(const std::vector<std::string>& urls);
+
+        // Called for every completed transfer; credits requests that reused a warm connection
+        void RecordTransfer(CURL* handle);
+        WarmupStats GetStats() const;
+
+        // "https://host:port" part of a URL, empty if it has no scheme
+        static std::string OriginOf(const std::string& url);
+
+    private:
+        ConnectionWarmer() = default;
+        ~ConnectionWarmer() = default;
+        ConnectionWarmer(const ConnectionWarmer&) = delete;
+        ConnectionWarmer& operator=(const ConnectionWarmer&) = delete;
+
+        struct Origin {
+            std::chrono::steady_clock::time_point warmedAt;
+            double setupSeconds = 0;  // Measured on the warm-up request
+            bool pending = false;
+            bool unused = false;      // Warm connection not yet credited to a real request
+        };
+
+        void Finish(const std::string& origin, CURL* handle, CURLcode result);
+
+        mutable std::mutex m_mutex;
+        std::unordered_map<std::string, Origin> m_origins;
+
+        std::atomic<uint64_t> m_warmed{0};
+        std::atomic<uint64_t> m_hits{0};
+        double m_savedSeconds = 0; // Guarded by m_mutex
+    };
+
+}
@@ -0,0 +1,362 @@
+#include "DiskWriter.h"
+#include "NetworkEngine.h"
+#include "utils/logging.h"
+#include <algorithm>
+#include <cstring>
+
+namespace network {
+
+    // Each stream fills buffers of this size before they go to the writer
+    static const size_t kBufferSize = 1024 * 1024;
+    // Buffers per file on top of the one each stream is filling
+    static const size_t kSpareBuffers = 4;
+
+    static int64_t ElapsedNanos(std::chrono::steady_clock::time_point since) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - since).count();
+    }
+
+    // A failed page-in (disk full, removed drive) surfaces as an SEH exception, not an error code
+    static bool CopyToView(char* dest, const char* src, size_t size) {
+        __try {
+            memcpy(dest, src, size);
+            return true;
+        } __except (GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH) {
+            return false;
+        }
+    }
+
+    std::shared_ptr<FileSink> FileSink::Open(const std::wstring& path, int64_t preallocateSize,
+                                             bool keepExisting, int streams) {
+        std::shared_ptr<FileSink> sink(new FileSink());
+        sink->m_file = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL,
+                                   keepExisting ? OPEN_ALWAYS : CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (sink->m_file == INVALID_HANDLE_VALUE) {
+            LogError("Failed to open download file (error " + std::to_string(GetLastError()) + ")");
+            return nullptr;
+        }
+
+        if (preallocateSize > 0) {
+            // Reserve the full size up front so writes never extend the file
+            LARGE_INTEGER current = {};
+            GetFileSizeEx(sink->m_file, &current);
+            if (current.QuadPart < preallocateSize) {
+                LARGE_INTEGER size;
+                size.QuadPart = preallocateSize;
+                if (!SetFilePointerEx(sink->m_file, size, NULL, FILE_BEGIN) || !SetEndOfFile(sink->m_file)) {
+                    LogWarning("Failed to preallocate " + std::to_string((long long)preallocateSize) + " bytes");
+                    preallocateSize = 0;
+                }
+            }
+        }
+
+        if (DiskWriter::Instance().IsMemoryMapped() && preallocateSize > 0) {
+            sink->m_mapping = CreateFileMappingW(sink->m_file, NULL, PAGE_READWRITE,
+                                                 (DWORD)(preallocateSize >> 32), (DWORD)(preallocateSize & 0xFFFFFFFF), NULL);
+            if (sink->m_mapping) {
+                sink->m_view = (char*)MapViewOfFile(sink->m_mapping, FILE_MAP_WRITE, 0, 0, 0);
+            }
+            if (sink->m_view) {
+                sink->m_mappedSize = preallocateSize;
+            } else {
+                LogWarning("Memory-mapped output unavailable, using WriteFile");
+                if (sink->m_mapping) CloseHandle(sink->m_mapping);
+                sink->m_mapping = NULL;
+            }
+        }
+
+        sink->m_maxBuffers = (size_t)(std::max)(1, streams) + kSpareBuffers;
+        sink->m_openedAt = std::chrono::steady_clock::now();
+        return sink;
+    }
+
+    FileSink::~FileSink() {
+        if (m_view) UnmapViewOfFile(m_view);
+        if (m_mapping) CloseHandle(m_mapping);
+        if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+    }
+
+    int FileSink::OpenStream(int64_t offset) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_streams.emplace_back();
+        m_streams.back().next = offset;
+        m_streams.back().durable = offset;
+        return (int)m_streams.size() - 1;
+    }
+
+    bool FileSink::Write(int stream, const void* data, size_t size, CURL* handle) {
+        // Only the network thread adds streams, so it can index without the lock
+        Stream& s = m_streams[stream];
+
+        if (!s.current || s.current->data.size() + size > kBufferSize) {
+            std::unique_ptr<WriteBuffer> next = AcquireBuffer(NetworkEngine::Instance().CanDefer());
+            if (!next) {
+                if (m_paused.empty()) m_stallStart = std::chrono::steady_clock::now();
+                if (std::find(m_paused.begin(), m_paused.end(), handle) == m_paused.end()) {
+                    m_paused.push_back(handle);
+                }
+                return false;
+            }
+            if (s.current) Submit(stream);
+            next->offset = s.next;
+            next->stream = stream;
+            s.current = std::move(next);
+        }
+
+        s.current->data.insert(s.current->data.end(), (const char*)data, (const char*)data + size);
+        s.next += size;
+        return true;
+    }
+
+    int64_t FileSink::DurableOffset(int stream) const {
+        return m_streams[stream].durable.load();
+    }
+
+    void FileSink::Detach(CURL* handle) {
+        auto it = std::find(m_paused.begin(), m_paused.end(), handle);
+        if (it == m_paused.end()) return;
+        m_paused.erase(it);
+        if (m_paused.empty()) m_stallNanos += ElapsedNanos(m_stallStart);
+    }
+
+    std::unique_ptr<WriteBuffer> FileSink::AcquireBuffer(bool canPause) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;) {
+            if (!m_free.empty()) {
+                std::unique_ptr<WriteBuffer> buffer = std::move(m_free.back());
+                m_free.pop_back();
+                return buffer;
+            }
+            if (m_allocated < m_maxBuffers) {
+                m_allocated++;
+                auto buffer = std::make_unique<WriteBuffer>();
+                buffer->data.reserve(kBufferSize);
+                return buffer;
+            }
+            if (canPause) {
+                m_wantsResume = true;
+                return nullptr;
+            }
+
+            // Blocking callers (inline transfers) simply wait for the writer
+            auto start = std::chrono::steady_clock::now();
+            m_cv.wait(lock, [this] { return !m_free.empty(); });
+            m_stallNanos += ElapsedNanos(start);
+        }
+    }
+
+    void FileSink::ReleaseBuffer(std::unique_ptr<WriteBuffer> buffer) {
+        bool resume;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            buffer->data.clear();
+            m_free.push_back(std::move(buffer));
+            resume = m_wantsResume;
+            m_wantsResume = false;
+        }
+        m_cv.notify_all();
+
+        if (resume) {
+            std::weak_ptr<FileSink> weak = shared_from_this();
+            NetworkEngine::Instance().Post([weak]() {
+                if (auto sink = weak.lock()) sink->ResumePaused();
+            });
+        }
+    }
+
+    void FileSink::Submit(int stream) {
+        std::unique_ptr<WriteBuffer> buffer = std::move(m_streams[stream].current);
+        if (buffer->data.empty()) {
+            ReleaseBuffer(std::move(buffer));
+            return;
+        }
+        DiskWriter::Instance().Enqueue({ shared_from_this(), std::move(buffer) });
+    }
+
+    void FileSink::ResumePaused() {
+        if (m_paused.empty()) return;
+        m_stallNanos += ElapsedNanos(m_stallStart);
+
+        // Unpausing can deliver data right away, which may pause the handle again
+        std::vector<CURL*> paused;
+        paused.swap(m_paused);
+        for (CURL* handle : paused) {
+            curl_easy_pause(handle, CURLPAUSE_CONT);
+        }
+    }
+
+    void FileSink::WriteOut(WriteBuffer& buffer) {
+        if (m_failed) return;
+
+        auto start = std::chrono::steady_clock::now();
+        int64_t size = (int64_t)buffer.data.size();
+        bool ok;
+        if (m_view && buffer.offset + size <= m_mappedSize) {
+            ok = CopyToView(m_view + buffer.offset, buffer.data.data(), buffer.data.size());
+        } else {
+            OVERLAPPED ov = {};
+            ov.Offset = (DWORD)(buffer.offset & 0xFFFFFFFF);
+            ov.OffsetHigh = (DWORD)(buffer.offset >> 32);
+            DWORD written = 0;
+            ok = WriteFile(m_file, buffer.data.data(), (DWORD)size, &written, &ov) && written == (DWORD)size;
+        }
+        m_diskNanos += ElapsedNanos(start);
+
+        if (!ok) {
+            LogError("Failed to write download file (error " + std::to_string(GetLastError()) + ")");
+            m_failed = true;
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_streams[buffer.stream].durable = buffer.offset + size;
+    }
+
+    void FileSink::CloseFile() {
+        auto start = std::chrono::steady_clock::now();
+        if (m_view) {
+            FlushViewOfFile(m_view, 0);
+            UnmapViewOfFile(m_view);
+            m_view = nullptr;
+        }
+        if (m_mapping) {
+            CloseHandle(m_mapping);
+            m_mapping = NULL;
+        }
+
+        if (m_truncateTo >= 0) {
+            LARGE_INTEGER size;
+            size.QuadPart = m_truncateTo;
+            if (!SetFilePointerEx(m_file, size, NULL, FILE_BEGIN) || !SetEndOfFile(m_file)) {
+                LogError("Failed to set download file size");
+                m_failed = true;
+            }
+        }
+        CloseHandle(m_file);
+        m_file = INVALID_HANDLE_VALUE;
+        m_diskNanos += ElapsedNanos(start);
+    }
+
+    void FileSink::Close(int64_t truncateTo, ClosedFn onClosed) {
+        for (size_t i = 0; i < m_streams.size(); ++i) {
+            if (m_streams[i].current) Submit((int)i);
+        }
+        if (!m_paused.empty()) {
+            m_stallNanos += ElapsedNanos(m_stallStart);
+            m_paused.clear();
+        }
+
+        bool defer = NetworkEngine::Instance().CanDefer();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_truncateTo = truncateTo;
+            m_deferClose = defer;
+            if (defer) m_onClosed = std::move(onClosed);
+        }
+        DiskWriter::Instance().Enqueue({ shared_from_this(), nullptr });
+
+        if (!defer) {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_cv.wait(lock, [this] { return m_closed; });
+            }
+            if (onClosed) onClosed(!m_failed);
+        }
+    }
+
+    DiskTimings FileSink::GetTimings() const {
+        std::chrono::steady_clock::time_point end;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            end = m_closed ? m_closedAt : std::chrono::steady_clock::now();
+        }
+
+        DiskTimings timings;
+        double total = std::chrono::duration<double>(end - m_openedAt).count();
+        timings.diskSeconds = m_diskNanos.load() / 1e9;
+        timings.stallSeconds = m_stallNanos.load() / 1e9;
+        timings.networkSeconds = (std::max)(0.0, total - timings.stallSeconds);
+        return timings;
+    }
+
+    DiskWriter& DiskWriter::Instance() {
+        static DiskWriter instance;
+        return instance;
+    }
+
+    void DiskWriter::Start() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_running) return;
+        m_running = true;
+        m_thread = std::thread(&DiskWriter::WriterThread, this);
+        LogInfo("Disk writer started");
+    }
+
+    void DiskWriter::Stop() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_running) return;
+            m_running = false;
+        }
+        m_cv.notify_all();
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+        LogInfo("Disk writer stopped");
+    }
+
+    void DiskWriter::Enqueue(Job job) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_running) {
+                m_jobs.push_back(std::move(job));
+                m_cv.notify_one();
+                return;
+            }
+        }
+        Run(job);
+    }
+
+    void DiskWriter::Run(Job& job) {
+        FileSink* sink = job.sink.get();
+        if (job.buffer) {
+            sink->WriteOut(*job.buffer);
+            sink->ReleaseBuffer(std::move(job.buffer));
+            return;
+        }
+
+        sink->CloseFile();
+        bool defer;
+        {
+            std::lock_guard<std::mutex> lock(sink->m_mutex);
+            sink->m_closed = true;
+            sink->m_closedAt = std::chrono::steady_clock::now();
+            defer = sink->m_deferClose;
+        }
+        sink->m_cv.notify_all();
+
+        if (defer) {
+            std::shared_ptr<FileSink> keepAlive = job.sink;
+            NetworkEngine::Instance().Post([keepAlive]() {
+                // Moved out so the callback's captures do not keep the sink alive
+                FileSink::ClosedFn onClosed = std::move(keepAlive->m_onClosed);
+                if (onClosed) onClosed(!keepAlive->m_failed);
+            });
+        }
+    }
+
+    void DiskWriter::WriterThread() {
+        for (;;) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_cv.wait(lock, [this] { return !m_jobs.empty() || !m_running; });
+                // Drain whatever is queued before exiting so no download loses data
+                if (m_jobs.empty()) break;
+                job = std::move(m_jobs.front());
+                m_jobs.pop_front();
+            }
+            Run(job);
+        }
+    }
+
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <curl/curl.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <windows.h>
+
+namespace network {
+
+    struct DiskTimings {
+        double networkSeconds = 0; // Transfer time not spent waiting on the disk
+        double diskSeconds = 0;    // Writer thread time spent writing this file
+        double stallSeconds = 0;   // Time the transfer was paused because every buffer was in flight
+    };
+
+    struct WriteBuffer {
+        std::vector<char> data;
+        int64_t offset = 0;
+        int stream = 0;
+    };
+
+    // Output file fed by the network thread and written by the DiskWriter thread.
+    // Each sequential stream of writes (one per Range segment) fills its own large
+    // buffer; full buffers are queued for the writer. The number of buffers per file
+    // is bounded, so a stalled disk pauses the transfer instead of growing memory or
+    // blocking the network thread.
+    class FileSink : public std::enable_shared_from_this<FileSink> {
+    public:
+        using ClosedFn = std::function<void(bool ok)>;
+
+        // preallocateSize > 0 reserves the final size up front. keepExisting keeps the
+        // bytes of an earlier attempt instead of truncating the file.
+        static std::shared_ptr<FileSink> Open(const std::wstring& path, int64_t preallocateSize,
+                                              bool keepExisting, int streams = 1);
+        ~FileSink();
+
+        // Starts a sequential stream of writes at offset and returns its id
+        int OpenStream(int64_t offset);
+
+        // Copies data into the stream's buffer. Returns false without consuming anything
+        // when every buffer is in flight; the caller returns CURL_WRITEFUNC_PAUSE and the
+        // handle is unpaused on the network thread once the writer frees a buffer.
+        bool Write(int stream, const void* data, size_t size, CURL* handle);
+        // End of the bytes given to Write for this stream
+        int64_t EndOffset(int stream) const { return m_streams[stream].next; }
+        // End of the bytes of this stream that have been handed to the OS
+        int64_t DurableOffset(int stream) const;
+        // Forgets a paused handle whose transfer has finished
+        void Detach(CURL* handle);
+
+        // Writes out every buffer and closes the file; truncateTo >= 0 sets the final size.
+        // onClosed runs on the network thread, or before Close returns when called
+        // somewhere the network thread cannot come back to later.
+        void Close(int64_t truncateTo, ClosedFn onClosed);
+
+        bool Failed() const { return m_failed; }
+        DiskTimings GetTimings() const;
+
+    private:
+        friend class DiskWriter;
+
+        struct Stream {
+            int64_t next = 0;
+            std::atomic<int64_t> durable{0};
+            std::unique_ptr<WriteBuffer> current;
+        };
+
+        FileSink() = default;
+
+        std::unique_ptr<WriteBuffer> AcquireBuffer(bool canPause);
+        void ReleaseBuffer(std::unique_ptr<WriteBuffer> buffer);
+        void Submit(int stream);
+        void ResumePaused();
+
+        // Writer thread
+        void WriteOut(WriteBuffer& buffer);
+        void CloseFile();
+
+        HANDLE m_file = INVALID_HANDLE_VALUE;
+        HANDLE m_mapping = NULL;
+        char* m_view = nullptr;
+        int64_t m_mappedSize = 0;
+        int64_t m_truncateTo = -1;
+
+        std::deque<Stream> m_streams; // deque keeps Stream addresses stable
+        size_t m_maxBuffers = 0;
+
+        mutable std::mutex m_mutex;
+        std::condition_variable m_cv;
+        std::vector<std::unique_ptr<WriteBuffer>> m_free;
+        size_t m_allocated = 0;
+        bool m_wantsResume = false;
+        bool m_closed = false;
+        bool m_deferClose = false;
+        ClosedFn m_onClosed;
+
+        // Network thread only
+        std::vector<CURL*> m_paused;
+        std::chrono::steady_clock::time_point m_stallStart;
+
+        std::atomic<bool> m_failed{false};
+        std::chrono::steady_clock::time_point m_openedAt;
+        std::chrono::steady_clock::time_point m_closedAt; // Guarded by m_mutex
+        std::atomic<int64_t> m_diskNanos{0};
+        std::atomic<int64_t> m_stallNanos{0};
+    };
+
+    // Single thread that performs every download's file writes in submission order.
+    class DiskWriter {
+    public:
+        static DiskWriter& Instance();
+
+        void Start();
+        void Stop();
+
+        // Copy into a mapped view of the preallocated file instead of calling WriteFile
+        void SetMemoryMapped(bool enabled) { m_memoryMapped = enabled; }
+        bool IsMemoryMapped() const { return m_memoryMapped; }
+
+    private:
+        friend class FileSink;
+
+        struct Job {
+            std::shared_ptr<FileSink> sink;
+            std::unique_ptr<WriteBuffer> buffer; // null for the close request
+        };
+
+        DiskWriter() = default;
+        ~DiskWriter() = default;
+        DiskWriter(const DiskWriter&) = delete;
+        DiskWriter& operator=(const DiskWriter&) = delete;
+
+        // Runs the job on the calling thread when the writer is not running
+        void Enqueue(Job job);
+        void Run(Job& job);
+        void WriterThread();
+
+        std::thread m_thread;
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        std::deque<Job> m_jobs;
+        bool m_running = false;
+        std::atomic<bool> m_memoryMapped{false};
+    };
+
+}
@@ -0,0 +1,489 @@
+#include "FakeTransport.h"
+#include "PayloadCheck.h"
+#include "RateLimiter.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+namespace network {
+
+    // The worker moves every exchange forward this often
+    static const std::chrono::milliseconds kTick(5);
+
+    // Same wording libcurl uses, so callers cannot tell the difference
+    static const char* kResetError = "Failure when receiving data from the peer";
+    static const char* kTimeoutError = "Timeout was reached";
+    static const char* kWriteError = "Failed writing received data to disk/application";
+
+    enum class ExchangeKind { Download, Get, Stream, Redirect };
+
+    struct FakeTransport::Exchange {
+        ExchangeKind kind = ExchangeKind::Get;
+        std::string url;
+        std::shared_ptr<const FakeResponse> response; // null for an unknown URL
+        FakeNetworkProfile profile;
+        long statusCode = 404;  // Injected errors replace the response's own status
+        int64_t resetAt = -1;   // Body offset where the connection drops, -1 = never
+
+        Clock::time_point startTime;
+        Clock::time_point firstByteTime;
+        Clock::time_point lastStep;
+        bool started = false;
+        double allowance = 0;   // Bytes the bandwidth cap has released but not yet sent
+        size_t sent = 0;
+
+        ResultCallback done;
+        std::string body;       // Get
+        DataCallback onData;    // Stream
+        std::wstring destPath;  // Download
+        std::ofstream file;
+        ExpectedPayload expect = ExpectedPayload::Any;
+        ZipSignatureSniffer sniffer;
+        ProgressCallback progress;
+        CancelTokenPtr cancel;
+        long timeoutSeconds = 0;
+
+        // Bytes this exchange sends as its body
+        const std::string& Payload() const {
+            static const std::string empty;
+            return (response && statusCode == response->statusCode) ? response->body : empty;
+        }
+        bool IsSuccessStatus() const { return statusCode >= 200 && statusCode < 300; }
+    };
+
+    FakeTransport::FakeTransport(uint32_t seed) : m_random(seed) {
+        m_thread = std::thread(&FakeTransport::WorkerThread, this);
+    }
+
+    FakeTransport::~FakeTransport() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_cv.notify_all();
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+    }
+
+    void FakeTransport::SetDefaultProfile(const FakeNetworkProfile& profile) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_defaultProfile = profile;
+    }
+
+    void FakeTransport::AddResponse(const std::string& urlPrefix, FakeResponse response) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_routes[urlPrefix] = std::make_shared<const FakeResponse>(std::move(response));
+    }
+
+    void FakeTransport::AddBeatmapArchive(const std::string& urlPrefix, size_t size,
+                                          std::optional<FakeNetworkProfile> profile) {
+        FakeResponse response;
+        response.body = MakeBeatmapArchive(size, (uint32_t)std::hash<std::string>()(urlPrefix));
+        response.contentType = "application/x-osu-beatmap-archive";
+        response.profile = profile;
+        AddResponse(urlPrefix, std::move(response));
+    }
+
+    size_t FakeTransport::GetActiveTransfers() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_exchanges.size();
+    }
+
+    static uint32_t Crc32(const std::string& data) {
+        static const std::vector<uint32_t> table = [] {
+            std::vector<uint32_t> entries(256);
+            for (uint32_t i = 0; i < 256; ++i) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                entries[i] = c;
+            }
+            return entries;
+        }();
+        uint32_t crc = 0xFFFFFFFFu;
+        for (unsigned char byte : data) crc = table[(crc ^ byte) & 0xFF] ^ (crc >> 8);
+        return crc ^ 0xFFFFFFFFu;
+    }
+
+    static void Put16(std::string& out, uint32_t value) {
+        out.push_back((char)(value & 0xFF));
+        out.push_back((char)((value >> 8) & 0xFF));
+    }
+
+    static void Put32(std::string& out, uint32_t value) {
+        Put16(out, value & 0xFFFF);
+        Put16(out, value >> 16);
+    }
+
+    std::string FakeTransport::MakeBeatmapArchive(size_t size, uint32_t seed) {
+        static const std::string name = "synthetic.osu";
+        const size_t overhead = (30 + name.size()) + (46 + name.size()) + 22;
+
+        // Printable filler after a real header line, deterministic for a given seed
+        std::string content = "osu file format v14\r\n";
+        std::mt19937 random(seed);
+        if (size > overhead + content.size()) {
+            size_t target = size - overhead;
+            content.reserve(target);
+            while (content.size() < target) content.push_back((char)('a' + random() % 26));
+        }
+        uint32_t crc = Crc32(content);
+
+        // Single stored (uncompressed) entry
+        std::string zip;
+        zip.reserve(content.size() + overhead);
+        Put32(zip, 0x04034b50); // Local file header
+        Put16(zip, 10);         // Version needed
+        Put16(zip, 0);          // Flags
+        Put16(zip, 0);          // Stored
+        Put16(zip, 0);          // Time
+        Put16(zip, 0x21);       // Date (1980-01-01)
+        Put32(zip, crc);
+        Put32(zip, (uint32_t)content.size());
+        Put32(zip, (uint32_t)content.size());
+        Put16(zip, (uint32_t)name.size());
+        Put16(zip, 0);
+        zip += name;
+        zip += content;
+
+        uint32_t centralOffset = (uint32_t)zip.size();
+        Put32(zip, 0x02014b50); // Central directory header
+        Put16(zip, 20);         // Version made by
+        Put16(zip, 10);
+        Put16(zip, 0);
+        Put16(zip, 0);
+        Put16(zip, 0);
+        Put16(zip, 0x21);
+        Put32(zip, crc);
+        Put32(zip, (uint32_t)content.size());
+        Put32(zip, (uint32_t)content.size());
+        Put16(zip, (uint32_t)name.size());
+        Put16(zip, 0);          // Extra length
+        Put16(zip, 0);          // Comment length
+        Put16(zip, 0);          // Disk number
+        Put16(zip, 0);          // Internal attributes
+        Put32(zip, 0);          // External attributes
+        Put32(zip, 0);          // Local header offset
+        zip += name;
+        uint32_t centralSize = (uint32_t)zip.size() - centralOffset;
+
+        Put32(zip, 0x06054b50); // End of central directory
+        Put16(zip, 0);
+        Put16(zip, 0);
+        Put16(zip, 1);
+        Put16(zip, 1);
+        Put32(zip, centralSize);
+        Put32(zip, centralOffset);
+        Put16(zip, 0);
+        return zip;
+    }
+
+    std::shared_ptr<FakeTransport::Exchange> FakeTransport::CreateExchange(const std::string& url) {
+        m_requests++;
+        auto exchange = std::make_shared<Exchange>();
+        exchange->url = url;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        // Longest registered prefix of url
+        size_t matched = 0;
+        for (const auto& route : m_routes) {
+            if (url.compare(0, route.first.size(), route.first) == 0 && (!exchange->response || route.first.size() > matched)) {
+                exchange->response = route.second;
+                matched = route.first.size();
+            }
+        }
+
+        exchange->profile = (exchange->response && exchange->response->profile) ? *exchange->response->profile
+                                                                                 : m_defaultProfile;
+        const FakeNetworkProfile& profile = exchange->profile;
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+        if (exchange->response) exchange->statusCode = exchange->response->statusCode;
+        if (unit(m_random) < profile.serverErrorRate) exchange->statusCode = 503;
+        else if (unit(m_random) < profile.rateLimitRate) exchange->statusCode = 429;
+
+        const std::string& payload = exchange->Payload();
+        if (!payload.empty() && unit(m_random) < profile.resetRate) {
+            exchange->resetAt = (int64_t)(unit(m_random) * payload.size());
+        }
+
+        double latencyMs = profile.latencyMs + (unit(m_random) * 2.0 - 1.0) * profile.jitterMs;
+        exchange->startTime = Clock::now();
+        exchange->firstByteTime = exchange->startTime +
+            std::chrono::microseconds((int64_t)((std::max)(0.0, latencyMs) * 1000.0));
+        return exchange;
+    }
+
+    void FakeTransport::Submit(std::shared_ptr<Exchange> exchange) {
+        // Same per-host budget as the curl transport, fed by the 429s injected below
+        std::chrono::milliseconds wait = RateLimiter::Instance().Acquire(exchange->url);
+        if (wait.count() > 0) {
+            HttpResult result;
+            result.statusCode = 429;
+            result.rateLimited = true;
+            result.retryAfterSeconds = wait.count() / 1000.0;
+            result.error = "Rate limited, retry in " + std::to_string((wait.count() + 999) / 1000) + " s";
+            Finish(*exchange, result);
+            return;
+        }
+
+        // Synchronous requests from a callback would wait on the worker forever; run them here
+        if (std::this_thread::get_id() == m_thread.get_id()) {
+            while (Step(*exchange, Clock::now())) {
+                std::this_thread::sleep_for(kTick);
+            }
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_stopping) {
+                m_exchanges.push_back(std::move(exchange));
+                m_cv.notify_one();
+                return;
+            }
+        }
+        HttpResult result;
+        result.error = "Transport shut down";
+        Finish(*exchange, result);
+    }
+
+    void FakeTransport::StartDownload(const std::string& url, const std::wstring& destPath,
+                                      ProgressCallback progressCb, ResultCallback done,
+                                      long timeoutSeconds, int segments, CancelTokenPtr cancel,
+                                      ExpectedPayload expect) {
+        // segments is ignored: the fake serves every download as one stream (see FakeTransport.h)
+        auto exchange = CreateExchange(url);
+        exchange->kind = ExchangeKind::Download;
+        exchange->destPath = destPath;
+        exchange->expect = expect;
+        exchange->progress = progressCb;
+        exchange->done = done;
+        exchange->cancel = cancel;
+        exchange->timeoutSeconds = timeoutSeconds;
+        Submit(exchange);
+    }
+
+    void FakeTransport::StartGet(const std::string& url, ResultCallback done, CancelTokenPtr cancel) {
+        auto exchange = CreateExchange(url);
+        exchange->kind = ExchangeKind::Get;
+        exchange->done = done;
+        exchange->cancel = cancel;
+        exchange->timeoutSeconds = 30;
+        Submit(exchange);
+    }
+
+    void FakeTransport::StartGetStream(const std::string& url, DataCallback onData, ResultCallback done,
+                                       CancelTokenPtr cancel) {
+        auto exchange = CreateExchange(url);
+        exchange->kind = ExchangeKind::Stream;
+        exchange->onData = onData;
+        exchange->done = done;
+        exchange->cancel = cancel;
+        exchange->timeoutSeconds = 30;
+        Submit(exchange);
+    }
+
+    void FakeTransport::StartGetRedirectUrl(const std::string& url, ResultCallback done) {
+        auto exchange = CreateExchange(url);
+        exchange->kind = ExchangeKind::Redirect;
+        exchange->done = done;
+        exchange->timeoutSeconds = 10;
+        Submit(exchange);
+    }
+
+    static std::filesystem::path PartPathOf(const std::wstring& destPath) {
+        return std::filesystem::path(destPath + L".part");
+    }
+
+    bool FakeTransport::Step(Exchange& exchange, Clock::time_point now) {
+        HttpResult result;
+        result.statusCode = exchange.statusCode;
+
+        if (exchange.cancel && exchange.cancel->IsCancelled()) {
+            result.cancelled = true;
+            result.error = "Cancelled";
+            Finish(exchange, result);
+            return false;
+        }
+        if (exchange.timeoutSeconds > 0 && now - exchange.startTime >= std::chrono::seconds(exchange.timeoutSeconds)) {
+            result.statusCode = exchange.started ? exchange.statusCode : 0;
+            result.error = kTimeoutError;
+            Finish(exchange, result);
+            return false;
+        }
+        if (now < exchange.firstByteTime) return true;
+
+        if (!exchange.started) {
+            exchange.started = true;
+            exchange.lastStep = now;
+
+            if (exchange.statusCode == 429) {
+                RateLimitInfo limits;
+                limits.statusCode = 429;
+                limits.retryAfterSeconds = exchange.profile.retryAfterSeconds;
+                RateLimiter::Instance().Observe(exchange.url, limits);
+            }
+
+            if (exchange.kind == ExchangeKind::Redirect) {
+                const std::string redirect = exchange.response ? exchange.response->redirectUrl : "";
+                if (!redirect.empty() && exchange.statusCode < 400) {
+                    result.success = true;
+                    result.statusCode = exchange.statusCode >= 300 ? exchange.statusCode : 302;
+                    result.redirectUrl = redirect;
+                } else {
+                    result.error = "No redirect found (HTTP " + std::to_string(exchange.statusCode) + ")";
+                }
+                Finish(exchange, result);
+                return false;
+            }
+
+            if (exchange.kind == ExchangeKind::Download && exchange.IsSuccessStatus()) {
+                std::string invalid = exchange.expect == ExpectedPayload::ZipArchive && exchange.response
+                    ? CheckArchiveHeaders(exchange.response->contentType, (int64_t)exchange.Payload().size()) : "";
+                if (!invalid.empty()) {
+                    result.error = invalid;
+                    result.invalidPayload = true;
+                    Finish(exchange, result);
+                    return false;
+                }
+                exchange.file.open(PartPathOf(exchange.destPath), std::ios::binary | std::ios::trunc);
+                if (!exchange.file.is_open()) {
+                    result.localError = true;
+                    result.error = "Failed to write file";
+                    Finish(exchange, result);
+                    return false;
+                }
+            }
+        }
+
+        const std::string& payload = exchange.Payload();
+        size_t chunk = payload.size() - exchange.sent;
+        if (exchange.profile.bandwidthBps > 0) {
+            exchange.allowance += std::chrono::duration<double>(now - exchange.lastStep).count() * exchange.profile.bandwidthBps;
+            chunk = (std::min)(chunk, (size_t)exchange.allowance);
+            exchange.allowance -= (double)chunk;
+        }
+        exchange.lastStep = now;
+        if (exchange.resetAt >= 0) {
+            chunk = (std::min)(chunk, (size_t)exchange.resetAt - exchange.sent);
+        }
+
+        if (chunk > 0) {
+            const char* data = payload.data() + exchange.sent;
+            bool ok = true;
+            switch (exchange.kind) {
+                case ExchangeKind::Get:
+                    exchange.body.append(data, chunk);
+                    break;
+                case ExchangeKind::Stream:
+                    // Like the curl transport, error pages are not handed to the decoder
+                    if (exchange.IsSuccessStatus() && exchange.onData) ok = exchange.onData(data, chunk);
+                    break;
+                case ExchangeKind::Download:
+                    if (exchange.expect == ExpectedPayload::ZipArchive && exchange.file.is_open() &&
+                        exchange.sniffer.Feed(data, chunk) == ZipSignatureSniffer::Verdict::Invalid) {
+                        result.error = "Mirror sent " + exchange.sniffer.Describe() + " instead of an archive";
+                        result.invalidPayload = true;
+                        Finish(exchange, result);
+                        return false;
+                    }
+                    if (exchange.file.is_open()) ok = (bool)exchange.file.write(data, (std::streamsize)chunk);
+                    break;
+                default:
+                    break;
+            }
+            exchange.sent += chunk;
+            if (!ok) {
+                result.localError = exchange.kind == ExchangeKind::Download; // A stream's receiver refusing is not a disk problem
+                result.error = kWriteError;
+                Finish(exchange, result);
+                return false;
+            }
+            if (exchange.progress && !payload.empty()) {
+                exchange.progress((double)exchange.sent, (double)payload.size());
+            }
+        }
+
+        if (exchange.resetAt >= 0 && (int64_t)exchange.sent >= exchange.resetAt) {
+            result.error = kResetError;
+            Finish(exchange, result);
+            return false;
+        }
+        if (exchange.sent < payload.size()) return true;
+
+        result.success = exchange.IsSuccessStatus();
+        if (!result.success) result.error = "HTTP " + std::to_string(exchange.statusCode);
+        if (exchange.statusCode == 429) {
+            result.rateLimited = true;
+            result.retryAfterSeconds = exchange.profile.retryAfterSeconds;
+        }
+        result.body = std::move(exchange.body);
+        Finish(exchange, result);
+        return false;
+    }
+
+    void FakeTransport::Finish(Exchange& exchange, HttpResult result) {
+        if (exchange.kind == ExchangeKind::Download) {
+            std::error_code ec;
+            if (exchange.file.is_open()) exchange.file.close();
+            std::string invalid;
+            if (result.success && exchange.expect == ExpectedPayload::ZipArchive &&
+                !ValidateZipArchive(PartPathOf(exchange.destPath).wstring(), &invalid)) {
+                result.success = false;
+                result.invalidPayload = true;
+                result.error = invalid;
+            }
+            if (result.success) {
+                std::filesystem::rename(PartPathOf(exchange.destPath), std::filesystem::path(exchange.destPath), ec);
+                if (ec) {
+                    result.success = false;
+                    result.error = "Failed to move file into place";
+                }
+            }
+            if (!result.success) {
+                // There are no validators to resume against, so nothing is worth keeping
+                std::filesystem::remove(PartPathOf(exchange.destPath), ec);
+            }
+            std::filesystem::remove(std::filesystem::path(exchange.destPath + L".part.meta"), ec);
+            result.networkSeconds = std::chrono::duration<double>(Clock::now() - exchange.startTime).count();
+        }
+        if (exchange.done) exchange.done(result);
+    }
+
+    void FakeTransport::WorkerThread() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (!m_stopping) {
+            if (m_exchanges.empty()) {
+                m_cv.wait(lock);
+                continue;
+            }
+
+            std::vector<std::shared_ptr<Exchange>> batch = m_exchanges;
+            lock.unlock();
+            auto now = Clock::now();
+            std::vector<Exchange*> finished;
+            for (const auto& exchange : batch) {
+                if (!Step(*exchange, now)) finished.push_back(exchange.get());
+            }
+            lock.lock();
+
+            m_exchanges.erase(std::remove_if(m_exchanges.begin(), m_exchanges.end(),
+                [&finished](const std::shared_ptr<Exchange>& exchange) {
+                    return std::find(finished.begin(), finished.end(), exchange.get()) != finished.end();
+                }), m_exchanges.end());
+            m_cv.wait_for(lock, kTick, [this] { return m_stopping; });
+        }
+
+        // Whatever is still running fails instead of leaving its caller waiting
+        std::vector<std::shared_ptr<Exchange>> abandoned;
+        abandoned.swap(m_exchanges);
+        lock.unlock();
+        for (const auto& exchange : abandoned) {
+            HttpResult result;
+            result.error = "Transport shut down";
+            Finish(*exchange, result);
+        }
+    }
+
+}
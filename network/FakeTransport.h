@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Transport.h"
+
+namespace network {
+
+    // Network conditions the fake imposes on a response
+    struct FakeNetworkProfile {
+        double latencyMs = 0;        // Before the first byte
+        double jitterMs = 0;         // Latency varies uniformly by up to this much either way
+        int64_t bandwidthBps = 0;    // Per transfer, 0 = unlimited
+        double resetRate = 0;        // Chance a transfer is cut off part way through the body
+        double serverErrorRate = 0;  // Chance of a 503 instead of the response
+        double rateLimitRate = 0;    // Chance of a 429 instead of the response
+        double retryAfterSeconds = 1; // Retry-After sent with those 429s
+    };
+
+    struct FakeResponse {
+        long statusCode = 200;
+        std::string body;
+        std::string contentType;                   // Sent with the body; downloads expecting an archive check it
+        std::string redirectUrl;                   // Answer for GetRedirectUrl
+        std::optional<FakeNetworkProfile> profile; // Replaces the default profile for this route
+    };
+
+    // In-process Transport for exercising downloads, failover and scheduling without
+    // a network. Responses are registered by URL prefix (the longest match wins,
+    // unmatched URLs get a 404) and delivered from one worker thread, paced by the
+    // profile's latency and bandwidth. Install with HttpRequest::SetTransport.
+    // Only tools/FakeTransportHarness builds it; the DLL does not.
+    // Limitation: a download is always one stream. The segments argument is
+    // ignored, so segmented downloads (ranged parallel streams, resume of
+    // individual ranges, per-segment failures) can't be exercised through the
+    // fake; only whole-transfer scheduling and failover can.
+    class FakeTransport : public Transport {
+    public:
+        // seed makes the injected latency, resets and errors reproducible
+        explicit FakeTransport(uint32_t seed = 1);
+        ~FakeTransport() override;
+
+        void SetDefaultProfile(const FakeNetworkProfile& profile);
+        void AddResponse(const std::string& urlPrefix, FakeResponse response);
+        // Serves a synthetic .osz of about size bytes for downloads under urlPrefix
+        void AddBeatmapArchive(const std::string& urlPrefix, size_t size,
+                               std::optional<FakeNetworkProfile> profile = std::nullopt);
+
+        // Valid zip archive holding one stored .osu file, padded to about size bytes
+        static std::string MakeBeatmapArchive(size_t size, uint32_t seed = 0);
+
+        uint64_t GetRequestCount() const { return m_requests.load(); }
+        size_t GetActiveTransfers() const;
+
+        void StartDownload(const std::string& url, const std::wstring& destPath,
+                           ProgressCallback progressCb, ResultCallback done,
+                           long timeoutSeconds, int segments, CancelTokenPtr cancel,
+                           ExpectedPayload expect) override;
+        void StartGet(const std::string& url, ResultCallback done, CancelTokenPtr cancel) override;
+        void StartGetStream(const std::string& url, DataCallback onData, ResultCallback done,
+                            CancelTokenPtr cancel) override;
+        void StartGetRedirectUrl(const std::string& url, ResultCallback done) override;
+
+    private:
+        using Clock = std::chrono::steady_clock;
+        struct Exchange;
+
+        std::shared_ptr<Exchange> CreateExchange(const std::string& url);
+        void Submit(std::shared_ptr<Exchange> exchange);
+        // Moves the exchange forward to now; returns false once it has finished
+        bool Step(Exchange& exchange, Clock::time_point now);
+        void Finish(Exchange& exchange, HttpResult result);
+        void WorkerThread();
+
+        mutable std::mutex m_mutex;
+        std::condition_variable m_cv;
+        std::map<std::string, std::shared_ptr<const FakeResponse>> m_routes;
+        FakeNetworkProfile m_defaultProfile;
+        std::mt19937 m_random;
+        std::vector<std::shared_ptr<Exchange>> m_exchanges; // Guarded by m_mutex
+        bool m_stopping = false;
+        std::thread m_thread;
+        std::atomic<uint64_t> m_requests{0};
+    };
+
+}
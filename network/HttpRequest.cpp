@@ -1,180 +1,826 @@
 #include "HttpRequest.h"
+#include "BandwidthShaper.h"
+#include "ConnectionPool.h"
+#include "DiskWriter.h"
+#include "NetworkEngine.h"
+#include "SegmentedDownload.h"
+#include "PartFile.h"
+#include "PayloadCheck.h"
+#include "RateLimiter.h"
+#include "ResponseCache.h"
+#include "utils/logging.h"
 #include <curl/curl.h>
-#include <fstream>
-#include <thread>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <iostream>
-#include <windows.h> // For DeleteFileW
+#include <windows.h>
 
 namespace network {
 
     // Helper for writing to string
     static size_t WriteStringCallback(void* contents, size_t size, size_t nmemb, void* userp) {
+        BandwidthShaper::Instance().Charge(size * nmemb);
         ((std::string*)userp)->append((char*)contents, size * nmemb);
         return size * nmemb;
     }
 
-    // Helper for writing to file
-    static size_t WriteFileCallback(void* contents, size_t size, size_t nmemb, void* userp) {
-        std::ofstream* file = (std::ofstream*)userp;
-        file->write((char*)contents, size * nmemb);
-        return size * nmemb;
-    }
+    // Responses up to this size are copied for the response cache
+    static const size_t kMaxCachedBody = 1024 * 1024;
+    static const size_t kCacheMemoryBudget = 4 * 1024 * 1024;
+    static const size_t kCacheDiskBudget = 32 * 1024 * 1024;
 
     // Helper for progress
     struct ProgressData {
         HttpRequest::ProgressCallback callback;
+        int64_t offset = 0; // Bytes already on disk from an earlier attempt
+        CancelTokenPtr cancel;
     };
 
+    // Per-transfer state for streamed GETs
+    struct StreamTransfer {
+        CURL* handle = nullptr;
+        HttpRequest::DataCallback onData;
+        std::string body;          // Copy of the body for the response cache
+        bool bodyTooLarge = false;
+        ProgressData progress;     // Cancellation only
+    };
+
+    // Helper for handing body chunks to a DataCallback
+    static size_t WriteStreamCallback(void* contents, size_t size, size_t nmemb, void* userp) {
+        StreamTransfer* transfer = (StreamTransfer*)userp;
+        size_t bytes = size * nmemb;
+        BandwidthShaper::Instance().Charge(bytes);
+
+        // Error pages are not worth decoding
+        long response_code = 0;
+        curl_easy_getinfo(transfer->handle, CURLINFO_RESPONSE_CODE, &response_code);
+        if (response_code < 200 || response_code >= 300) return bytes;
+
+        if (!transfer->bodyTooLarge) {
+            if (transfer->body.size() + bytes <= kMaxCachedBody) {
+                transfer->body.append((const char*)contents, bytes);
+            } else {
+                transfer->bodyTooLarge = true;
+                transfer->body.clear();
+            }
+        }
+
+        if (transfer->onData && !transfer->onData((const char*)contents, bytes)) return 0;
+        return bytes;
+    }
+
     static int ProgressCallbackWrapper(void* clientp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow) {
         ProgressData* data = (ProgressData*)clientp;
+        if (data->cancel && data->cancel->IsCancelled()) return 1;
         if (data->callback && dltotal > 0) {
-            data->callback((double)dlnow, (double)dltotal);
+            data->callback((double)(dlnow + data->offset), (double)(dltotal + data->offset));
         }
         return 0;
     }
 
+    // Sidecar is rewritten after this many new bytes so a crash loses little progress
+    static const int64_t kCheckpointBytes = 1024 * 1024;
+    // A download below kLowSpeedLimit bytes/s for kLowSpeedTime seconds is given up
+    static const long kLowSpeedLimit = 1;
+    static const long kLowSpeedTime = 60;
+
+    // Per-transfer state, kept alive by the completion callback until curl is done with it
+    struct DownloadTransfer {
+        CURL* handle = nullptr;
+        std::shared_ptr<FileSink> sink;
+        int stream = 0;
+        ProgressData progress;
+        std::wstring destPath;
+        PartFileState state;
+        int64_t resumeOffset = 0;  // Offset requested with Range, 0 for a fresh download
+        int64_t lastCheckpoint = 0;
+        bool discardBody = false;  // Error responses are not written to the .part file
+        bool sizeMismatch = false; // A 206 that does not line up with the partial file
+        ExpectedPayload expect = ExpectedPayload::Any;
+        ZipSignatureSniffer sniffer;
+        std::string invalidPayload; // Why the body is not what was expected; set when the transfer is aborted for it
+        struct curl_slist* headers = nullptr;
+
+        ~DownloadTransfer() {
+            if (headers) curl_slist_free_all(headers);
+        }
+    };
+
+    static std::string ResponseHeader(CURL* curl, const char* name) {
+        struct curl_header* header = nullptr;
+        if (curl_easy_header(curl, name, 0, CURLH_HEADER, -1, &header) == CURLHE_OK && header) {
+            return header->value;
+        }
+        return "";
+    }
+
+    // Cached copy of a GET and the conditional headers that revalidate it
+    struct CacheLookup {
+        std::string url;
+        bool found = false;
+        CachedResponse cached;
+        struct curl_slist* headers = nullptr;
+
+        ~CacheLookup() {
+            if (headers) curl_slist_free_all(headers);
+        }
+    };
+
+    static std::shared_ptr<CacheLookup> LookupCache(const std::string& url) {
+        auto lookup = std::make_shared<CacheLookup>();
+        lookup->url = url;
+        lookup->found = ResponseCache::Instance().Lookup(url, lookup->cached);
+        return lookup;
+    }
+
+    static void AddValidators(CURL* curl, CacheLookup& lookup) {
+        if (!lookup.found) return;
+        if (!lookup.cached.etag.empty()) {
+            lookup.headers = curl_slist_append(lookup.headers, ("If-None-Match: " + lookup.cached.etag).c_str());
+        }
+        if (!lookup.cached.lastModified.empty()) {
+            lookup.headers = curl_slist_append(lookup.headers, ("If-Modified-Since: " + lookup.cached.lastModified).c_str());
+        }
+        if (lookup.headers) curl_easy_setopt(curl, CURLOPT_HTTPHEADER, lookup.headers);
+    }
+
+    // Files a finished GET with the cache. Returns true when a 304 confirmed the cached
+    // body, in which case result is turned into a success the caller serves from the cache.
+    static bool UpdateCache(CURL* curl, const CacheLookup& lookup, HttpResult& result, const std::string& body) {
+        int64_t expires = 0;
+        bool storable = ResponseCache::ParseFreshness(ResponseHeader(curl, "Cache-Control"),
+                                                      ResponseHeader(curl, "Expires"), expires);
+
+        if (result.statusCode == 304 && lookup.found) {
+            ResponseCache::Instance().Refresh(lookup.url, expires);
+            ResponseCache::Instance().RecordRevalidated();
+            result.success = true;
+            result.error.clear();
+            return true;
+        }
+
+        if (result.success && result.statusCode == 200) {
+            ResponseCache::Instance().RecordMiss();
+            CachedResponse response;
+            response.etag = ResponseHeader(curl, "ETag");
+            response.lastModified = ResponseHeader(curl, "Last-Modified");
+            response.expires = expires;
+            if (storable && (response.HasValidator() || expires > 0)) {
+                response.body = body;
+                ResponseCache::Instance().Store(lookup.url, std::move(response));
+            }
+        }
+        return false;
+    }
+
+    // Runs the callbacks of a request answered from the cache on the network thread,
+    // where they would have run for a real transfer
+    static void DeliverCached(std::function<void()> task) {
+        NetworkEngine& engine = NetworkEngine::Instance();
+        if (engine.IsReactorThread() && !engine.CanDefer()) {
+            task();
+        } else {
+            engine.Post(std::move(task));
+        }
+    }
+
+    // Opens the .part file once the response status is known. A 206 continues the
+    // existing data; anything else means the server sent the whole file (no range
+    // support, or If-Range found the file changed), so we start over.
+    static bool OpenPartFile(DownloadTransfer* transfer) {
+        long response_code = 0;
+        curl_easy_getinfo(transfer->handle, CURLINFO_RESPONSE_CODE, &response_code);
+        if (response_code < 200 || response_code >= 300) {
+            transfer->discardBody = true;
+            return true;
+        }
+
+        std::wstring partPath = PartFile::PartPath(transfer->destPath);
+        curl_off_t contentLength = -1;
+        curl_easy_getinfo(transfer->handle, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &contentLength);
+
+        if (response_code == 206 && transfer->resumeOffset > 0 && transfer->state.totalSize > 0 && contentLength > 0 &&
+            transfer->resumeOffset + contentLength != transfer->state.totalSize) {
+            // The validator matched but the size does not; never splice two different files
+            LogInfo("Resumed response does not match the partial download, discarding it");
+            transfer->discardBody = true;
+            transfer->sizeMismatch = true;
+            return true;
+        }
+
+        if (response_code == 206 && transfer->resumeOffset > 0) {
+            // Anything past the last checkpoint is overwritten, and the size is fixed up on close
+            if (contentLength > 0) transfer->state.totalSize = transfer->resumeOffset + contentLength;
+            transfer->sink = FileSink::Open(partPath, transfer->state.totalSize, true);
+        } else {
+            if (transfer->expect == ExpectedPayload::ZipArchive) {
+                // Rejected before a byte is written, so an earlier partial download stays usable
+                char* contentType = nullptr;
+                curl_easy_getinfo(transfer->handle, CURLINFO_CONTENT_TYPE, &contentType);
+                transfer->invalidPayload = CheckArchiveHeaders(contentType ? contentType : "", contentLength);
+                if (!transfer->invalidPayload.empty()) return false;
+            }
+            if (transfer->resumeOffset > 0) {
+                LogInfo("Partial download is out of date, restarting");
+            }
+            transfer->resumeOffset = 0;
+            transfer->progress.offset = 0;
+            transfer->state.bytesWritten = 0;
+            transfer->state.pendingRanges.clear();
+            transfer->state.totalSize = contentLength;
+            transfer->state.etag = ResponseHeader(transfer->handle, "ETag");
+            transfer->state.lastModified = ResponseHeader(transfer->handle, "Last-Modified");
+            transfer->sink = FileSink::Open(partPath, contentLength, false);
+        }
+
+        if (!transfer->sink) return false;
+        transfer->stream = transfer->sink->OpenStream(transfer->resumeOffset);
+        transfer->lastCheckpoint = transfer->state.bytesWritten;
+        if (transfer->state.HasValidator()) {
+            PartFile::Save(transfer->destPath, transfer->state);
+        }
+        return true;
+    }
+
+    // Helper for writing to the .part file; the bytes go to the disk writer thread
+    static size_t WriteFileCallback(void* contents, size_t size, size_t nmemb, void* userp) {
+        DownloadTransfer* transfer = (DownloadTransfer*)userp;
+        size_t bytes = size * nmemb;
+
+        if (!transfer->sink && !transfer->discardBody) {
+            if (!OpenPartFile(transfer)) return 0;
+        }
+        if (transfer->discardBody) return bytes;
+
+        if (transfer->sink->Failed()) return 0;
+        // Over the bandwidth limit; the shaper resumes the handle once tokens are free
+        if (!BandwidthShaper::Instance().Admit(transfer->handle, bytes)) return CURL_WRITEFUNC_PAUSE;
+        if (!transfer->sink->Write(transfer->stream, contents, bytes, transfer->handle)) {
+            BandwidthShaper::Instance().Refund(transfer->handle, bytes);
+            return CURL_WRITEFUNC_PAUSE;
+        }
+
+        // A resumed body starts mid-archive; only a fresh one can be checked for the signature
+        if (transfer->expect == ExpectedPayload::ZipArchive && transfer->resumeOffset == 0 &&
+            transfer->sniffer.Feed(contents, bytes) == ZipSignatureSniffer::Verdict::Invalid) {
+            transfer->invalidPayload = "Mirror sent " + transfer->sniffer.Describe() + " instead of an archive";
+            return 0;
+        }
+
+        // Only bytes the writer has handed to the OS go into the sidecar
+        int64_t durable = transfer->sink->DurableOffset(transfer->stream);
+        if (transfer->state.HasValidator() && durable - transfer->lastCheckpoint >= kCheckpointBytes) {
+            transfer->state.bytesWritten = durable;
+            PartFile::Save(transfer->destPath, transfer->state);
+            transfer->lastCheckpoint = durable;
+        }
+        return bytes;
+    }
+
+    // Runs once the disk writer has closed the .part file
+    static void FinishDownload(DownloadTransfer& transfer, HttpResult& result, bool writeOk) {
+        DiskTimings timings = transfer.sink->GetTimings();
+        result.networkSeconds = timings.networkSeconds;
+        result.diskSeconds = timings.diskSeconds;
+        result.diskStallSeconds = timings.stallSeconds;
+        LogInfo("Download timing: network " + std::to_string(timings.networkSeconds) + " s, disk " +
+                std::to_string(timings.diskSeconds) + " s, stalled on disk " + std::to_string(timings.stallSeconds) + " s");
+
+        if (result.success && !writeOk) {
+            result.success = false;
+            result.localError = true;
+            result.error = "Failed to write file";
+        }
+
+        transfer.state.bytesWritten = transfer.sink->DurableOffset(transfer.stream);
+        std::string invalid;
+        if (result.success && transfer.expect == ExpectedPayload::ZipArchive &&
+            !ValidateZipArchive(PartFile::PartPath(transfer.destPath), &invalid)) {
+            result.success = false;
+            result.invalidPayload = true;
+            result.error = invalid;
+        }
+        if (result.success) {
+            if (!PartFile::Commit(transfer.destPath)) {
+                result.success = false;
+                result.localError = true;
+                result.error = "Failed to move file into place";
+            }
+        } else if (transfer.state.HasValidator() && transfer.state.bytesWritten > 0 &&
+                   result.statusCode < 400 && !result.invalidPayload) {
+            // Keep the partial data so the next attempt can continue with a Range request
+            PartFile::Save(transfer.destPath, transfer.state);
+            LogInfo("Kept " + std::to_string((long long)transfer.state.bytesWritten) +
+                    " bytes of partial download for resume");
+        } else {
+            PartFile::Discard(transfer.destPath);
+        }
+    }
+
+    static void ApplyCommonOptions(CURL* curl, const std::string& url, long timeoutSeconds) {
+        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT, timeoutSeconds);
+    }
+
+    // Fills status code and error, and counts connection reuse for transfers that reached the server
+    static void FinishResult(CURL* curl, CURLcode res, HttpResult& result, const std::string& url) {
+        long response_code = 0;
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
+        if (response_code != 0) {
+            ConnectionPool::Instance().RecordTransfer(curl);
+            // Kept under the URL we asked for, which is what the next request will be checked against
+            RateLimitInfo limits = RateLimiter::FromResponse(curl);
+            RateLimiter::Instance().Observe(url, limits);
+            if (response_code == 429 || limits.retryAfterSeconds >= 0) {
+                result.rateLimited = response_code == 429;
+                result.retryAfterSeconds = RateLimiter::Instance().Delay(url).count() / 1000.0;
+            }
+        } else if (res != CURLE_OK) {
+            ConnectionPool::Instance().RecordFailure(curl, res);
+        }
+
+        result.statusCode = response_code;
+        result.success = (res == CURLE_OK) && (response_code >= 200 && response_code < 300);
+        if (!result.success) {
+            if (res != CURLE_OK) result.error = curl_easy_strerror(res);
+            else result.error = "HTTP " + std::to_string(response_code);
+        }
+        if (res == CURLE_ABORTED_BY_CALLBACK && NetworkEngine::Instance().IsStopping()) {
+            // Shutting down; no mirror or retry would get further
+            result.localError = true;
+            result.error = "Network engine stopped";
+        }
+    }
+
+    // Answers a request for a host that asked us to back off without sending it; returns true if it did
+    static bool HoldForRateLimit(const std::string& url, const Transport::ResultCallback& done) {
+        std::chrono::milliseconds wait = RateLimiter::Instance().Acquire(url);
+        if (wait.count() == 0) return false;
+
+        HttpResult result;
+        result.statusCode = 429;
+        result.rateLimited = true;
+        result.retryAfterSeconds = wait.count() / 1000.0;
+        result.error = "Rate limited, retry in " + std::to_string((wait.count() + 999) / 1000) + " s";
+        if (done) done(result);
+        return true;
+    }
+
+    // Marks the result of a transfer whose token was cancelled; returns true if it was
+    static bool ApplyCancellation(const CancelTokenPtr& cancel, HttpResult& result) {
+        if (!cancel || !cancel->IsCancelled()) return false;
+        result.success = false;
+        result.cancelled = true;
+        result.error = "Cancelled";
+        return true;
+    }
+
+    // Runs an asynchronous starter and blocks until its result callback fires
+    template <typename StartFn>
+    static HttpResult Wait(StartFn start) {
+        std::optional<NetworkEngine::InlineScope> inlineScope;
+        if (NetworkEngine::Instance().IsReactorThread()) {
+            inlineScope.emplace();
+        }
+
+        auto promise = std::make_shared<std::promise<HttpResult>>();
+        std::future<HttpResult> future = promise->get_future();
+        start([promise](const HttpResult& result) { promise->set_value(result); });
+        return future.get();
+    }
+
+    // Installed fake, or null for CurlTransport
+    static std::mutex g_TransportMutex;
+    static std::shared_ptr<Transport> g_Transport;
+
     void HttpRequest::GlobalInit() {
         curl_global_init(CURL_GLOBAL_DEFAULT);
+        ConnectionPool::Instance().Initialize();
+        DiskWriter::Instance().Start();
+        NetworkEngine::Instance().Start();
     }
 
     void HttpRequest::GlobalCleanup() {
+        NetworkEngine::Instance().Stop();
+        ResponseCache::Instance().Stop();
+        // Stopped after the engine so aborted downloads can still close their files
+        DiskWriter::Instance().Stop();
+        ConnectionPool::Instance().Shutdown();
         curl_global_cleanup();
     }
 
-    bool HttpRequest::Download(const std::string& url, const std::wstring& destPath, 
-                               ProgressCallback progressCb, std::string* outError, long timeoutSeconds) {
-        CURL* curl = curl_easy_init();
-        if (!curl) {
-            if (outError) *outError = "Failed to init curl";
-            return false;
+    void HttpRequest::SetMemoryMappedOutput(bool enabled) {
+        DiskWriter::Instance().SetMemoryMapped(enabled);
+    }
+
+    void HttpRequest::SetBandwidthLimits(int globalKBps, int backgroundKBps) {
+        BandwidthShaper::Instance().SetLimits((int64_t)globalKBps * 1024, (int64_t)backgroundKBps * 1024);
+    }
+
+    int64_t HttpRequest::GetDownloadRateLimit() {
+        return BandwidthShaper::Instance().GetDownloadLimit();
+    }
+
+    ConnectionStats HttpRequest::GetConnectionStats() {
+        return ConnectionPool::Instance().GetStats();
+    }
+
+    void HttpRequest::Prewarm(const std::vector<std::string>& urls) {
+        {
+            // A substitute transport has no real connections to warm
+            std::lock_guard<std::mutex> lock(g_TransportMutex);
+            if (g_Transport) return;
         }
+        ConnectionWarmer::Instance().Warm(urls);
+    }
 
-        std::ofstream outFile(destPath, std::ios::binary);
-        if (!outFile.is_open()) {
-            if (outError) *outError = "Failed to open file";
-            curl_easy_cleanup(curl);
-            return false;
+    WarmupStats HttpRequest::GetWarmupStats() {
+        return ConnectionWarmer::Instance().GetStats();
+    }
+
+    void HttpRequest::EnableResponseCache(const std::wstring& directory) {
+        ResponseCache::Instance().Start(directory, kCacheMemoryBudget, kCacheDiskBudget);
+    }
+
+    CacheStats HttpRequest::GetCacheStats() {
+        return ResponseCache::Instance().GetStats();
+    }
+
+    void HttpRequest::EnableSessionCache(const std::wstring& path) {
+        ConnectionPool::Instance().RestoreSessions(path);
+    }
+
+    SessionCacheStats HttpRequest::GetSessionCacheStats() {
+        return SessionCache::Instance().GetStats();
+    }
+
+    std::vector<HostBudget> HttpRequest::GetRateLimits() {
+        return RateLimiter::Instance().GetBudgets();
+    }
+
+    CurlTransport& CurlTransport::Instance() {
+        static CurlTransport instance;
+        return instance;
+    }
+
+    void CurlTransport::StartDownload(const std::string& url, const std::wstring& destPath,
+                                      ProgressCallback progressCb, ResultCallback done, long timeoutSeconds, int segments,
+                                      CancelTokenPtr cancel, ExpectedPayload expect) {
+        if (HoldForRateLimit(url, done)) return;
+        if (segments > 1) {
+            SegmentedDownload::Start(url, destPath, segments, progressCb, done, timeoutSeconds, cancel, expect);
+            return;
         }
 
-        ProgressData progData = { progressCb };
+        auto transfer = std::make_shared<DownloadTransfer>();
+        transfer->destPath = destPath;
+        transfer->expect = expect;
+        transfer->progress.callback = progressCb;
+        transfer->progress.cancel = cancel;
+        transfer->state.url = url;
 
-        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+        // Pick up where an earlier attempt left off if it was for the same URL and can be validated
+        PartFileState previous;
+        if (PartFile::Load(destPath, previous)) {
+            int64_t offset = previous.ContiguousBytes();
+            if (previous.url == url && previous.HasValidator() && offset > 0) {
+                std::string invalid;
+                if (previous.totalSize > 0 && offset >= previous.totalSize && expect == ExpectedPayload::ZipArchive &&
+                    !ValidateZipArchive(PartFile::PartPath(destPath), &invalid)) {
+                    // Complete but broken; fetch it again rather than hand it over
+                    LogInfo("Finished partial download is not a valid archive (" + invalid + "), restarting");
+                    PartFile::Discard(destPath);
+                } else if (previous.totalSize > 0 && offset >= previous.totalSize) {
+                    HttpResult result;
+                    result.success = PartFile::Commit(destPath);
+                    result.statusCode = result.success ? 200 : 0;
+                    result.resumedFrom = offset;
+                    if (!result.success) {
+                        result.localError = true;
+                        result.error = "Failed to move file into place";
+                    }
+                    if (done) done(result);
+                    return;
+                }
+                transfer->state = previous;
+                transfer->state.bytesWritten = offset;
+                transfer->state.pendingRanges.clear();
+                transfer->resumeOffset = offset;
+                transfer->progress.offset = offset;
+            } else {
+                PartFile::Discard(destPath);
+            }
+        }
+
+        CURL* curl = ConnectionPool::Instance().Acquire();
+        if (!curl) {
+            HttpResult result;
+            result.localError = true;
+            result.error = "Failed to init curl";
+            if (done) done(result);
+            return;
+        }
+        transfer->handle = curl;
+
+        ApplyCommonOptions(curl, url, timeoutSeconds);
         curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteFileCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &outFile);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, transfer.get());
         curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, ProgressCallbackWrapper);
-        curl_easy_setopt(curl, CURLOPT_XFERINFODATA, &progData);
+        curl_easy_setopt(curl, CURLOPT_XFERINFODATA, &transfer->progress);
         curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
         curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L); // For compatibility
-        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
-        curl_easy_setopt(curl, CURLOPT_USERAGENT, "osu! Beatmap Downloader/1.0");
-        curl_easy_setopt(curl, CURLOPT_TIMEOUT, timeoutSeconds);
         curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 30L);
+        // Backstop for dead connections when there is no overall timeout; callers that
+        // want smarter stall handling watch the progress callback themselves
+        curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, kLowSpeedLimit);
+        curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, kLowSpeedTime);
 
-        CURLcode res = curl_easy_perform(curl);
-        
-        outFile.close();
-        
-        long response_code;
-        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
+        if (transfer->resumeOffset > 0) {
+            LogInfo("Resuming download at byte " + std::to_string((long long)transfer->resumeOffset));
+            curl_easy_setopt(curl, CURLOPT_RESUME_FROM_LARGE, (curl_off_t)transfer->resumeOffset);
+            // Server sends the full file instead of a 206 if it changed since the first attempt
+            std::string ifRange = "If-Range: " + transfer->state.IfRangeValue();
+            transfer->headers = curl_slist_append(transfer->headers, ifRange.c_str());
+            curl_easy_setopt(curl, CURLOPT_HTTPHEADER, transfer->headers);
+        }
 
-        bool success = (res == CURLE_OK) && (response_code >= 200 && response_code < 300);
+        NetworkEngine::Instance().Submit(curl, [transfer, done](CURL* handle, CURLcode res) {
+            auto result = std::make_shared<HttpResult>();
+            FinishResult(handle, res, *result, transfer->state.url);
+            result->resumedFrom = transfer->resumeOffset;
+            ApplyCancellation(transfer->progress.cancel, *result);
 
-        if (!success) {
-            if (outError) {
-                if (res != CURLE_OK) *outError = curl_easy_strerror(res);
-                else *outError = "HTTP " + std::to_string(response_code);
+            if (result->success && transfer->discardBody) {
+                result->success = false;
+                result->error = transfer->sizeMismatch ? "Partial download does not match the server's file"
+                                                       : "HTTP " + std::to_string(result->statusCode);
+            }
+            if (!transfer->invalidPayload.empty() && !result->cancelled) {
+                LogInfo("Aborted download from " + transfer->state.url + ": " + transfer->invalidPayload);
+                result->success = false;
+                result->invalidPayload = true;
+                result->error = transfer->invalidPayload;
+            }
+
+            if (!transfer->sink) {
+                // Nothing was received; an earlier partial download stays for the next attempt
+                if (transfer->resumeOffset == 0 || result->statusCode >= 400 || transfer->sizeMismatch) {
+                    PartFile::Discard(transfer->destPath);
+                }
+                if (done) done(*result);
+                return;
             }
-            // Delete partial file
-            DeleteFileW(destPath.c_str());
-        }
 
-        curl_easy_cleanup(curl);
-        return success;
+            transfer->sink->Detach(handle);
+            transfer->handle = nullptr;
+            // Cut the preallocated file back to what was actually received
+            int64_t end = transfer->sink->EndOffset(transfer->stream);
+            transfer->sink->Close(end, [transfer, result, done](bool ok) {
+                FinishDownload(*transfer, *result, ok);
+                if (done) done(*result);
+            });
+        }, cancel);
     }
 
-    bool HttpRequest::Get(const std::string& url, std::string& outResponse, std::string* outError) {
-        CURL* curl = curl_easy_init();
-        if (!curl) return false;
+    void CurlTransport::StartGet(const std::string& url, ResultCallback done, CancelTokenPtr cancel) {
+        auto lookup = LookupCache(url);
+        if (lookup->found && lookup->cached.IsFresh()) {
+            ResponseCache::Instance().RecordFreshHit();
+            DeliverCached([lookup, done, cancel]() {
+                HttpResult result;
+                if (!ApplyCancellation(cancel, result)) {
+                    result.success = true;
+                    result.statusCode = 200;
+                    result.body = lookup->cached.body;
+                }
+                if (done) done(result);
+            });
+            return;
+        }
+        if (HoldForRateLimit(url, done)) return;
 
-        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+        CURL* curl = ConnectionPool::Instance().Acquire();
+        if (!curl) {
+            HttpResult result;
+            result.localError = true;
+            result.error = "Failed to init curl";
+            if (done) done(result);
+            return;
+        }
+
+        auto body = std::make_shared<std::string>();
+        // Only consulted by transfers run inline; the engine aborts the rest itself
+        auto progress = std::make_shared<ProgressData>();
+        progress->cancel = cancel;
+
+        ApplyCommonOptions(curl, url, 30L);
         curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteStringCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &outResponse);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, body.get());
         curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
-        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
-        curl_easy_setopt(curl, CURLOPT_USERAGENT, "osu! Beatmap Downloader/1.0");
-        curl_easy_setopt(curl, CURLOPT_TIMEOUT, 30L);
+        if (cancel) {
+            curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, ProgressCallbackWrapper);
+            curl_easy_setopt(curl, CURLOPT_XFERINFODATA, progress.get());
+            curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+        }
+        AddValidators(curl, *lookup);
 
-        CURLcode res = curl_easy_perform(curl);
-        long response_code;
-        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
+        NetworkEngine::Instance().Submit(curl, [url, body, lookup, progress, done](CURL* handle, CURLcode res) {
+            HttpResult result;
+            FinishResult(handle, res, result, url);
+            if (ApplyCancellation(progress->cancel, result)) {
+                // A cut-off body is not worth keeping
+            } else if (UpdateCache(handle, *lookup, result, *body)) {
+                result.body = lookup->cached.body;
+            } else {
+                result.body = std::move(*body);
+            }
+            if (done) done(result);
+        }, cancel);
+    }
+
+    void CurlTransport::StartGetStream(const std::string& url, DataCallback onData, ResultCallback done,
+                                       CancelTokenPtr cancel) {
+        auto lookup = LookupCache(url);
+        if (lookup->found && lookup->cached.IsFresh()) {
+            ResponseCache::Instance().RecordFreshHit();
+            DeliverCached([lookup, onData, done, cancel]() {
+                HttpResult result;
+                if (!ApplyCancellation(cancel, result)) {
+                    result.statusCode = 200;
+                    const std::string& body = lookup->cached.body;
+                    result.success = !onData || onData(body.data(), body.size());
+                    if (!result.success) result.error = curl_easy_strerror(CURLE_WRITE_ERROR);
+                }
+                if (done) done(result);
+            });
+            return;
+        }
+        if (HoldForRateLimit(url, done)) return;
+
+        CURL* curl = ConnectionPool::Instance().Acquire();
+        if (!curl) {
+            HttpResult result;
+            result.localError = true;
+            result.error = "Failed to init curl";
+            if (done) done(result);
+            return;
+        }
 
-        bool success = (res == CURLE_OK) && (response_code >= 200 && response_code < 300);
+        auto transfer = std::make_shared<StreamTransfer>();
+        transfer->handle = curl;
+        transfer->onData = std::move(onData);
+        transfer->progress.cancel = cancel;
 
-        if (!success && outError) {
-             if (res != CURLE_OK) *outError = curl_easy_strerror(res);
-             else *outError = "HTTP " + std::to_string(response_code);
+        ApplyCommonOptions(curl, url, 30L);
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteStreamCallback);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, transfer.get());
+        curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+        if (cancel) {
+            curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, ProgressCallbackWrapper);
+            curl_easy_setopt(curl, CURLOPT_XFERINFODATA, &transfer->progress);
+            curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
         }
+        AddValidators(curl, *lookup);
 
-        curl_easy_cleanup(curl);
-        return success;
+        NetworkEngine::Instance().Submit(curl, [url, transfer, lookup, done](CURL* handle, CURLcode res) {
+            HttpResult result;
+            FinishResult(handle, res, result, url);
+            if (ApplyCancellation(transfer->progress.cancel, result)) {
+                // The receiver has what arrived so far; nothing is cached
+            } else if (!transfer->bodyTooLarge && UpdateCache(handle, *lookup, result, transfer->body)) {
+                // Not modified: the receiver gets the body we already have
+                const std::string& body = lookup->cached.body;
+                if (transfer->onData && !transfer->onData(body.data(), body.size())) {
+                    result.success = false;
+                    result.error = curl_easy_strerror(CURLE_WRITE_ERROR);
+                }
+            }
+            if (done) done(result);
+        }, cancel);
     }
 
-    bool HttpRequest::GetRedirectUrl(const std::string& url, std::string& outUrl, std::string* outError) {
-        CURL* curl = curl_easy_init();
-        if (!curl) return false;
+    void CurlTransport::StartGetRedirectUrl(const std::string& url, ResultCallback done) {
+        if (HoldForRateLimit(url, done)) return;
+        CURL* curl = ConnectionPool::Instance().Acquire();
+        if (!curl) {
+            HttpResult result;
+            result.localError = true;
+            result.error = "Failed to init curl";
+            if (done) done(result);
+            return;
+        }
 
-        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+        ApplyCommonOptions(curl, url, 10L);
         curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 0L); // Do not follow redirect
         curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);         // HEAD request
-        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
-        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
-        curl_easy_setopt(curl, CURLOPT_USERAGENT, "osu! Beatmap Downloader/1.0");
-        curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10L);
-
-        CURLcode res = curl_easy_perform(curl);
-        
-        if (res != CURLE_OK) {
-            if (outError) *outError = curl_easy_strerror(res);
-            curl_easy_cleanup(curl);
-            return false;
-        }
 
-        long response_code;
-        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
+        NetworkEngine::Instance().Submit(curl, [url, done](CURL* handle, CURLcode res) {
+            HttpResult result;
+            FinishResult(handle, res, result, url);
+            result.success = false;
 
-        if (response_code >= 300 && response_code < 400) {
-            char* location = NULL;
-            curl_easy_getinfo(curl, CURLINFO_REDIRECT_URL, &location);
-            if (location) {
-                outUrl = location;
-                curl_easy_cleanup(curl);
-                return true;
+            if (res == CURLE_OK && result.statusCode >= 300 && result.statusCode < 400) {
+                char* location = NULL;
+                curl_easy_getinfo(handle, CURLINFO_REDIRECT_URL, &location);
+                if (location) {
+                    result.redirectUrl = location;
+                    result.success = true;
+                    result.error.clear();
+                }
             }
-        }
 
-        if (outError) *outError = "No redirect found (HTTP " + std::to_string(response_code) + ")";
-        curl_easy_cleanup(curl);
-        return false;
+            if (!result.success && res == CURLE_OK) {
+                result.error = "No redirect found (HTTP " + std::to_string(result.statusCode) + ")";
+            }
+            if (done) done(result);
+        });
+    }
+
+    static Transport& CurrentTransport(std::shared_ptr<Transport>& keepAlive) {
+        std::lock_guard<std::mutex> lock(g_TransportMutex);
+        keepAlive = g_Transport;
+        if (keepAlive) return *keepAlive;
+        return CurlTransport::Instance();
+    }
+
+    void HttpRequest::SetTransport(std::shared_ptr<Transport> transport) {
+        std::lock_guard<std::mutex> lock(g_TransportMutex);
+        g_Transport = std::move(transport);
+        LogInfo(g_Transport ? "HTTP requests now use a substitute transport" : "HTTP requests now use libcurl");
+    }
+
+    void HttpRequest::StartDownload(const std::string& url, const std::wstring& destPath,
+                                    ProgressCallback progressCb, ResultCallback done, long timeoutSeconds, int segments,
+                                    CancelTokenPtr cancel, ExpectedPayload expect) {
+        std::shared_ptr<Transport> keepAlive;
+        CurrentTransport(keepAlive).StartDownload(url, destPath, progressCb, done, timeoutSeconds, segments, cancel, expect);
+    }
+
+    void HttpRequest::StartGet(const std::string& url, ResultCallback done, CancelTokenPtr cancel) {
+        std::shared_ptr<Transport> keepAlive;
+        CurrentTransport(keepAlive).StartGet(url, done, cancel);
+    }
+
+    void HttpRequest::StartGetStream(const std::string& url, DataCallback onData, ResultCallback done,
+                                     CancelTokenPtr cancel) {
+        std::shared_ptr<Transport> keepAlive;
+        CurrentTransport(keepAlive).StartGetStream(url, onData, done, cancel);
+    }
+
+    void HttpRequest::StartGetRedirectUrl(const std::string& url, ResultCallback done) {
+        std::shared_ptr<Transport> keepAlive;
+        CurrentTransport(keepAlive).StartGetRedirectUrl(url, done);
+    }
+
+    bool HttpRequest::Download(const std::string& url, const std::wstring& destPath,
+                               ProgressCallback progressCb, std::string* outError, long timeoutSeconds, int segments) {
+        HttpResult result = Wait([&](ResultCallback done) {
+            StartDownload(url, destPath, progressCb, done, timeoutSeconds, segments);
+        });
+        if (!result.success && outError) *outError = result.error;
+        return result.success;
+    }
+
+    bool HttpRequest::Get(const std::string& url, std::string& outResponse, std::string* outError) {
+        HttpResult result = Wait([&](ResultCallback done) {
+            StartGet(url, done);
+        });
+        outResponse += result.body;
+        if (!result.success && outError) *outError = result.error;
+        return result.success;
+    }
+
+    bool HttpRequest::GetStream(const std::string& url, DataCallback onData, std::string* outError,
+                                CancelTokenPtr cancel) {
+        HttpResult result = Wait([&](ResultCallback done) {
+            StartGetStream(url, onData, done, cancel);
+        });
+        if (!result.success && outError) *outError = result.error;
+        return result.success;
+    }
+
+    bool HttpRequest::GetRedirectUrl(const std::string& url, std::string& outUrl, std::string* outError) {
+        HttpResult result = Wait([&](ResultCallback done) {
+            StartGetRedirectUrl(url, done);
+        });
+        if (result.success) outUrl = result.redirectUrl;
+        else if (outError) *outError = result.error;
+        return result.success;
     }
 
     void HttpRequest::DownloadAsync(const std::string& url, const std::wstring& destPath,
                                     ProgressCallback progressCb, CompletionCallback completionCb, long timeoutSeconds) {
-        std::thread([=]() {
-            std::string error;
-            bool success = Download(url, destPath, progressCb, &error, timeoutSeconds);
-            if (completionCb) completionCb(success, error);
-        }).detach();
+        StartDownload(url, destPath, progressCb, [completionCb](const HttpResult& result) {
+            if (completionCb) completionCb(result.success, result.error);
+        }, timeoutSeconds);
     }
 
     void HttpRequest::GetAsync(const std::string& url, CompletionCallback completionCb) {
-        std::thread([=]() {
-            std::string response;
-            std::string error;
-            bool success = Get(url, response, &error);
-            if (completionCb) completionCb(success, success ? response : error);
-        }).detach();
+        StartGet(url, [completionCb](const HttpResult& result) {
+            if (completionCb) completionCb(result.success, result.success ? result.body : result.error);
+        });
     }
 
     std::string HttpRequest::UrlEncode(const std::string& value) {
@@ -1,43 +1,108 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <functional>
 #include <filesystem>
-#include <future>
+#include "ConnectionPool.h"
+#include "ConnectionWarmer.h"
+#include "RateLimiter.h"
+#include "SessionCache.h"
+#include "ResponseCache.h"
+#include "Transport.h"
 
 namespace network {
 
     class HttpRequest {
     public:
         // Callback types
-        using ProgressCallback = std::function<void(double dlNow, double dlTotal)>;
+        using ProgressCallback = Transport::ProgressCallback;
         using CompletionCallback = std::function<void(bool success, const std::string& errorOrData)>;
+        using ResultCallback = Transport::ResultCallback;
+        // Receives the response body as it arrives; returning false aborts the transfer
+        using DataCallback = Transport::DataCallback;
 
         static void GlobalInit();
         static void GlobalCleanup();
 
-        // Synchronous methods
-        static bool Download(const std::string& url, const std::wstring& destPath, 
-                             ProgressCallback progressCb = nullptr, 
+        // Routes every request through transport instead of libcurl; nullptr switches back.
+        // Requests already running finish on the transport they started on.
+        static void SetTransport(std::shared_ptr<Transport> transport);
+
+        // Write downloads through a mapped view of the preallocated file instead of WriteFile
+        static void SetMemoryMappedOutput(bool enabled);
+
+        // Token-bucket caps in KB/s, 0 = unlimited. The global cap covers all traffic,
+        // the background cap only downloads. Running transfers adopt new values live.
+        static void SetBandwidthLimits(int globalKBps, int backgroundKBps);
+        // Bytes per second downloads are currently capped at, 0 = unlimited
+        static int64_t GetDownloadRateLimit();
+
+        // Connection reuse counters from the shared pool
+        static ConnectionStats GetConnectionStats();
+
+        // Opens keep-alive connections to the hosts of these URLs in the background
+        static void Prewarm(const std::vector<std::string>& urls);
+        static WarmupStats GetWarmupStats();
+
+        // Caches GET responses in memory and under directory, revalidating them with
+        // If-None-Match / If-Modified-Since so an unchanged response costs only headers
+        static void EnableResponseCache(const std::wstring& directory);
+        static CacheStats GetCacheStats();
+
+        // Restores TLS sessions and host addresses saved at path, and saves them there
+        // again in GlobalCleanup, so the first request after a restart starts warm
+        static void EnableSessionCache(const std::wstring& path);
+        static SessionCacheStats GetSessionCacheStats();
+
+        // Per-host budgets learned from Retry-After and X-RateLimit-* headers
+        static std::vector<HostBudget> GetRateLimits();
+
+        // Synchronous methods (block the calling thread until the network engine finishes).
+        // A timeout of 0 means no overall limit; downloads still give up on a connection that stays silent for a minute.
+        // segments > 1 fetches the file over several Range connections when the mirror allows it.
+        // Downloads are written to "<destPath>.part" and renamed into place once complete;
+        // an interrupted download is kept and resumed by the next call for the same URL.
+        static bool Download(const std::string& url, const std::wstring& destPath,
+                             ProgressCallback progressCb = nullptr,
                              std::string* outError = nullptr,
-                             long timeoutSeconds = 300);
+                             long timeoutSeconds = 300,
+                             int segments = 1);
 
-        static bool Get(const std::string& url, std::string& outResponse, 
+        static bool Get(const std::string& url, std::string& outResponse,
                         std::string* outError = nullptr);
 
-        static bool GetRedirectUrl(const std::string& url, std::string& outUrl, 
+        static bool GetRedirectUrl(const std::string& url, std::string& outUrl,
                                    std::string* outError = nullptr);
 
-        // Asynchronous methods
+        // Like Get, but hands body chunks to onData instead of buffering them (2xx responses only)
+        static bool GetStream(const std::string& url, DataCallback onData,
+                              std::string* outError = nullptr, CancelTokenPtr cancel = nullptr);
+
+        // Asynchronous methods. Callbacks run on the network thread and must not block.
         static void DownloadAsync(const std::string& url, const std::wstring& destPath,
                                   ProgressCallback progressCb,
                                   CompletionCallback completionCb,
                                   long timeoutSeconds = 300);
 
-        static void GetAsync(const std::string& url, 
+        static void GetAsync(const std::string& url,
                              CompletionCallback completionCb);
 
+        // Cancelling the token closes the transfer's connection within milliseconds and
+        // completes it with HttpResult::cancelled; a download's partial file is kept for a later resume.
+        // With ExpectedPayload::ZipArchive an error page is caught in its first bytes and a truncated
+        // archive before it is moved into place; both fail with HttpResult::invalidPayload.
+        static void StartDownload(const std::string& url, const std::wstring& destPath,
+                                  ProgressCallback progressCb, ResultCallback done,
+                                  long timeoutSeconds = 300, int segments = 1,
+                                  CancelTokenPtr cancel = nullptr,
+                                  ExpectedPayload expect = ExpectedPayload::Any);
+        static void StartGet(const std::string& url, ResultCallback done, CancelTokenPtr cancel = nullptr);
+        static void StartGetStream(const std::string& url, DataCallback onData, ResultCallback done,
+                                   CancelTokenPtr cancel = nullptr);
+        static void StartGetRedirectUrl(const std::string& url, ResultCallback done);
+
         // Utility
         static std::string UrlEncode(const std::string& value);
     };
@@ -0,0 +1,226 @@
+#include "NetworkEngine.h"
+#include "ConnectionPool.h"
+#include "BandwidthShaper.h"
+#include "utils/logging.h"
+
+namespace network {
+
+    // Upper bound for a single curl_multi_poll wait; submissions wake it early
+    static const int kPollTimeoutMs = 100;
+
+    static thread_local bool t_inlineTransfers = false;
+
+    NetworkEngine::InlineScope::InlineScope() : m_previous(t_inlineTransfers) {
+        t_inlineTransfers = true;
+    }
+
+    NetworkEngine::InlineScope::~InlineScope() {
+        t_inlineTransfers = m_previous;
+    }
+
+    NetworkEngine& NetworkEngine::Instance() {
+        static NetworkEngine instance;
+        return instance;
+    }
+
+    void NetworkEngine::Start() {
+        if (m_running) return;
+
+        m_multi = curl_multi_init();
+        if (!m_multi) {
+            LogError("Failed to create curl multi handle, transfers will run inline");
+            return;
+        }
+
+        m_stopping = false;
+        m_running = true;
+        m_thread = std::thread(&NetworkEngine::ReactorThread, this);
+        LogInfo("Network engine started");
+    }
+
+    void NetworkEngine::Stop() {
+        if (!m_running) return;
+        {
+            std::lock_guard<std::mutex> lock(m_pendingMutex);
+            m_stopping = true;
+            m_running = false;
+        }
+        curl_multi_wakeup(m_multi);
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+
+        curl_multi_cleanup(m_multi);
+        m_multi = nullptr;
+        LogInfo("Network engine stopped");
+    }
+
+    bool NetworkEngine::IsReactorThread() const {
+        return std::this_thread::get_id() == m_thread.get_id();
+    }
+
+    bool NetworkEngine::CanDefer() const {
+        return m_running && IsReactorThread() && !t_inlineTransfers;
+    }
+
+    void NetworkEngine::Post(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(m_pendingMutex);
+            if (m_running) {
+                m_tasks.push_back(std::move(task));
+                curl_multi_wakeup(m_multi);
+                return;
+            }
+        }
+        task();
+    }
+
+    void NetworkEngine::Submit(CURL* handle, CompletionFn onComplete, CancelTokenPtr cancel) {
+        if (!t_inlineTransfers) {
+            std::lock_guard<std::mutex> lock(m_pendingMutex);
+            if (m_running) {
+                // Submissions from the reactor thread are picked up on its next iteration
+                m_pending.push_back({handle, std::move(onComplete), std::move(cancel)});
+                m_activeCount++;
+                curl_multi_wakeup(m_multi);
+                return;
+            }
+        }
+
+        // Completions of the transfers Stop() aborts may submit again; running those
+        // inline would block the reactor thread, and with it Stop(), on a full download
+        if (m_stopping) {
+            m_activeCount++;
+            Finish(handle, onComplete, CURLE_ABORTED_BY_CALLBACK);
+            return;
+        }
+
+        // Inline transfers can only be stopped by their progress callback
+        RunInline(handle, std::move(onComplete));
+    }
+
+    void NetworkEngine::RunInline(CURL* handle, CompletionFn onComplete) {
+        if (IsReactorThread()) {
+            LogDebug("Synchronous request issued on the network thread, performing inline");
+        }
+        m_activeCount++;
+        CURLcode result = curl_easy_perform(handle);
+        Finish(handle, onComplete, result);
+    }
+
+    void NetworkEngine::Finish(CURL* handle, CompletionFn& onComplete, CURLcode result) {
+        if (onComplete) {
+            try {
+                onComplete(handle, result);
+            } catch (const std::exception& e) {
+                LogError(std::string("Transfer completion threw: ") + e.what());
+            }
+        }
+        BandwidthShaper::Instance().Forget(handle);
+        ConnectionPool::Instance().Release(handle);
+        m_activeCount--;
+    }
+
+    // Finishes a transfer that has left the multi handle
+    void NetworkEngine::Retire(CURL* handle, ActiveTransfer& transfer, CURLcode result) {
+        if (transfer.cancel && transfer.subscription) transfer.cancel->Unsubscribe(transfer.subscription);
+        Finish(handle, transfer.onComplete, result);
+    }
+
+    void NetworkEngine::AbortCancelled() {
+        std::vector<CURL*> cancelled;
+        for (const auto& entry : m_active) {
+            if (entry.second.cancel && entry.second.cancel->IsCancelled()) cancelled.push_back(entry.first);
+        }
+        for (CURL* handle : cancelled) {
+            auto it = m_active.find(handle);
+            ActiveTransfer transfer = std::move(it->second);
+            m_active.erase(it);
+            curl_multi_remove_handle(m_multi, handle);
+            Retire(handle, transfer, CURLE_ABORTED_BY_CALLBACK);
+        }
+    }
+
+    void NetworkEngine::AddPending() {
+        std::vector<PendingTransfer> pending;
+        std::vector<std::function<void()>> tasks;
+        {
+            std::lock_guard<std::mutex> lock(m_pendingMutex);
+            pending.swap(m_pending);
+            tasks.swap(m_tasks);
+        }
+
+        for (auto& task : tasks) {
+            try {
+                task();
+            } catch (const std::exception& e) {
+                LogError(std::string("Posted network task threw: ") + e.what());
+            }
+        }
+
+        for (auto& transfer : pending) {
+            CURLMcode rc = curl_multi_add_handle(m_multi, transfer.handle);
+            if (rc != CURLM_OK) {
+                LogError(std::string("curl_multi_add_handle failed: ") + curl_multi_strerror(rc));
+                Finish(transfer.handle, transfer.onComplete, CURLE_FAILED_INIT);
+                continue;
+            }
+            ActiveTransfer& active = m_active[transfer.handle];
+            active.onComplete = std::move(transfer.onComplete);
+            active.cancel = std::move(transfer.cancel);
+            if (active.cancel) {
+                // Matched by token, so a wakeup arriving after the transfer finished finds nothing to abort
+                active.subscription = active.cancel->Subscribe([this]() {
+                    Post([this]() { AbortCancelled(); });
+                });
+            }
+        }
+        // Covers tokens cancelled before their transfer got here
+        AbortCancelled();
+    }
+
+    void NetworkEngine::ProcessCompleted() {
+        int queued = 0;
+        while (CURLMsg* msg = curl_multi_info_read(m_multi, &queued)) {
+            if (msg->msg != CURLMSG_DONE) continue;
+
+            CURL* handle = msg->easy_handle;
+            CURLcode result = msg->data.result;
+            curl_multi_remove_handle(m_multi, handle);
+
+            auto it = m_active.find(handle);
+            if (it == m_active.end()) continue;
+            ActiveTransfer transfer = std::move(it->second);
+            m_active.erase(it);
+
+            Retire(handle, transfer, result);
+        }
+    }
+
+    void NetworkEngine::ReactorThread() {
+        while (m_running) {
+            AddPending();
+
+            int stillRunning = 0;
+            curl_multi_perform(m_multi, &stillRunning);
+            ProcessCompleted();
+
+            // Resume transfers the bandwidth shaper has tokens for, and wake up
+            // again in time for the next one waiting
+            int timeoutMs = kPollTimeoutMs;
+            int shaperWaitMs = BandwidthShaper::Instance().Tick();
+            if (shaperWaitMs >= 0 && shaperWaitMs < timeoutMs) timeoutMs = shaperWaitMs;
+
+            curl_multi_poll(m_multi, nullptr, 0, timeoutMs, nullptr);
+        }
+
+        // Abort everything still in flight so callers waiting on futures are released
+        AddPending();
+        for (auto& entry : m_active) {
+            curl_multi_remove_handle(m_multi, entry.first);
+            Retire(entry.first, entry.second, CURLE_ABORTED_BY_CALLBACK);
+        }
+        m_active.clear();
+    }
+
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <curl/curl.h>
+#include "CancellationToken.h"
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace network {
+
+    // One reactor thread driving every transfer through a single curl multi handle.
+    // A transfer costs an easy handle and its buffers instead of a thread stack.
+    class NetworkEngine {
+    public:
+        // Runs on the reactor thread once the transfer finished; the handle goes
+        // back to the ConnectionPool right after the callback returns.
+        using CompletionFn = std::function<void(CURL* handle, CURLcode result)>;
+
+        static NetworkEngine& Instance();
+
+        void Start();
+        void Stop();
+
+        // Takes ownership of a configured handle from ConnectionPool::Acquire().
+        // Runs inline before Start() or inside an InlineScope. Cancelling the token
+        // removes the transfer within one reactor iteration and completes it with
+        // CURLE_ABORTED_BY_CALLBACK, freeing its connection and bandwidth share.
+        // Once Stop() has begun, the transfer completes at once with that code instead.
+        void Submit(CURL* handle, CompletionFn onComplete, CancelTokenPtr cancel = nullptr);
+
+        // Runs task on the reactor thread's next iteration, or right away when the engine is not running.
+        void Post(std::function<void()> task);
+
+        bool IsRunning() const { return m_running.load(); }
+        // True from the start of Stop(); transfers aborted from then on should not be retried
+        bool IsStopping() const { return m_stopping.load(); }
+        bool IsReactorThread() const;
+        // True on the reactor thread outside an InlineScope, where work may be finished later through Post
+        bool CanDefer() const;
+
+        // Synchronous requests made on the reactor thread would wait on themselves;
+        // while one of these is alive, Submit performs the transfer on the calling thread.
+        class InlineScope {
+        public:
+            InlineScope();
+            ~InlineScope();
+        private:
+            bool m_previous;
+        };
+
+        size_t GetActiveTransfers() const { return m_activeCount.load(); }
+
+    private:
+        NetworkEngine() = default;
+        ~NetworkEngine() = default;
+        NetworkEngine(const NetworkEngine&) = delete;
+        NetworkEngine& operator=(const NetworkEngine&) = delete;
+
+        struct PendingTransfer {
+            CURL* handle;
+            CompletionFn onComplete;
+            CancelTokenPtr cancel;
+        };
+
+        struct ActiveTransfer {
+            CompletionFn onComplete;
+            CancelTokenPtr cancel;
+            size_t subscription = 0;
+        };
+
+        void ReactorThread();
+        void AddPending();
+        void ProcessCompleted();
+        void Finish(CURL* handle, CompletionFn& onComplete, CURLcode result);
+        void Retire(CURL* handle, ActiveTransfer& transfer, CURLcode result);
+        void AbortCancelled();
+        void RunInline(CURL* handle, CompletionFn onComplete);
+
+        CURLM* m_multi = nullptr;
+        std::thread m_thread;
+        std::atomic<bool> m_running{false};
+        std::atomic<bool> m_stopping{false};
+        std::atomic<size_t> m_activeCount{0};
+
+        std::mutex m_pendingMutex;
+        std::vector<PendingTransfer> m_pending;
+        std::vector<std::function<void()>> m_tasks;
+
+        // Only touched on the reactor thread
+        std::unordered_map<CURL*, ActiveTransfer> m_active;
+    };
+
+}
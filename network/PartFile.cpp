@@ -0,0 +1,113 @@
+#include "PartFile.h"
+#include "utils/logging.h"
+#include <nlohmann/json.hpp>
+#include <fstream>
+#include <windows.h>
+
+namespace network {
+
+    int64_t PartFileState::ContiguousBytes() const {
+        if (pendingRanges.empty()) return bytesWritten;
+        // A segmented sidecar is only usable by a single stream if one tail range is left
+        if (pendingRanges.size() == 1 && totalSize > 0 && pendingRanges[0].second == totalSize - 1) {
+            return pendingRanges[0].first;
+        }
+        return 0;
+    }
+
+    std::string PartFileState::IfRangeValue() const {
+        // If-Range requires a strong validator; weak ETags (W/"...") are not allowed
+        if (!etag.empty() && etag.compare(0, 2, "W/") != 0) return etag;
+        return lastModified;
+    }
+
+    bool PartFileState::SameResource(const std::string& otherEtag, const std::string& otherLastModified, int64_t otherSize) const {
+        if (totalSize > 0 && otherSize > 0 && totalSize != otherSize) return false;
+        if (!etag.empty() || !otherEtag.empty()) return etag == otherEtag;
+        if (!lastModified.empty() || !otherLastModified.empty()) return lastModified == otherLastModified;
+        return false;
+    }
+
+    std::wstring PartFile::PartPath(const std::wstring& destPath) {
+        return destPath + L".part";
+    }
+
+    std::wstring PartFile::MetaPath(const std::wstring& destPath) {
+        return destPath + L".part.meta";
+    }
+
+    bool PartFile::Load(const std::wstring& destPath, PartFileState& outState) {
+        if (GetFileAttributesW(PartPath(destPath).c_str()) == INVALID_FILE_ATTRIBUTES) return false;
+
+        std::ifstream in(MetaPath(destPath));
+        if (!in.is_open()) return false;
+
+        try {
+            nlohmann::json json = nlohmann::json::parse(in);
+            outState.url = json.value("url", "");
+            outState.etag = json.value("etag", "");
+            outState.lastModified = json.value("lastModified", "");
+            outState.totalSize = json.value("totalSize", (int64_t)-1);
+            outState.bytesWritten = json.value("bytesWritten", (int64_t)0);
+            outState.pendingRanges.clear();
+            if (json.contains("pendingRanges")) {
+                for (const auto& range : json["pendingRanges"]) {
+                    outState.pendingRanges.emplace_back(range.at(0).get<int64_t>(), range.at(1).get<int64_t>());
+                }
+            }
+        } catch (const std::exception& e) {
+            LogWarning(std::string("Ignoring unreadable download sidecar: ") + e.what());
+            return false;
+        }
+
+        // The sidecar may be ahead of what actually reached the disk
+        WIN32_FILE_ATTRIBUTE_DATA attrs;
+        if (GetFileAttributesExW(PartPath(destPath).c_str(), GetFileExInfoStandard, &attrs)) {
+            int64_t onDisk = ((int64_t)attrs.nFileSizeHigh << 32) | attrs.nFileSizeLow;
+            if (outState.pendingRanges.empty() && outState.bytesWritten > onDisk) {
+                outState.bytesWritten = onDisk;
+            }
+        }
+        return true;
+    }
+
+    bool PartFile::Save(const std::wstring& destPath, const PartFileState& state) {
+        nlohmann::json json;
+        json["url"] = state.url;
+        json["etag"] = state.etag;
+        json["lastModified"] = state.lastModified;
+        json["totalSize"] = state.totalSize;
+        json["bytesWritten"] = state.bytesWritten;
+        nlohmann::json ranges = nlohmann::json::array();
+        for (const auto& range : state.pendingRanges) {
+            ranges.push_back({ range.first, range.second });
+        }
+        json["pendingRanges"] = ranges;
+
+        // Write to a temp file and swap it in so a crash never leaves a torn sidecar
+        std::wstring metaPath = MetaPath(destPath);
+        std::wstring tempPath = metaPath + L".tmp";
+        {
+            std::ofstream out(tempPath, std::ios::trunc);
+            if (!out.is_open()) return false;
+            out << json.dump();
+            if (!out.good()) return false;
+        }
+        return MoveFileExW(tempPath.c_str(), metaPath.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+    }
+
+    bool PartFile::Commit(const std::wstring& destPath) {
+        if (!MoveFileExW(PartPath(destPath).c_str(), destPath.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+            LogError("Failed to move finished download into place (error " + std::to_string(GetLastError()) + ")");
+            return false;
+        }
+        DeleteFileW(MetaPath(destPath).c_str());
+        return true;
+    }
+
+    void PartFile::Discard(const std::wstring& destPath) {
+        DeleteFileW(PartPath(destPath).c_str());
+        DeleteFileW(MetaPath(destPath).c_str());
+    }
+
+}
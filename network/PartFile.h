@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace network {
+
+    // Sidecar describing an unfinished download. Downloads write to "<dest>.part"
+    // and keep this next to it as "<dest>.part.meta" so a retry, or the next
+    // session, can continue with a Range request instead of starting over.
+    struct PartFileState {
+        std::string url;
+        std::string etag;
+        std::string lastModified;
+        int64_t totalSize = -1;
+        // Contiguous bytes from the start of the file (single-stream downloads)
+        int64_t bytesWritten = 0;
+        // Byte ranges still missing, inclusive (segmented downloads)
+        std::vector<std::pair<int64_t, int64_t>> pendingRanges;
+
+        bool HasValidator() const { return !etag.empty() || !lastModified.empty(); }
+        // Bytes that can be resumed with a single open-ended Range request
+        int64_t ContiguousBytes() const;
+        // Value for If-Range: a strong ETag when available, Last-Modified otherwise
+        std::string IfRangeValue() const;
+        bool SameResource(const std::string& otherEtag, const std::string& otherLastModified, int64_t otherSize) const;
+    };
+
+    class PartFile {
+    public:
+        static std::wstring PartPath(const std::wstring& destPath);
+        static std::wstring MetaPath(const std::wstring& destPath);
+
+        static bool Load(const std::wstring& destPath, PartFileState& outState);
+        static bool Save(const std::wstring& destPath, const PartFileState& state);
+
+        // Atomically moves the finished .part into place and removes the sidecar
+        static bool Commit(const std::wstring& destPath);
+        // Removes the .part file and its sidecar
+        static void Discard(const std::wstring& destPath);
+    };
+
+}
@@ -0,0 +1,127 @@
+#include "PayloadCheck.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace network {
+
+    static const unsigned char kLocalHeaderSig[4] = { 'P', 'K', 0x03, 0x04 };
+    static const unsigned char kCentralHeaderSig[4] = { 'P', 'K', 0x01, 0x02 };
+    static const unsigned char kEndRecordSig[4] = { 'P', 'K', 0x05, 0x06 };
+    // End of central directory record without its comment, which may add up to 64 KB
+    static const int64_t kEndRecordSize = 22;
+    static const int64_t kMaxCommentSize = 0xFFFF;
+
+    static uint32_t Read16(const unsigned char* p) {
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8);
+    }
+
+    static uint32_t Read32(const unsigned char* p) {
+        return Read16(p) | (Read16(p + 2) << 16);
+    }
+
+    static bool Fail(std::string* outError, const std::string& message) {
+        if (outError) *outError = message;
+        return false;
+    }
+
+    std::string CheckArchiveHeaders(const std::string& contentType, int64_t contentLength) {
+        std::string type = contentType.substr(0, contentType.find(';'));
+        std::transform(type.begin(), type.end(), type.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+        type.erase(0, type.find_first_not_of(' '));
+        type.erase(type.find_last_not_of(' ') + 1);
+
+        // Mirrors label archives inconsistently (application/zip, octet-stream, x-osu-...),
+        // but an error page always comes as text, HTML, JSON or XML
+        if (type.compare(0, 5, "text/") == 0 || type.find("html") != std::string::npos ||
+            type.find("json") != std::string::npos || type.find("xml") != std::string::npos) {
+            return "Mirror sent " + type + " instead of an archive";
+        }
+        if (contentLength >= 0 && contentLength < kEndRecordSize) {
+            return "Response too small for an archive (" + std::to_string((long long)contentLength) + " bytes)";
+        }
+        return "";
+    }
+
+    ZipSignatureSniffer::Verdict ZipSignatureSniffer::Feed(const void* data, size_t size) {
+        if (m_verdict != Verdict::Pending) return m_verdict;
+
+        size_t take = (std::min)(size, sizeof(m_head) - m_size);
+        memcpy(m_head + m_size, data, take);
+        m_size += take;
+
+        // Every byte received so far has to match; an HTML page is rejected on its first byte
+        if (memcmp(m_head, kLocalHeaderSig, m_size) != 0) {
+            m_verdict = Verdict::Invalid;
+        } else if (m_size == sizeof(m_head)) {
+            m_verdict = Verdict::Valid;
+        }
+        return m_verdict;
+    }
+
+    std::string ZipSignatureSniffer::Describe() const {
+        if (m_size == 0) return "an empty body";
+        switch (m_head[0]) {
+            case '<': return "an HTML page";
+            case '{':
+            case '[': return "a JSON response";
+            default: return "data that is not a zip archive";
+        }
+    }
+
+    bool ValidateZipArchive(const std::wstring& path, std::string* outError) {
+        std::ifstream file(std::filesystem::path(path), std::ios::binary);
+        if (!file) return Fail(outError, "Failed to open archive");
+
+        file.seekg(0, std::ios::end);
+        int64_t size = (int64_t)file.tellg();
+        if (size < kEndRecordSize) {
+            return Fail(outError, "Archive is truncated (" + std::to_string((long long)size) + " bytes)");
+        }
+
+        // The record sits at the very end, followed only by its comment
+        int64_t tailSize = (std::min)(size, kEndRecordSize + kMaxCommentSize);
+        std::vector<unsigned char> tail((size_t)tailSize);
+        file.seekg(size - tailSize);
+        if (!file.read((char*)tail.data(), tailSize)) return Fail(outError, "Failed to read archive");
+
+        int64_t found = -1;
+        for (int64_t i = tailSize - kEndRecordSize; i >= 0; --i) {
+            if (memcmp(&tail[(size_t)i], kEndRecordSig, sizeof(kEndRecordSig)) == 0) {
+                found = i;
+                break;
+            }
+        }
+        if (found < 0) return Fail(outError, "Archive is truncated (no end of central directory)");
+
+        const unsigned char* record = &tail[(size_t)found];
+        int64_t recordOffset = size - tailSize + found;
+        uint32_t entries = Read16(record + 10);
+        uint32_t directorySize = Read32(record + 12);
+        uint32_t directoryOffset = Read32(record + 16);
+        uint32_t commentSize = Read16(record + 20);
+
+        if (recordOffset + kEndRecordSize + commentSize > size) {
+            return Fail(outError, "Archive is truncated (end of central directory cut off)");
+        }
+        if (entries == 0) return Fail(outError, "Archive is empty");
+
+        // Zip64 keeps the real values elsewhere; no beatmap gets that large, so trust it
+        if (directoryOffset == 0xFFFFFFFF || directorySize == 0xFFFFFFFF) return true;
+
+        if ((int64_t)directoryOffset + directorySize > recordOffset) {
+            return Fail(outError, "Archive is damaged (central directory out of range)");
+        }
+        unsigned char signature[4] = {};
+        file.seekg(directoryOffset);
+        if (!file.read((char*)signature, sizeof(signature)) ||
+            memcmp(signature, kCentralHeaderSig, sizeof(signature)) != 0) {
+            return Fail(outError, "Archive is damaged (central directory not found)");
+        }
+        return true;
+    }
+
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace network {
+
+    // Some mirrors answer 200 OK with an HTML "not found" or rate-limit page, or cut
+    // an archive short. These checks catch that in the first bytes of the response
+    // and again on the finished file, so the download fails over instead of osu!
+    // failing the import later.
+
+    // Why a response with these headers cannot be a zip archive, or empty if it may be one
+    std::string CheckArchiveHeaders(const std::string& contentType, int64_t contentLength);
+
+    // Looks at the first bytes of a body for the zip local file header signature
+    class ZipSignatureSniffer {
+    public:
+        enum class Verdict { Pending, Valid, Invalid };
+
+        // Feed body bytes in order; once decided the verdict no longer changes
+        Verdict Feed(const void* data, size_t size);
+        Verdict GetVerdict() const { return m_verdict; }
+        // Body offset the next Feed has to start at
+        size_t BytesSeen() const { return m_size; }
+        // What the body looks like instead, for the error message
+        std::string Describe() const;
+
+    private:
+        unsigned char m_head[4] = {};
+        size_t m_size = 0;
+        Verdict m_verdict = Verdict::Pending;
+    };
+
+    // Checks the end of central directory record of a finished archive: present,
+    // pointing inside the file at a central directory with at least one entry
+    bool ValidateZipArchive(const std::wstring& path, std::string* outError = nullptr);
+
+}
@@ -0,0 +1,180 @@
+#include "RateLimiter.h"
+#include "ConnectionWarmer.h"
+#include "utils/logging.h"
+#include <algorithm>
+#include <cctype>
+#include <ctime>
+#include <initializer_list>
+
+namespace network {
+
+    // Waits announced by a server are capped here so a bogus header can't park a mirror for good
+    static const double kMaxWaitSeconds = 600;
+    // A 429 that says nothing about when to come back keeps the host blocked this long
+    static const double kDefaultBlockSeconds = 10;
+
+    static std::chrono::milliseconds ToMillis(double seconds) {
+        return std::chrono::milliseconds((long long)((std::min)(seconds, kMaxWaitSeconds) * 1000.0));
+    }
+
+    RateLimiter& RateLimiter::Instance() {
+        static RateLimiter instance;
+        return instance;
+    }
+
+    std::string RateLimiter::HostOf(const std::string& url) {
+        std::string origin = ConnectionWarmer::OriginOf(url);
+        size_t scheme = origin.find("://");
+        return scheme == std::string::npos ? origin : origin.substr(scheme + 3);
+    }
+
+    double RateLimiter::ParseRetryAfter(const std::string& value) {
+        if (value.empty()) return -1;
+        if (std::all_of(value.begin(), value.end(), [](unsigned char c) { return std::isdigit(c) || std::isspace(c); })) {
+            try {
+                return std::stod(value);
+            } catch (...) {
+                return -1;
+            }
+        }
+        time_t when = curl_getdate(value.c_str(), nullptr);
+        if (when < 0) return -1;
+        return (std::max)(0.0, (double)(when - std::time(nullptr)));
+    }
+
+    double RateLimiter::ParseReset(const std::string& value) {
+        double reset = 0;
+        try {
+            reset = std::stod(value);
+        } catch (...) {
+            return -1;
+        }
+        if (reset > 1e12) reset /= 1000.0; // Unix time in milliseconds
+        if (reset > 1e9) reset -= (double)std::time(nullptr); // Unix time in seconds
+        return (std::max)(0.0, reset);
+    }
+
+    // First of the given headers the response carries, empty if none
+    static std::string FindHeader(CURL* handle, std::initializer_list<const char*> names) {
+        for (const char* name : names) {
+            struct curl_header* header = nullptr;
+            if (curl_easy_header(handle, name, 0, CURLH_HEADER, -1, &header) == CURLHE_OK && header) {
+                return header->value;
+            }
+        }
+        return "";
+    }
+
+    static int64_t ParseCount(const std::string& value) {
+        try {
+            return value.empty() ? -1 : (int64_t)std::stoll(value);
+        } catch (...) {
+            return -1;
+        }
+    }
+
+    RateLimitInfo RateLimiter::FromResponse(CURL* handle) {
+        RateLimitInfo info;
+        curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &info.statusCode);
+        // X-RateLimit-* is what mirrors send; RateLimit-* is the IETF draft spelling
+        info.retryAfterSeconds = ParseRetryAfter(FindHeader(handle, { "Retry-After" }));
+        info.limit = ParseCount(FindHeader(handle, { "X-RateLimit-Limit", "RateLimit-Limit" }));
+        info.remaining = ParseCount(FindHeader(handle, { "X-RateLimit-Remaining", "RateLimit-Remaining" }));
+        std::string reset = FindHeader(handle, { "X-RateLimit-Reset", "RateLimit-Reset" });
+        if (!reset.empty()) info.resetSeconds = ParseReset(reset);
+        return info;
+    }
+
+    void RateLimiter::Observe(const std::string& url, const RateLimitInfo& info) {
+        bool limited = info.statusCode == 429 || (info.statusCode == 503 && info.retryAfterSeconds >= 0);
+        if (!limited && info.limit < 0 && info.remaining < 0) return;
+
+        std::string hostName = HostOf(url);
+        if (hostName.empty()) return;
+
+        auto now = Clock::now();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Host& host = m_hosts[hostName];
+        if (info.limit >= 0) host.limit = info.limit;
+        // The server's count is behind by the requests still in flight, but never drifts
+        if (info.remaining >= 0) host.remaining = info.remaining;
+        if (info.resetSeconds >= 0) host.resetAt = now + ToMillis(info.resetSeconds);
+
+        if (limited) {
+            if (info.statusCode == 429) host.rateLimited++;
+            double wait = info.retryAfterSeconds >= 0 ? info.retryAfterSeconds
+                        : info.resetSeconds >= 0 ? info.resetSeconds
+                        : kDefaultBlockSeconds;
+            host.blockedUntil = (std::max)(host.blockedUntil, now + ToMillis(wait));
+            LogInfo(hostName + " is rate limiting us (HTTP " + std::to_string(info.statusCode) + "), holding requests for " +
+                    std::to_string((int)(std::min)(wait, kMaxWaitSeconds)) + " s");
+        }
+    }
+
+    void RateLimiter::Expire(Host& host, Clock::time_point now) {
+        if (host.remaining >= 0 && host.resetAt.time_since_epoch().count() != 0 && now >= host.resetAt) {
+            host.remaining = host.limit;
+            host.resetAt = Clock::time_point();
+        }
+    }
+
+    std::chrono::milliseconds RateLimiter::Wait(const Host& host, Clock::time_point now) {
+        std::chrono::milliseconds wait(0);
+        if (now < host.blockedUntil) {
+            wait = std::chrono::duration_cast<std::chrono::milliseconds>(host.blockedUntil - now);
+        }
+        if (host.remaining == 0 && now < host.resetAt) {
+            wait = (std::max)(wait, std::chrono::duration_cast<std::chrono::milliseconds>(host.resetAt - now));
+        }
+        return wait;
+    }
+
+    std::chrono::milliseconds RateLimiter::Delay(const std::string& url) const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_hosts.find(HostOf(url));
+        if (it == m_hosts.end()) return std::chrono::milliseconds(0);
+        return Wait(it->second, Clock::now());
+    }
+
+    std::chrono::milliseconds RateLimiter::Acquire(const std::string& url) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_hosts.find(HostOf(url));
+        if (it == m_hosts.end()) return std::chrono::milliseconds(0);
+
+        Host& host = it->second;
+        auto now = Clock::now();
+        Expire(host, now);
+        std::chrono::milliseconds wait = Wait(host, now);
+        if (wait.count() > 0) {
+            host.heldBack++;
+            return wait;
+        }
+        if (host.remaining > 0) host.remaining--;
+        return wait;
+    }
+
+    std::vector<HostBudget> RateLimiter::GetBudgets() const {
+        std::vector<HostBudget> budgets;
+        auto now = Clock::now();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto& entry : m_hosts) {
+            const Host& host = entry.second;
+            HostBudget budget;
+            budget.host = entry.first;
+            budget.limit = host.limit;
+            budget.remaining = host.remaining;
+            if (now < host.resetAt) {
+                budget.resetSeconds = std::chrono::duration<double>(host.resetAt - now).count();
+            } else if (host.remaining >= 0 && host.resetAt.time_since_epoch().count() != 0) {
+                budget.remaining = host.limit; // Window has passed; Acquire resets it on the next request
+            }
+            budget.blockedSeconds = std::chrono::duration<double>(Wait(host, now)).count();
+            budget.rateLimited = host.rateLimited;
+            budget.heldBack = host.heldBack;
+            budgets.push_back(budget);
+        }
+        std::sort(budgets.begin(), budgets.end(), [](const HostBudget& a, const HostBudget& b) { return a.host < b.host; });
+        return budgets;
+    }
+
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <curl/curl.h>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace network {
+
+    // Rate-limit headers of one response; -1 where the server sent nothing
+    struct RateLimitInfo {
+        long statusCode = 0;
+        double retryAfterSeconds = -1; // Retry-After, as seconds from now
+        int64_t limit = -1;            // X-RateLimit-Limit
+        int64_t remaining = -1;        // X-RateLimit-Remaining
+        double resetSeconds = -1;      // X-RateLimit-Reset, as seconds from now
+    };
+
+    // What the overlay shows for one host
+    struct HostBudget {
+        std::string host;
+        int64_t limit = -1;         // -1 = not advertised
+        int64_t remaining = -1;     // Counted down locally between responses
+        double resetSeconds = 0;    // Until the window starts over, 0 if unknown
+        double blockedSeconds = 0;  // Until requests may go out again
+        uint64_t rateLimited = 0;   // 429 responses received
+        uint64_t heldBack = 0;      // Requests refused here instead of being sent
+    };
+
+    // Per-host request budget learned from Retry-After and X-RateLimit-* headers.
+    // Every request asks Acquire() first; a host that told us to back off, or
+    // whose advertised budget is used up, is not sent anything until its window
+    // resets, so bulk fetches reroute or wait instead of collecting 429s.
+    class RateLimiter {
+    public:
+        static RateLimiter& Instance();
+
+        // Records the headers of a response for url's host
+        void Observe(const std::string& url, const RateLimitInfo& info);
+        // Reads the rate-limit headers of a finished transfer
+        static RateLimitInfo FromResponse(CURL* handle);
+
+        // Time until url's host accepts requests again, zero if it does now
+        std::chrono::milliseconds Delay(const std::string& url) const;
+        // Counts a request against the host's budget if it may go out now;
+        // otherwise returns how long it has to wait and counts nothing
+        std::chrono::milliseconds Acquire(const std::string& url);
+
+        std::vector<HostBudget> GetBudgets() const;
+
+        // Header values in their different spellings: delta seconds or an HTTP date,
+        // and reset times as either seconds from now or a Unix timestamp
+        static double ParseRetryAfter(const std::string& value);
+        static double ParseReset(const std::string& value);
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        RateLimiter() = default;
+        ~RateLimiter() = default;
+        RateLimiter(const RateLimiter&) = delete;
+        RateLimiter& operator=(const RateLimiter&) = delete;
+
+        struct Host {
+            int64_t limit = -1;
+            int64_t remaining = -1;
+            Clock::time_point resetAt;
+            Clock::time_point blockedUntil;
+            uint64_t rateLimited = 0;
+            uint64_t heldBack = 0;
+        };
+
+        static std::string HostOf(const std::string& url);
+        // Forgets a budget whose window has passed
+        static void Expire(Host& host, Clock::time_point now);
+        static std::chrono::milliseconds Wait(const Host& host, Clock::time_point now);
+
+        mutable std::mutex m_mutex;
+        std::unordered_map<std::string, Host> m_hosts;
+    };
+
+}
@@ -0,0 +1,290 @@
+#include "ResponseCache.h"
+#include "utils/logging.h"
+#include <curl/curl.h>
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include <windows.h>
+
+namespace network {
+
+    // Bodies larger than this share of the memory budget are only kept on disk
+    static const size_t kMaxMemoryShare = 4;
+
+    static std::wstring FileNameFor(const std::string& url) {
+        // FNV-1a; the URL stored in the file guards against collisions
+        uint64_t hash = 14695981039346656037ull;
+        for (unsigned char c : url) {
+            hash ^= c;
+            hash *= 1099511628211ull;
+        }
+        wchar_t name[32];
+        swprintf(name, 32, L"%016llx.http", (unsigned long long)hash);
+        return name;
+    }
+
+    static int64_t FileTimeToInt(const FILETIME& time) {
+        return ((int64_t)time.dwHighDateTime << 32) | time.dwLowDateTime;
+    }
+
+    static int64_t Now() {
+        FILETIME time;
+        GetSystemTimeAsFileTime(&time);
+        return FileTimeToInt(time);
+    }
+
+    ResponseCache& ResponseCache::Instance() {
+        static ResponseCache instance;
+        return instance;
+    }
+
+    void ResponseCache::Start(const std::wstring& directory, size_t memoryBudget, size_t diskBudget) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_running) return;
+
+        m_memoryBudget = memoryBudget;
+        m_diskBudget = diskBudget;
+        CreateDirectoryW(directory.c_str(), NULL);
+        if (GetFileAttributesW(directory.c_str()) == INVALID_FILE_ATTRIBUTES) {
+            LogWarning("Response cache directory unavailable, caching in memory only");
+        } else {
+            m_directory = directory;
+
+            WIN32_FIND_DATAW data;
+            HANDLE find = FindFirstFileW((directory + L"\\*.http").c_str(), &data);
+            if (find != INVALID_HANDLE_VALUE) {
+                do {
+                    DiskEntry entry;
+                    entry.size = (size_t)(((int64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow);
+                    entry.lastUsed = FileTimeToInt(data.ftLastWriteTime);
+                    m_disk[data.cFileName] = entry;
+                    m_diskBytes += entry.size;
+                } while (FindNextFileW(find, &data));
+                FindClose(find);
+            }
+            LogInfo("Response cache: " + std::to_string(m_disk.size()) + " entries, " +
+                    std::to_string(m_diskBytes / 1024) + " KB on disk");
+            TrimDisk();
+        }
+
+        m_running = true;
+        m_thread = std::thread(&ResponseCache::WriterThread, this);
+    }
+
+    void ResponseCache::Stop() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_running) return;
+            m_running = false;
+        }
+        m_cv.notify_all();
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+    }
+
+    std::wstring ResponseCache::PathFor(const std::string& url) const {
+        return m_directory + L"\\" + FileNameFor(url);
+    }
+
+    bool ResponseCache::Lookup(const std::string& url, CachedResponse& out) {
+        std::wstring path;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto it = m_index.find(url);
+            if (it != m_index.end()) {
+                m_lru.splice(m_lru.begin(), m_lru, it->second);
+                out = it->second->response;
+                return true;
+            }
+            if (m_directory.empty() || m_disk.find(FileNameFor(url)) == m_disk.end()) return false;
+            path = PathFor(url);
+        }
+
+        if (!ReadFile(path, url, out)) return false;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto disk = m_disk.find(FileNameFor(url));
+        if (disk != m_disk.end()) disk->second.lastUsed = Now();
+        InsertMemory(url, out);
+        return true;
+    }
+
+    void ResponseCache::Store(const std::string& url, CachedResponse response) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_directory.empty()) {
+            std::wstring name = FileNameFor(url);
+            DiskEntry& entry = m_disk[name];
+            m_diskBytes -= entry.size;
+            entry.size = response.body.size() + url.size() + response.etag.size() + response.lastModified.size() + 96;
+            entry.lastUsed = Now();
+            m_diskBytes += entry.size;
+
+            DiskJob job;
+            job.path = m_directory + L"\\" + name;
+            job.url = url;
+            job.response = response;
+            Enqueue(std::move(job));
+            TrimDisk();
+        }
+        InsertMemory(url, std::move(response));
+    }
+
+    void ResponseCache::Refresh(const std::string& url, int64_t expires) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_index.find(url);
+        if (it == m_index.end()) return;
+        it->second->response.expires = expires;
+
+        // Only the freshness changed, but rewriting the small file is simpler than patching it
+        auto disk = m_disk.find(FileNameFor(url));
+        if (disk != m_disk.end() && expires > 0) {
+            disk->second.lastUsed = Now();
+            DiskJob job;
+            job.path = PathFor(url);
+            job.url = url;
+            job.response = it->second->response;
+            Enqueue(std::move(job));
+        }
+    }
+
+    CacheStats ResponseCache::GetStats() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return { m_freshHits.load(), m_revalidated.load(), m_misses.load(), m_memoryBytes, m_diskBytes };
+    }
+
+    bool ResponseCache::ParseFreshness(const std::string& cacheControl, const std::string& expiresHeader, int64_t& outExpires) {
+        std::string directives = cacheControl;
+        std::transform(directives.begin(), directives.end(), directives.begin(),
+                       [](unsigned char c) { return (char)std::tolower(c); });
+
+        outExpires = 0;
+        if (directives.find("no-store") != std::string::npos) return false;
+        if (directives.find("no-cache") != std::string::npos) return true;
+
+        size_t maxAge = directives.find("max-age=");
+        if (maxAge != std::string::npos) {
+            long long seconds = std::atoll(directives.c_str() + maxAge + 8);
+            if (seconds > 0) outExpires = (int64_t)std::time(nullptr) + seconds;
+            return true;
+        }
+        if (!expiresHeader.empty()) {
+            time_t expires = curl_getdate(expiresHeader.c_str(), nullptr);
+            if (expires > 0) outExpires = (int64_t)expires;
+        }
+        return true;
+    }
+
+    // Caller holds m_mutex
+    void ResponseCache::InsertMemory(const std::string& url, CachedResponse response) {
+        auto it = m_index.find(url);
+        if (it != m_index.end()) {
+            m_memoryBytes -= it->second->response.body.size();
+            m_lru.erase(it->second);
+            m_index.erase(it);
+        }
+        if (response.body.size() > m_memoryBudget / kMaxMemoryShare) return;
+
+        m_memoryBytes += response.body.size();
+        m_lru.push_front({ url, std::move(response) });
+        m_index[url] = m_lru.begin();
+
+        while (m_memoryBytes > m_memoryBudget && !m_lru.empty()) {
+            m_memoryBytes -= m_lru.back().response.body.size();
+            m_index.erase(m_lru.back().url);
+            m_lru.pop_back();
+        }
+    }
+
+    // Caller holds m_mutex
+    void ResponseCache::TrimDisk() {
+        if (m_diskBytes <= m_diskBudget) return;
+
+        std::vector<std::pair<int64_t, std::wstring>> byAge;
+        byAge.reserve(m_disk.size());
+        for (const auto& entry : m_disk) byAge.emplace_back(entry.second.lastUsed, entry.first);
+        std::sort(byAge.begin(), byAge.end());
+
+        for (const auto& victim : byAge) {
+            if (m_diskBytes <= m_diskBudget) break;
+            m_diskBytes -= m_disk[victim.second].size;
+            m_disk.erase(victim.second);
+
+            DiskJob job;
+            job.path = m_directory + L"\\" + victim.second;
+            job.remove = true;
+            Enqueue(std::move(job));
+        }
+    }
+
+    // Caller holds m_mutex. Runs the job inline when the writer thread is not running.
+    void ResponseCache::Enqueue(DiskJob job) {
+        if (!m_running) {
+            if (job.remove) DeleteFileW(job.path.c_str());
+            else WriteFile(job);
+            return;
+        }
+        m_jobs.push_back(std::move(job));
+        m_cv.notify_one();
+    }
+
+    void ResponseCache::WriterThread() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;) {
+            m_cv.wait(lock, [this] { return !m_jobs.empty() || !m_running; });
+            if (m_jobs.empty()) break;
+
+            DiskJob job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+            lock.unlock();
+            if (job.remove) DeleteFileW(job.path.c_str());
+            else if (!WriteFile(job)) LogWarning("Failed to write response cache entry for " + job.url);
+            lock.lock();
+        }
+    }
+
+    // Entry file: one JSON line with the URL and validators, then the raw body
+    bool ResponseCache::ReadFile(const std::wstring& path, const std::string& url, CachedResponse& out) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in.is_open()) return false;
+
+        std::string header;
+        if (!std::getline(in, header)) return false;
+        try {
+            nlohmann::json json = nlohmann::json::parse(header);
+            if (json.value("url", "") != url) return false;
+            out.etag = json.value("etag", "");
+            out.lastModified = json.value("lastModified", "");
+            out.expires = json.value("expires", (int64_t)0);
+        } catch (const std::exception& e) {
+            LogWarning(std::string("Ignoring unreadable response cache entry: ") + e.what());
+            return false;
+        }
+        out.body.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        return true;
+    }
+
+    bool ResponseCache::WriteFile(const DiskJob& job) {
+        nlohmann::json json;
+        json["url"] = job.url;
+        json["etag"] = job.response.etag;
+        json["lastModified"] = job.response.lastModified;
+        json["expires"] = job.response.expires;
+
+        // Written beside the entry and swapped in, so a reader never sees half a file
+        std::wstring tmpPath = job.path + L".tmp";
+        {
+            std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+            if (!out.is_open()) return false;
+            out << json.dump() << '\n';
+            out.write(job.response.body.data(), (std::streamsize)job.response.body.size());
+            if (!out.good()) return false;
+        }
+        return MoveFileExW(tmpPath.c_str(), job.path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+    }
+
+}
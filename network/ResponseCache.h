@@ -0,0 +1,118 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <ctime>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+namespace network {
+
+    struct CachedResponse {
+        std::string body;
+        std::string etag;
+        std::string lastModified;
+        int64_t expires = 0; // Unix time until which the body is served without asking, 0 = always revalidate
+
+        bool HasValidator() const { return !etag.empty() || !lastModified.empty(); }
+        bool IsFresh() const { return expires > (int64_t)std::time(nullptr); }
+    };
+
+    struct CacheStats {
+        uint64_t freshHits;   // Served without touching the network
+        uint64_t revalidated; // Answered by a 304, only headers transferred
+        uint64_t misses;
+        size_t memoryBytes;
+        size_t diskBytes;
+    };
+
+    // HTTP response cache for small GETs (search results, beatmap metadata), keyed by URL.
+    // Recently used bodies stay in memory; every entry is also written to one file per
+    // URL in a cache directory so the next session can revalidate instead of refetching.
+    // Both tiers evict least recently used entries once over their byte budget.
+    class ResponseCache {
+    public:
+        static ResponseCache& Instance();
+
+        // Indexes the files already in directory and starts the writer thread
+        void Start(const std::wstring& directory, size_t memoryBudget, size_t diskBudget);
+        // Finishes pending disk writes
+        void Stop();
+
+        // Memory first, then disk; a disk hit is promoted into memory
+        bool Lookup(const std::string& url, CachedResponse& out);
+        void Store(const std::string& url, CachedResponse response);
+        // A 304 confirmed the cached body; only its freshness changes
+        void Refresh(const std::string& url, int64_t expires);
+
+        void RecordFreshHit() { m_freshHits++; }
+        void RecordRevalidated() { m_revalidated++; }
+        void RecordMiss() { m_misses++; }
+        CacheStats GetStats() const;
+
+        // Freshness from Cache-Control / Expires; returns false for no-store
+        static bool ParseFreshness(const std::string& cacheControl, const std::string& expiresHeader, int64_t& outExpires);
+
+    private:
+        ResponseCache() = default;
+        ~ResponseCache() = default;
+        ResponseCache(const ResponseCache&) = delete;
+        ResponseCache& operator=(const ResponseCache&) = delete;
+
+        struct MemoryEntry {
+            std::string url;
+            CachedResponse response;
+        };
+
+        struct DiskEntry {
+            size_t size = 0;
+            int64_t lastUsed = 0;
+        };
+
+        // Disk write (response set) or delete (response empty) for the writer thread
+        struct DiskJob {
+            std::wstring path;
+            std::string url;
+            CachedResponse response;
+            bool remove = false;
+        };
+
+        std::wstring PathFor(const std::string& url) const;
+        void InsertMemory(const std::string& url, CachedResponse response);
+        void TrimDisk();
+        void Enqueue(DiskJob job);
+        void WriterThread();
+
+        static bool ReadFile(const std::wstring& path, const std::string& url, CachedResponse& out);
+        static bool WriteFile(const DiskJob& job);
+
+        mutable std::mutex m_mutex;
+        std::wstring m_directory; // Empty until started; the cache is memory-only without it
+        size_t m_memoryBudget = 4 * 1024 * 1024;
+        size_t m_diskBudget = 0;
+
+        // Front is most recently used
+        std::list<MemoryEntry> m_lru;
+        std::unordered_map<std::string, std::list<MemoryEntry>::iterator> m_index;
+        size_t m_memoryBytes = 0;
+
+        // Keyed by file name, so misses never touch the disk
+        std::unordered_map<std::wstring, DiskEntry> m_disk;
+        size_t m_diskBytes = 0;
+
+        std::thread m_thread;
+        std::condition_variable m_cv;
+        std::deque<DiskJob> m_jobs; // Guarded by m_mutex
+        bool m_running = false;
+
+        std::atomic<uint64_t> m_freshHits{0};
+        std::atomic<uint64_t> m_revalidated{0};
+        std::atomic<uint64_t> m_misses{0};
+    };
+
+}
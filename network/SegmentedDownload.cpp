@@ -0,0 +1,445 @@
+#include "SegmentedDownload.h"
+#include "BandwidthShaper.h"
+#include "ConnectionPool.h"
+#include "NetworkEngine.h"
+#include "PartFile.h"
+#include "RateLimiter.h"
+#include "utils/logging.h"
+#include <algorithm>
+
+namespace network {
+
+    // Files smaller than this gain nothing from extra connections
+    static const int64_t kMinSegmentedSize = 4 * 1024 * 1024;
+    // A running segment is only split if both halves get at least this much
+    static const int64_t kMinSplitBytes = 1024 * 1024;
+    static const int kMaxSegmentRetries = 3;
+    // Pending ranges are written to the sidecar after this many new bytes
+    static const int64_t kCheckpointBytes = 4 * 1024 * 1024;
+
+    void SegmentedDownload::Start(const std::string& url, const std::wstring& destPath, int segments,
+                                  HttpRequest::ProgressCallback progressCb, HttpRequest::ResultCallback done,
+                                  long timeoutSeconds, CancelTokenPtr cancel, ExpectedPayload expect) {
+        std::shared_ptr<SegmentedDownload> download(
+            new SegmentedDownload(url, destPath, segments, progressCb, done, timeoutSeconds, cancel, expect));
+        download->Probe();
+    }
+
+    SegmentedDownload::SegmentedDownload(const std::string& url, const std::wstring& destPath, int segments,
+                                         HttpRequest::ProgressCallback progressCb, HttpRequest::ResultCallback done,
+                                         long timeoutSeconds, CancelTokenPtr cancel, ExpectedPayload expect)
+        : m_url(url), m_sourceUrl(url), m_destPath(destPath), m_segmentCount(segments),
+          m_progressCb(progressCb), m_done(done), m_timeoutSeconds(timeoutSeconds), m_cancel(cancel), m_expect(expect) {}
+
+    void SegmentedDownload::Probe() {
+        CURL* curl = ConnectionPool::Instance().Acquire();
+        if (!curl) {
+            FallbackToSingleStream();
+            return;
+        }
+
+        curl_easy_setopt(curl, CURLOPT_URL, m_url.c_str());
+        curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);         // HEAD request
+        curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT, 15L);
+
+        auto self = shared_from_this();
+        NetworkEngine::Instance().Submit(curl, [self](CURL* handle, CURLcode res) {
+            self->OnProbe(handle, res);
+        }, m_cancel);
+    }
+
+    void SegmentedDownload::OnProbe(CURL* handle, CURLcode res) {
+        long response_code = 0;
+        curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &response_code);
+        if (response_code != 0) {
+            ConnectionPool::Instance().RecordTransfer(handle);
+            RateLimiter::Instance().Observe(m_sourceUrl, RateLimiter::FromResponse(handle));
+        } else if (res != CURLE_OK) {
+            ConnectionPool::Instance().RecordFailure(handle, res);
+        }
+
+        curl_off_t contentLength = -1;
+        curl_easy_getinfo(handle, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &contentLength);
+
+        bool acceptsRanges = false;
+        struct curl_header* header = nullptr;
+        if (curl_easy_header(handle, "Accept-Ranges", 0, CURLH_HEADER, -1, &header) == CURLHE_OK && header) {
+            acceptsRanges = std::string(header->value).find("bytes") != std::string::npos;
+        }
+
+        if (IsCancelled()) {
+            Finish(false, "Cancelled");
+            return;
+        }
+
+        std::string etag, lastModified;
+        if (curl_easy_header(handle, "ETag", 0, CURLH_HEADER, -1, &header) == CURLHE_OK && header) {
+            etag = header->value;
+        }
+        if (curl_easy_header(handle, "Last-Modified", 0, CURLH_HEADER, -1, &header) == CURLHE_OK && header) {
+            lastModified = header->value;
+        }
+
+        // Segments go straight to the final location instead of redoing the mirror's redirect
+        char* effectiveUrl = nullptr;
+        curl_easy_getinfo(handle, CURLINFO_EFFECTIVE_URL, &effectiveUrl);
+
+        // An error page is caught by the single stream, which sees the real response body
+        char* contentType = nullptr;
+        curl_easy_getinfo(handle, CURLINFO_CONTENT_TYPE, &contentType);
+        bool suspicious = m_expect == ExpectedPayload::ZipArchive &&
+                          !CheckArchiveHeaders(contentType ? contentType : "", contentLength).empty();
+
+        if (res != CURLE_OK || response_code != 200 || !acceptsRanges || contentLength < kMinSegmentedSize || suspicious) {
+            LogDebug("Segmented download not used (HTTP " + std::to_string(response_code) +
+                     ", ranges " + (acceptsRanges ? "yes" : "no") +
+                     ", size " + std::to_string((long long)contentLength) + ")");
+            FallbackToSingleStream();
+            return;
+        }
+
+        if (effectiveUrl) m_url = effectiveUrl;
+        m_totalSize = contentLength;
+
+        m_state.url = m_sourceUrl;
+        m_state.etag = etag;
+        m_state.lastModified = lastModified;
+        m_state.totalSize = m_totalSize;
+
+        // Continue an earlier attempt if the mirror still serves the same file
+        PartFileState previous;
+        bool resume = false;
+        if (PartFile::Load(m_destPath, previous)) {
+            resume = previous.url == m_sourceUrl && previous.SameResource(etag, lastModified, m_totalSize);
+            if (resume && previous.pendingRanges.empty()) {
+                if (previous.bytesWritten > 0 && previous.bytesWritten < m_totalSize) {
+                    previous.pendingRanges.emplace_back(previous.bytesWritten, m_totalSize - 1);
+                } else {
+                    resume = false;
+                }
+            }
+            if (!resume) PartFile::Discard(m_destPath);
+        }
+
+        if (!Preallocate(resume)) {
+            m_localError = true;
+            Finish(false, "Failed to open file");
+            return;
+        }
+
+        if (resume) {
+            m_received = m_totalSize;
+            for (const auto& range : previous.pendingRanges) {
+                m_segments.push_back({this, range.first, range.second, nullptr, false, 0, m_sink->OpenStream(range.first)});
+                m_received -= range.second - range.first + 1;
+            }
+            LogInfo("Resuming segmented download: " + std::to_string((long long)m_received) + " of " +
+                    std::to_string((long long)m_totalSize) + " bytes already on disk");
+        } else {
+            int count = (std::max)(1, (std::min)(m_segmentCount, (int)(m_totalSize / kMinSplitBytes)));
+            int64_t chunk = m_totalSize / count;
+            for (int i = 0; i < count; ++i) {
+                int64_t start = i * chunk;
+                int64_t end = (i == count - 1) ? m_totalSize - 1 : start + chunk - 1;
+                m_segments.push_back({this, start, end, nullptr, false, 0, m_sink->OpenStream(start)});
+            }
+
+            LogInfo("Segmented download: " + std::to_string(count) + " segments, " +
+                    std::to_string((long long)m_totalSize) + " bytes");
+        }
+        m_lastCheckpoint = m_received;
+        SaveState();
+
+        for (auto& segment : m_segments) {
+            if (!LaunchSegment(&segment)) break;
+        }
+        // Fewer ranges than connections are left over from a resumed attempt
+        while (!m_aborted && SplitLargestSegment()) {}
+
+        if (m_activeCount == 0) {
+            Finish(false, m_error);
+        }
+    }
+
+    bool SegmentedDownload::Preallocate(bool keepExisting) {
+        // The sink reserves the full size up front so segment writes never extend the file
+        m_sink = FileSink::Open(PartFile::PartPath(m_destPath), m_totalSize, keepExisting, m_segmentCount);
+        return m_sink != nullptr;
+    }
+
+    bool SegmentedDownload::LaunchSegment(Segment* segment) {
+        CURL* curl = ConnectionPool::Instance().Acquire();
+        if (!curl) {
+            m_aborted = true;
+            m_localError = true;
+            m_error = "Failed to init curl";
+            return false;
+        }
+
+        std::string range = std::to_string((long long)segment->pos) + "-" + std::to_string((long long)segment->end);
+
+        curl_easy_setopt(curl, CURLOPT_URL, m_url.c_str());
+        curl_easy_setopt(curl, CURLOPT_RANGE, range.c_str());
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, segment);
+        curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, XferInfoCallback);
+        curl_easy_setopt(curl, CURLOPT_XFERINFODATA, segment);
+        curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+        curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT, m_timeoutSeconds);
+        curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 30L);
+        curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 1L);
+        curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, 60L);
+
+        segment->handle = curl;
+        segment->active = true;
+        m_activeCount++;
+
+        auto self = shared_from_this();
+        NetworkEngine::Instance().Submit(curl, [self, segment](CURL* handle, CURLcode res) {
+            long response_code = 0;
+            curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &response_code);
+            if (response_code != 0) {
+                ConnectionPool::Instance().RecordTransfer(handle);
+                RateLimiter::Instance().Observe(self->m_sourceUrl, RateLimiter::FromResponse(handle));
+            }
+            self->m_sink->Detach(handle);
+            self->OnSegmentDone(segment, res);
+        }, m_cancel);
+        return true;
+    }
+
+    size_t SegmentedDownload::WriteCallback(void* contents, size_t size, size_t nmemb, void* userp) {
+        Segment* segment = (Segment*)userp;
+        SegmentedDownload* owner = segment->owner;
+        size_t bytes = size * nmemb;
+
+        if (owner->m_aborted) return 0;
+
+        // A 200 here means the mirror ignored our Range header and is sending the whole file
+        long response_code = 0;
+        curl_easy_getinfo(segment->handle, CURLINFO_RESPONSE_CODE, &response_code);
+        if (response_code != 206) {
+            owner->m_rangeRejected = true;
+            owner->m_aborted = true;
+            return 0;
+        }
+
+        int64_t remaining = segment->end - segment->pos + 1;
+        size_t toWrite = (size_t)(std::min)((int64_t)bytes, (std::max)((int64_t)0, remaining));
+
+        if (toWrite > 0) {
+            if (owner->m_sink->Failed()) {
+                owner->m_aborted = true;
+                owner->m_localError = true;
+                owner->m_error = "Failed to write file";
+                return 0;
+            }
+            // Over the bandwidth limit, or every buffer is waiting on the disk;
+            // curl delivers this chunk again on resume
+            if (!BandwidthShaper::Instance().Admit(segment->handle, bytes)) return CURL_WRITEFUNC_PAUSE;
+            if (!owner->m_sink->Write(segment->stream, contents, toWrite, segment->handle)) {
+                BandwidthShaper::Instance().Refund(segment->handle, bytes);
+                return CURL_WRITEFUNC_PAUSE;
+            }
+            // Only the segment starting at byte 0 gets here, and only for its first chunk or two
+            if (owner->m_expect == ExpectedPayload::ZipArchive && segment->pos == (int64_t)owner->m_sniffer.BytesSeen() &&
+                owner->m_sniffer.GetVerdict() == ZipSignatureSniffer::Verdict::Pending &&
+                owner->m_sniffer.Feed(contents, toWrite) == ZipSignatureSniffer::Verdict::Invalid) {
+                owner->m_aborted = true;
+                owner->m_invalidPayload = true;
+                owner->m_error = "Mirror sent " + owner->m_sniffer.Describe() + " instead of an archive";
+                return 0;
+            }
+            segment->pos += toWrite;
+            owner->m_received += toWrite;
+
+            if (owner->m_received - owner->m_lastCheckpoint >= kCheckpointBytes) {
+                owner->SaveState();
+                owner->m_lastCheckpoint = owner->m_received;
+            }
+
+            if (owner->m_progressCb) {
+                owner->m_progressCb((double)owner->m_received, (double)owner->m_totalSize);
+            }
+        }
+
+        // The range was shortened by a split; stop once our part is written
+        if (toWrite < bytes) return 0;
+        return bytes;
+    }
+
+    int SegmentedDownload::XferInfoCallback(void* clientp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow) {
+        Segment* segment = (Segment*)clientp;
+        SegmentedDownload* owner = segment->owner;
+        if (!owner->m_aborted && owner->IsCancelled()) {
+            owner->m_aborted = true;
+            owner->m_error = "Cancelled";
+        }
+        return owner->m_aborted ? 1 : 0;
+    }
+
+    void SegmentedDownload::OnSegmentDone(Segment* segment, CURLcode res) {
+        segment->active = false;
+        segment->handle = nullptr;
+        m_activeCount--;
+
+        if (!m_aborted && IsCancelled()) {
+            m_aborted = true;
+            m_error = "Cancelled";
+        }
+        if (!m_aborted && NetworkEngine::Instance().IsStopping()) {
+            // Relaunching would only be refused; end here so the failure is not retried elsewhere
+            m_aborted = true;
+            m_localError = true;
+            m_error = "Network engine stopped";
+        }
+
+        bool complete = segment->pos > segment->end;
+        if (!complete && !m_aborted) {
+            if (segment->retries < kMaxSegmentRetries) {
+                segment->retries++;
+                LogDebug("Retrying segment at " + std::to_string((long long)segment->pos) +
+                         " (" + curl_easy_strerror(res) + ")");
+                if (LaunchSegment(segment)) return;
+            } else {
+                m_aborted = true;
+                m_error = (res != CURLE_OK) ? curl_easy_strerror(res) : "Segment ended early";
+            }
+        }
+
+        // Give the now idle connection part of the slowest remaining range
+        if (!m_aborted) {
+            SplitLargestSegment();
+        }
+
+        if (m_activeCount > 0) return;
+
+        if (m_rangeRejected) {
+            FallbackToSingleStream();
+            return;
+        }
+
+        bool allComplete = std::all_of(m_segments.begin(), m_segments.end(),
+                                       [](const Segment& s) { return s.pos > s.end; });
+        Finish(!m_aborted && allComplete, m_error.empty() ? "Incomplete download" : m_error);
+    }
+
+    bool SegmentedDownload::SplitLargestSegment() {
+        if (m_activeCount >= m_segmentCount) return false;
+
+        Segment* largest = nullptr;
+        int64_t largestRemaining = 0;
+        for (auto& segment : m_segments) {
+            if (!segment.active) continue;
+            int64_t remaining = segment.end - segment.pos + 1;
+            if (remaining > largestRemaining) {
+                largest = &segment;
+                largestRemaining = remaining;
+            }
+        }
+
+        if (!largest || largestRemaining < 2 * kMinSplitBytes) return false;
+
+        int64_t mid = largest->pos + largestRemaining / 2;
+        m_segments.push_back({this, mid, largest->end, nullptr, false, 0, m_sink->OpenStream(mid)});
+        largest->end = mid - 1;
+
+        LogDebug("Split segment at " + std::to_string((long long)mid));
+        return LaunchSegment(&m_segments.back());
+    }
+
+    void SegmentedDownload::SaveState() {
+        if (!m_state.HasValidator()) return;
+
+        // Ranges start at what reached the disk, not at what was received
+        m_state.pendingRanges.clear();
+        m_state.bytesWritten = m_totalSize;
+        for (const auto& segment : m_segments) {
+            int64_t durable = m_sink->DurableOffset(segment.stream);
+            if (durable <= segment.end) {
+                m_state.pendingRanges.emplace_back(durable, segment.end);
+                m_state.bytesWritten -= segment.end - durable + 1;
+            }
+        }
+        PartFile::Save(m_destPath, m_state);
+    }
+
+    void SegmentedDownload::FallbackToSingleStream() {
+        m_finished = true;
+        if (!m_sink) {
+            CurlTransport::Instance().StartDownload(m_url, m_destPath, m_progressCb, m_done, m_timeoutSeconds, 1, m_cancel, m_expect);
+            return;
+        }
+
+        auto self = shared_from_this();
+        m_sink->Close(-1, [self](bool) {
+            // Our preallocated layout is useless to a single stream
+            PartFile::Discard(self->m_destPath);
+            CurlTransport::Instance().StartDownload(self->m_url, self->m_destPath, self->m_progressCb, self->m_done,
+                                                    self->m_timeoutSeconds, 1, self->m_cancel, self->m_expect);
+        });
+    }
+
+    void SegmentedDownload::Finish(bool success, const std::string& error) {
+        if (m_finished) return;
+        m_finished = true;
+        if (!success && m_error.empty()) m_error = error;
+
+        if (!m_sink) {
+            Complete(false);
+            return;
+        }
+
+        auto self = shared_from_this();
+        m_sink->Close(-1, [self, success](bool ok) {
+            if (success && !ok) {
+                self->m_localError = true;
+                self->m_error = "Failed to write file";
+            }
+            self->Complete(success && ok);
+        });
+    }
+
+    void SegmentedDownload::Complete(bool success) {
+        std::string invalid;
+        if (success && m_expect == ExpectedPayload::ZipArchive &&
+            !ValidateZipArchive(PartFile::PartPath(m_destPath), &invalid)) {
+            success = false;
+            m_invalidPayload = true;
+            m_error = invalid;
+        }
+        if (success && !PartFile::Commit(m_destPath)) {
+            success = false;
+            m_localError = true;
+            m_error = "Failed to move file into place";
+        }
+
+        HttpResult result;
+        result.success = success;
+        result.statusCode = success ? 200 : 0;
+        if (m_sink) {
+            DiskTimings timings = m_sink->GetTimings();
+            result.networkSeconds = timings.networkSeconds;
+            result.diskSeconds = timings.diskSeconds;
+            result.diskStallSeconds = timings.stallSeconds;
+            LogInfo("Segmented download timing: network " + std::to_string(timings.networkSeconds) + " s, disk " +
+                    std::to_string(timings.diskSeconds) + " s, stalled on disk " + std::to_string(timings.stallSeconds) + " s");
+        }
+        if (!success) {
+            result.error = m_error;
+            result.cancelled = IsCancelled();
+            result.invalidPayload = m_invalidPayload;
+            result.localError = m_localError;
+            if (m_sink && m_state.HasValidator() && m_received > 0 && !m_rangeRejected && !m_invalidPayload) {
+                // Keep finished ranges so the next attempt only fetches what is missing
+                SaveState();
+            } else {
+                PartFile::Discard(m_destPath);
+            }
+        }
+        if (m_done) m_done(result);
+    }
+
+}
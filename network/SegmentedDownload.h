@@ -0,0 +1,88 @@
+#pragma once
+
+#include "DiskWriter.h"
+#include "HttpRequest.h"
+#include "PartFile.h"
+#include "PayloadCheck.h"
+#include <curl/curl.h>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+
+namespace network {
+
+    // Downloads one file over several connections using HTTP Range requests.
+    // A HEAD probe checks Accept-Ranges/Content-Length; each segment feeds its own
+    // stream of a preallocated FileSink. When a segment finishes, the segment with
+    // the most bytes left is split in two so fast connections pick up slow ones'
+    // work. Mirrors without range support fall back to a single stream.
+    // Unfinished ranges are recorded in the .part sidecar so an interrupted
+    // download only fetches what is still missing.
+    //
+    // All state is touched only from the network thread (write callbacks and
+    // completions), so no locking is needed.
+    class SegmentedDownload : public std::enable_shared_from_this<SegmentedDownload> {
+    public:
+        static void Start(const std::string& url, const std::wstring& destPath, int segments,
+                          HttpRequest::ProgressCallback progressCb, HttpRequest::ResultCallback done,
+                          long timeoutSeconds, CancelTokenPtr cancel = nullptr,
+                          ExpectedPayload expect = ExpectedPayload::Any);
+
+    private:
+        struct Segment {
+            SegmentedDownload* owner;
+            int64_t pos;       // Next byte to write
+            int64_t end;       // Last byte of the range (inclusive); may shrink when split
+            CURL* handle;
+            bool active;
+            int retries;
+            int stream;        // FileSink stream fed by this segment
+        };
+
+        SegmentedDownload(const std::string& url, const std::wstring& destPath, int segments,
+                          HttpRequest::ProgressCallback progressCb, HttpRequest::ResultCallback done,
+                          long timeoutSeconds, CancelTokenPtr cancel, ExpectedPayload expect);
+        bool IsCancelled() const { return m_cancel && m_cancel->IsCancelled(); }
+
+        void Probe();
+        void OnProbe(CURL* handle, CURLcode res);
+        bool Preallocate(bool keepExisting);
+        bool LaunchSegment(Segment* segment);
+        void OnSegmentDone(Segment* segment, CURLcode res);
+        bool SplitLargestSegment();
+        void SaveState();
+        void FallbackToSingleStream();
+        void Finish(bool success, const std::string& error);
+        void Complete(bool success);
+
+        static size_t WriteCallback(void* contents, size_t size, size_t nmemb, void* userp);
+        static int XferInfoCallback(void* clientp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow);
+
+        std::string m_url;
+        std::string m_sourceUrl; // URL as requested, before the probe follows redirects
+        std::wstring m_destPath;
+        int m_segmentCount;
+        HttpRequest::ProgressCallback m_progressCb;
+        HttpRequest::ResultCallback m_done;
+        long m_timeoutSeconds;
+        CancelTokenPtr m_cancel;
+        ExpectedPayload m_expect;
+        ZipSignatureSniffer m_sniffer; // Fed by whichever segment covers the first bytes
+
+        std::shared_ptr<FileSink> m_sink;
+        int64_t m_totalSize = 0;
+        int64_t m_received = 0;
+        int64_t m_lastCheckpoint = 0;
+        PartFileState m_state;
+        std::deque<Segment> m_segments; // deque keeps Segment addresses stable for curl userdata
+        int m_activeCount = 0;
+        bool m_aborted = false;
+        bool m_finished = false;
+        bool m_rangeRejected = false;
+        bool m_invalidPayload = false;
+        bool m_localError = false; // m_error comes from the disk or curl setup, not the server
+        std::string m_error;
+    };
+
+}
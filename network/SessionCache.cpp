@@ -0,0 +1,344 @@
+#include "SessionCache.h"
+#include "utils/logging.h"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <ctime>
+#include <fstream>
+#include <windows.h>
+
+namespace network {
+
+    // A saved address is trusted for this long after it last answered
+    static const int64_t kAddressTtlSeconds = 6 * 3600;
+    // Only the most recently used hosts are written out
+    static const size_t kMaxHosts = 32;
+    static const int kFormatVersion = 1;
+
+    SessionCache& SessionCache::Instance() {
+        static SessionCache instance;
+        return instance;
+    }
+
+    static std::string ToHex(const unsigned char* data, size_t size) {
+        static const char digits[] = "0123456789abcdef";
+        std::string hex;
+        hex.reserve(size * 2);
+        for (size_t i = 0; i < size; ++i) {
+            hex += digits[data[i] >> 4];
+            hex += digits[data[i] & 0xf];
+        }
+        return hex;
+    }
+
+    static std::string FromHex(const std::string& hex) {
+        auto value = [](char c) -> int {
+            if (c >= '0' && c <= '9') return c - '0';
+            if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+            return -1;
+        };
+        std::string data;
+        if (hex.size() % 2 != 0) return data;
+        data.reserve(hex.size() / 2);
+        for (size_t i = 0; i < hex.size(); i += 2) {
+            int high = value(hex[i]), low = value(hex[i + 1]);
+            if (high < 0 || low < 0) return std::string();
+            data += (char)((high << 4) | low);
+        }
+        return data;
+    }
+
+    // Sessions from another TLS library, or another version of it, can't be imported
+    static std::string TlsBackend() {
+        curl_version_info_data* info = curl_version_info(CURLVERSION_NOW);
+        return info && info->ssl_version ? info->ssl_version : "";
+    }
+
+    static std::string HostOfUrl(const char* text) {
+        std::string host;
+        CURLU* url = curl_url();
+        char* part = nullptr;
+        if (url && curl_url_set(url, CURLUPART_URL, text, 0) == CURLUE_OK &&
+            curl_url_get(url, CURLUPART_HOST, &part, 0) == CURLUE_OK) {
+            host = part;
+            curl_free(part);
+        }
+        curl_url_cleanup(url);
+        return host;
+    }
+
+    // "host:port" of the server a finished transfer talked to, empty if unknown
+    static std::string PeerOf(CURL* handle, std::string& outHost, long& outPort) {
+        char* effectiveUrl = nullptr;
+        curl_easy_getinfo(handle, CURLINFO_EFFECTIVE_URL, &effectiveUrl);
+        curl_easy_getinfo(handle, CURLINFO_PRIMARY_PORT, &outPort);
+        if (!effectiveUrl || outPort <= 0) return "";
+        outHost = HostOfUrl(effectiveUrl);
+        return outHost.empty() ? "" : outHost + ":" + std::to_string(outPort);
+    }
+
+    // FNV-1a of the leaf certificate, and when it expires
+    static bool ReadCertificate(CURL* handle, std::string& outFingerprint, int64_t& outExpires) {
+        struct curl_certinfo* certinfo = nullptr;
+        if (curl_easy_getinfo(handle, CURLINFO_CERTINFO, &certinfo) != CURLE_OK || !certinfo ||
+            certinfo->num_of_certs < 1) {
+            return false; // Reused or resumed connections present no certificate
+        }
+
+        uint64_t hash = 14695981039346656037ull;
+        bool found = false;
+        outExpires = 0;
+        for (curl_slist* field = certinfo->certinfo[0]; field; field = field->next) {
+            std::string line = field->data;
+            if (line.compare(0, 5, "Cert:") == 0) {
+                for (unsigned char c : line) {
+                    hash ^= c;
+                    hash *= 1099511628211ull;
+                }
+                found = true;
+            } else if (line.compare(0, 12, "Expire date:") == 0) {
+                time_t expires = curl_getdate(line.c_str() + 12, nullptr);
+                if (expires > 0) outExpires = expires;
+            }
+        }
+        if (!found) return false;
+        outFingerprint = ToHex((const unsigned char*)&hash, sizeof(hash));
+        return true;
+    }
+
+    void SessionCache::QueueResolve(const std::string& entry) {
+        m_pendingResolve.push_back(entry);
+    }
+
+    void SessionCache::Load(const std::wstring& path, CURL* handle) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_path = path;
+        }
+
+        nlohmann::json json;
+        {
+            std::ifstream in(path, std::ios::binary);
+            if (!in.is_open()) return; // First start
+            try {
+                in >> json;
+            } catch (const std::exception& e) {
+                LogWarning(std::string("Ignoring unreadable session cache: ") + e.what());
+                return;
+            }
+        }
+        if (json.value("version", 0) != kFormatVersion) return;
+
+        int64_t now = (int64_t)std::time(nullptr);
+        bool certificateExpired = false;
+        std::vector<std::string> resolve;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (const auto& entry : json.value("hosts", nlohmann::json::array())) {
+                Host host;
+                std::string name = entry.value("host", "");
+                host.port = entry.value("port", 0L);
+                host.address = entry.value("address", "");
+                host.seenAt = entry.value("seen", (int64_t)0);
+                host.certificate = entry.value("certificate", "");
+                host.certExpires = entry.value("certExpires", (int64_t)0);
+                if (name.empty() || host.port <= 0) continue;
+                if (host.certExpires > 0 && host.certExpires <= now) certificateExpired = true;
+
+                // Remembered either way so the certificate is compared against the next handshake
+                bool fresh = !host.address.empty() && now - host.seenAt < kAddressTtlSeconds;
+                if (fresh) {
+                    host.restored = true;
+                    // IPv6 addresses are bracketed in CURLOPT_RESOLVE; '+' lets the entry time out normally
+                    std::string address = host.address.find(':') != std::string::npos ? "[" + host.address + "]" : host.address;
+                    resolve.push_back("+" + name + ":" + std::to_string(host.port) + ":" + address);
+                } else {
+                    host.address.clear();
+                }
+                m_hosts[name + ":" + std::to_string(host.port)] = host;
+            }
+            for (const auto& entry : resolve) QueueResolve(entry);
+            m_restoredAddresses = resolve.size();
+        }
+
+        // Hashed session keys don't say which host they belong to, so one expired certificate drops them all
+        uint64_t imported = 0, skipped = 0;
+        if (json.value("tls", "") != TlsBackend()) {
+            LogInfo("TLS library changed, not restoring saved sessions");
+        } else if (certificateExpired) {
+            LogInfo("A mirror certificate has expired, not restoring saved sessions");
+        } else {
+            for (const auto& entry : json.value("sessions", nlohmann::json::array())) {
+                if (entry.value("validUntil", (int64_t)0) <= now) {
+                    skipped++;
+                    continue;
+                }
+                std::string key = entry.value("key", "");
+                std::string shmac = FromHex(entry.value("shmac", ""));
+                std::string data = FromHex(entry.value("data", ""));
+                if (data.empty()) continue;
+                CURLcode res = curl_easy_ssls_import(handle, key.empty() ? nullptr : key.c_str(),
+                                                     (const unsigned char*)shmac.data(), shmac.size(),
+                                                     (const unsigned char*)data.data(), data.size());
+                if (res == CURLE_NOT_BUILT_IN) break;
+                if (res == CURLE_OK) imported++;
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_restoredSessions = imported;
+        }
+        LogInfo("Session cache restored " + std::to_string(imported) + " TLS sessions (" + std::to_string(skipped) +
+                " expired) and " + std::to_string(resolve.size()) + " host addresses");
+    }
+
+    CURLcode SessionCache::ExportSession(CURL* handle, void* userptr, const char* sessionKey,
+                                         const unsigned char* shmac, size_t shmacLen,
+                                         const unsigned char* sdata, size_t sdataLen,
+                                         curl_off_t validUntil, int ietfTlsId, const char* alpn, size_t earlyDataMax) {
+        std::vector<Session>* sessions = (std::vector<Session>*)userptr;
+        if (validUntil <= (curl_off_t)std::time(nullptr)) return CURLE_OK;
+
+        Session session;
+        session.key = sessionKey ? sessionKey : "";
+        session.shmac = ToHex(shmac, shmacLen);
+        session.data = ToHex(sdata, sdataLen);
+        session.validUntil = (int64_t)validUntil;
+        sessions->push_back(std::move(session));
+        return CURLE_OK;
+    }
+
+    void SessionCache::Save(CURL* handle) {
+        std::vector<Session> sessions;
+        CURLcode res = curl_easy_ssls_export(handle, ExportSession, &sessions);
+        if (res != CURLE_OK && res != CURLE_NOT_BUILT_IN) {
+            LogWarning(std::string("Failed to export TLS sessions: ") + curl_easy_strerror(res));
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        // Every transfer is done by now, so curl no longer holds the resolve lists
+        for (curl_slist* list : m_resolveLists) curl_slist_free_all(list);
+        m_resolveLists.clear();
+        if (m_path.empty()) return;
+
+        std::vector<std::pair<std::string, Host>> hosts(m_hosts.begin(), m_hosts.end());
+        std::sort(hosts.begin(), hosts.end(), [](const auto& a, const auto& b) { return a.second.seenAt > b.second.seenAt; });
+        if (hosts.size() > kMaxHosts) hosts.resize(kMaxHosts);
+
+        nlohmann::json json;
+        json["version"] = kFormatVersion;
+        json["tls"] = TlsBackend();
+        json["hosts"] = nlohmann::json::array();
+        for (const auto& entry : hosts) {
+            const Host& host = entry.second;
+            // A restored address that never answered this session is not vouched for again
+            std::string address = host.restored ? "" : host.address;
+            json["hosts"].push_back({
+                { "host", entry.first.substr(0, entry.first.rfind(':')) },
+                { "port", host.port },
+                { "address", address },
+                { "seen", host.seenAt },
+                { "certificate", host.certificate },
+                { "certExpires", host.certExpires },
+            });
+        }
+        json["sessions"] = nlohmann::json::array();
+        for (const Session& session : sessions) {
+            json["sessions"].push_back({
+                { "key", session.key },
+                { "shmac", session.shmac },
+                { "data", session.data },
+                { "validUntil", session.validUntil },
+            });
+        }
+
+        // Written beside the file and swapped in, so a crash never leaves half of it
+        std::wstring tmpPath = m_path + L".tmp";
+        {
+            std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+            if (!out.is_open()) {
+                LogWarning("Failed to write session cache");
+                return;
+            }
+            out << json.dump();
+            if (!out.good()) return;
+        }
+        if (MoveFileExW(tmpPath.c_str(), m_path.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+            LogInfo("Session cache saved " + std::to_string(sessions.size()) + " TLS sessions and " +
+                    std::to_string(hosts.size()) + " hosts");
+        }
+    }
+
+    void SessionCache::ApplyTo(CURL* handle) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_path.empty()) return;
+        // Only new connections extract it, so reused ones pay nothing
+        curl_easy_setopt(handle, CURLOPT_CERTINFO, 1L);
+
+        // One handle carries the entries into the shared DNS cache; from there they age like any lookup
+        if (m_pendingResolve.empty()) return;
+        curl_slist* list = nullptr;
+        for (const auto& entry : m_pendingResolve) list = curl_slist_append(list, entry.c_str());
+        m_pendingResolve.clear();
+        if (!list) return;
+        m_resolveLists.push_back(list);
+        curl_easy_setopt(handle, CURLOPT_RESOLVE, list);
+    }
+
+    void SessionCache::RecordTransfer(CURL* handle) {
+        std::string name;
+        long port = 0;
+        std::string peer = PeerOf(handle, name, port);
+        if (peer.empty()) return;
+
+        char* ip = nullptr;
+        curl_easy_getinfo(handle, CURLINFO_PRIMARY_IP, &ip);
+        std::string fingerprint;
+        int64_t expires = 0;
+        bool haveCertificate = ReadCertificate(handle, fingerprint, expires);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_path.empty()) return;
+        Host& host = m_hosts[peer];
+        host.port = port;
+        if (ip && *ip) host.address = ip;
+        host.seenAt = (int64_t)std::time(nullptr);
+        host.restored = false;
+        if (haveCertificate) {
+            if (!host.certificate.empty() && host.certificate != fingerprint) {
+                LogInfo("Certificate of " + name + " changed since it was last seen");
+            }
+            host.certificate = fingerprint;
+            host.certExpires = expires;
+        }
+    }
+
+    void SessionCache::RecordConnectFailure(CURL* handle, CURLcode result) {
+        if (result != CURLE_COULDNT_CONNECT && result != CURLE_OPERATION_TIMEDOUT) return;
+
+        char* effectiveUrl = nullptr;
+        curl_easy_getinfo(handle, CURLINFO_EFFECTIVE_URL, &effectiveUrl);
+        if (!effectiveUrl) return;
+
+        // The port is unknown without a connection, so every restored entry for the host goes
+        std::string host = HostOfUrl(effectiveUrl);
+        if (host.empty()) return;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto it = m_hosts.begin(); it != m_hosts.end();) {
+            if (it->second.restored && it->first.compare(0, host.size() + 1, host + ":") == 0) {
+                LogInfo("Saved address of " + host + " did not answer, resolving it again");
+                QueueResolve("-" + it->first);
+                it = m_hosts.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    SessionCacheStats SessionCache::GetStats() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return { m_restoredSessions, m_restoredAddresses };
+    }
+
+}
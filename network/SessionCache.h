@@ -0,0 +1,84 @@
+#pragma once
+
+#include <curl/curl.h>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace network {
+
+    struct SessionCacheStats {
+        uint64_t restoredSessions;  // TLS session tickets imported at startup
+        uint64_t restoredAddresses; // Host addresses seeded into the DNS cache at startup
+    };
+
+    // Carries TLS session tickets and resolved mirror addresses over to the next
+    // time osu! starts, so the first request after launch resumes its handshake
+    // and skips the DNS lookup instead of starting cold.
+    //
+    // Tickets are dropped once expired, when the TLS library changed, or when a
+    // mirror's certificate has expired since. Addresses are kept for a few hours,
+    // enter the shared DNS cache with its normal timeout, and are forgotten as
+    // soon as a connection to one fails.
+    class SessionCache {
+    public:
+        static SessionCache& Instance();
+
+        // Reads path and imports its tickets through handle, which has to be attached
+        // to the pool's CURLSH; the addresses go out with the next request
+        void Load(const std::wstring& path, CURL* handle);
+        // Exports the shared tickets through handle and writes them with the addresses seen
+        void Save(CURL* handle);
+
+        // Called for every pooled handle: certificate info, and the pending DNS entries once
+        void ApplyTo(CURL* handle);
+        // Called after each transfer that reached the server: remembers its address and certificate
+        void RecordTransfer(CURL* handle);
+        // A restored address that no longer answers is removed from the DNS cache again
+        void RecordConnectFailure(CURL* handle, CURLcode result);
+
+        SessionCacheStats GetStats() const;
+
+    private:
+        SessionCache() = default;
+        ~SessionCache() = default;
+        SessionCache(const SessionCache&) = delete;
+        SessionCache& operator=(const SessionCache&) = delete;
+
+        struct Host {
+            long port = 0;
+            std::string address;
+            int64_t seenAt = 0;       // Unix time the address last answered
+            std::string certificate;  // Fingerprint of the leaf certificate, empty if not seen
+            int64_t certExpires = 0;  // Unix time the certificate expires, 0 if unknown
+            bool restored = false;    // Address came from the file and has not answered yet
+        };
+
+        struct Session {
+            std::string key;
+            std::string shmac;
+            std::string data;
+            int64_t validUntil = 0;
+        };
+
+        static CURLcode ExportSession(CURL* handle, void* userptr, const char* sessionKey,
+                                      const unsigned char* shmac, size_t shmacLen,
+                                      const unsigned char* sdata, size_t sdataLen,
+                                      curl_off_t validUntil, int ietfTlsId, const char* alpn, size_t earlyDataMax);
+
+        // Queues a CURLOPT_RESOLVE entry for the next handle
+        void QueueResolve(const std::string& entry);
+
+        mutable std::mutex m_mutex;
+        std::wstring m_path;
+        std::unordered_map<std::string, Host> m_hosts;
+        std::vector<std::string> m_pendingResolve;
+        // Handed to curl, which does not copy them; freed after the last transfer
+        std::vector<curl_slist*> m_resolveLists;
+        uint64_t m_restoredSessions = 0;
+        uint64_t m_restoredAddresses = 0;
+    };
+
+}
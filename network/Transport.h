@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include "CancellationToken.h"
+
+namespace network {
+
+    struct HttpResult {
+        bool success = false;
+        long statusCode = 0;
+        std::string body;        // Response body (Get)
+        std::string redirectUrl; // Location header (GetRedirectUrl)
+        std::string error;
+        int64_t resumedFrom = 0; // Bytes reused from an earlier partial download (Download)
+        double networkSeconds = 0;   // Download time spent receiving
+        double diskSeconds = 0;      // Time the disk writer spent on this file
+        double diskStallSeconds = 0; // Time the transfer was paused waiting on the disk
+        bool cancelled = false;      // Aborted through a CancellationToken
+        bool invalidPayload = false; // Body was not what the download expected (error page, truncated archive)
+        bool localError = false;     // Failed on our side (disk, curl setup); another server would fail the same way
+        bool rateLimited = false;    // 429, or held back because the host's budget is used up
+        double retryAfterSeconds = 0; // When the host accepts requests again, if it said so
+    };
+
+    // What a download must contain. Anything but Any is checked on the first bytes
+    // and on the finished file; a mismatch aborts the transfer and fails it.
+    enum class ExpectedPayload { Any, ZipArchive };
+
+    // What HttpRequest sends its requests through. CurlTransport talks to the network;
+    // FakeTransport answers in-process so downloads can be exercised without one.
+    // Callbacks run on the transport's own thread and must not block.
+    class Transport {
+    public:
+        using ProgressCallback = std::function<void(double dlNow, double dlTotal)>;
+        using ResultCallback = std::function<void(const HttpResult& result)>;
+        using DataCallback = std::function<bool(const char* data, size_t size)>;
+
+        virtual ~Transport() = default;
+
+        virtual void StartDownload(const std::string& url, const std::wstring& destPath,
+                                   ProgressCallback progressCb, ResultCallback done,
+                                   long timeoutSeconds, int segments, CancelTokenPtr cancel,
+                                   ExpectedPayload expect) = 0;
+        // A cancelled token ends the request with HttpResult::cancelled set
+        virtual void StartGet(const std::string& url, ResultCallback done, CancelTokenPtr cancel) = 0;
+        virtual void StartGetStream(const std::string& url, DataCallback onData, ResultCallback done,
+                                    CancelTokenPtr cancel) = 0;
+        virtual void StartGetRedirectUrl(const std::string& url, ResultCallback done) = 0;
+    };
+
+    // libcurl through the NetworkEngine reactor, with the connection pool,
+    // bandwidth shaper, response cache and resumable downloads
+    class CurlTransport : public Transport {
+    public:
+        static CurlTransport& Instance();
+
+        void StartDownload(const std::string& url, const std::wstring& destPath,
+                           ProgressCallback progressCb, ResultCallback done,
+                           long timeoutSeconds, int segments, CancelTokenPtr cancel,
+                           ExpectedPayload expect) override;
+        void StartGet(const std::string& url, ResultCallback done, CancelTokenPtr cancel) override;
+        void StartGetStream(const std::string& url, DataCallback onData, ResultCallback done,
+                            CancelTokenPtr cancel) override;
+        void StartGetRedirectUrl(const std::string& url, ResultCallback done) override;
+
+    private:
+        CurlTransport() = default;
+    };
+
+}
@@ -7,6 +7,8 @@
 #include "tabs/TabRegistry.h"
 #include "features/download_manager.h"
 #include <iostream>
+#include <cstdio>
+#include <algorithm>
 
 OverlayManager& OverlayManager::Instance() {
     static OverlayManager instance;
@@ -94,18 +96,25 @@ void OverlayManager::Render() {
         ImGui::End();
     }
 
-    // Non-blocking Download Popup
-    DownloadState state = GetDownloadState();
-    if (state.isDownloading) {
-        std::string filenameStr(state.filename.begin(), state.filename.end());
-        std::string text = "Downloading: " + filenameStr;
+    // Non-blocking Download Popup, summing up every download in flight
+    const DownloadSnapshot* downloads = &DownloadTable::Instance().Snapshot();
+    if (downloads->active > 0) {
+        char text[320];
+        if (downloads->active == 1) {
+            auto current = std::find_if(downloads->items.begin(), downloads->items.end(),
+                                        [](const DownloadRecord& record) { return !IsFinished(record.phase); });
+            snprintf(text, sizeof(text), "%s: %s", DownloadPhaseName(current->phase), current->name.c_str());
+        } else {
+            snprintf(text, sizeof(text), "Downloading %d beatmaps", downloads->active);
+        }
+        float progress = downloads->totalBytes > 0 ? (float)((double)downloads->downloadedBytes / downloads->totalBytes) : 0.0f;
         
         // Calculate dimensions
         float maxWidth = 500.0f;
         float paddingX = 40.0f;
         float paddingY = 45.0f; // Space for progress bar and padding
 
-        ImVec2 textSize = ImGui::CalcTextSize(text.c_str(), nullptr, false, maxWidth - paddingX);
+        ImVec2 textSize = ImGui::CalcTextSize(text, nullptr, false, maxWidth - paddingX);
         
         float windowWidth = (std::max)(300.0f, textSize.x + paddingX);
         float windowHeight = (std::max)(60.0f, textSize.y + paddingY);
@@ -119,9 +128,14 @@ void OverlayManager::Render() {
         
         if (ImGui::Begin("DownloadPopup", nullptr, flags)) {
             ImGui::PushTextWrapPos(ImGui::GetWindowWidth() - 20.0f);
-            ImGui::Text("%s", text.c_str());
+            ImGui::Text("%s", text);
             ImGui::PopTextWrapPos();
-            ImGui::ProgressBar(state.progress / 100.0f, ImVec2(-1, 0));
+            char rate[64] = "";
+            if (downloads->rateBps > 0) {
+                int len = snprintf(rate, sizeof(rate), "%.1f MB/s", downloads->rateBps / (1024.0 * 1024.0));
+                if (downloads->etaSeconds >= 0) snprintf(rate + len, sizeof(rate) - len, ", %.0f s left", downloads->etaSeconds);
+            }
+            ImGui::ProgressBar(progress, ImVec2(-1, 0), rate[0] ? rate : nullptr);
         }
         ImGui::End();
     }
@@ -136,6 +150,8 @@ void OverlayManager::Render() {
 void OverlayManager::SetVisible(bool visible) {
     if (m_Visible != visible) {
         m_Visible = visible;
+        // Opening the overlay usually precedes a search or download
+        if (visible) PrewarmConnections();
         UpdateRawInput();
     }
 }
@@ -33,6 +33,9 @@ public:
 
                 ImGui::TableSetColumnIndex(1);
                 ImGui::Text("%s", entry.status.c_str());
+                if (!entry.details.empty() && ImGui::IsItemHovered()) {
+                    ImGui::SetTooltip("%s", entry.details.c_str());
+                }
 
                 ImGui::TableSetColumnIndex(2);
                 char timeBuf[32];
@@ -0,0 +1,81 @@
+#pragma once
+#include "OverlayTab.h"
+#include "features/BulkImport.h"
+#include "imgui.h"
+#include <windows.h>
+#include <string>
+#include <cstdio>
+
+class ImportTab : public OverlayTab {
+public:
+    std::string GetName() const override { return "Import"; }
+
+    static std::string FormatEta(double seconds) {
+        char text[32];
+        if (seconds >= 3600) snprintf(text, sizeof(text), "%d h %02d min", (int)seconds / 3600, ((int)seconds / 60) % 60);
+        else if (seconds >= 60) snprintf(text, sizeof(text), "%d min %02d s", (int)seconds / 60, (int)seconds % 60);
+        else snprintf(text, sizeof(text), "%d s", (int)seconds);
+        return text;
+    }
+
+    void Render() override {
+        static char listBuf[16384] = "";
+        static char pathBuf[MAX_PATH] = "";
+
+        BulkImportStats stats = BulkImport::Instance().GetStats();
+
+        ImGui::TextWrapped("Set IDs, beatmap IDs or osu! links, separated by spaces, commas or lines; or a JSON list.");
+        ImGui::BeginDisabled(stats.running);
+        ImGui::InputTextMultiline("##list", listBuf, IM_ARRAYSIZE(listBuf), ImVec2(-1, ImGui::GetTextLineHeight() * 6));
+        if (ImGui::Button("Import List")) {
+            BulkImport::Instance().StartFromText(listBuf);
+        }
+        ImGui::SameLine();
+        // Longer lists than the box holds
+        if (ImGui::Button("Import Clipboard")) {
+            const char* clipboard = ImGui::GetClipboardText();
+            BulkImport::Instance().StartFromText(clipboard ? clipboard : "");
+        }
+
+        ImGui::InputText("File", pathBuf, IM_ARRAYSIZE(pathBuf));
+        ImGui::SameLine();
+        if (ImGui::Button("Import File")) {
+            wchar_t path[MAX_PATH] = L"";
+            MultiByteToWideChar(CP_UTF8, 0, pathBuf, -1, path, MAX_PATH);
+            BulkImport::Instance().StartFromFile(path);
+        }
+        ImGui::EndDisabled();
+
+        if (!stats.running && !stats.error.empty()) {
+            ImGui::TextDisabled("%s", stats.error.c_str());
+        }
+        if (stats.total == 0) return;
+
+        ImGui::Separator();
+        size_t toDownload = stats.total - stats.alreadyInstalled;
+        size_t finished = stats.succeeded + stats.failed;
+        ImGui::Text("%zu sets: %zu already installed, %zu to download", stats.total, stats.alreadyInstalled, toDownload);
+        if (stats.duplicates > 0) {
+            ImGui::SameLine();
+            ImGui::TextDisabled("(%zu duplicates skipped)", stats.duplicates);
+        }
+
+        char overlay[64];
+        snprintf(overlay, sizeof(overlay), "%zu / %zu", finished, toDownload);
+        ImGui::ProgressBar(toDownload > 0 ? (float)finished / toDownload : 1.0f, ImVec2(-1, 0), overlay);
+        ImGui::Text("%zu downloaded, %zu failed, %zu in the queue, %zu waiting", stats.succeeded, stats.failed, stats.inQueue, stats.waiting);
+
+        if (stats.running) {
+            if (stats.etaSeconds >= 0) {
+                ImGui::Text("About %s left", FormatEta(stats.etaSeconds).c_str());
+            } else {
+                ImGui::TextDisabled("Estimating time left...");
+            }
+            if (ImGui::Button("Cancel Import")) {
+                BulkImport::Instance().Cancel();
+            }
+        } else {
+            ImGui::TextDisabled(stats.cancelled ? "Cancelled." : "Done.");
+        }
+    }
+};
@@ -1,12 +1,14 @@
 #pragma once
 #include "OverlayTab.h"
 #include "providers/OsuDirect.h"
-#include "features/download_manager.h"
+#include "features/download_queue.h"
+#include "features/HistoryManager.h"
+#include "ResultsView.h"
 #include "imgui.h"
 #include <vector>
 #include <string>
-#include <thread>
-#include <future>
+#include <memory>
+#include <atomic>
 
 class RecommendationTab : public OverlayTab {
 public:
@@ -15,10 +17,8 @@ public:
     void Render() override {
         static float minStars = 4.0f;
         static float maxStars = 5.0f;
-        static std::vector<OsuDirectProvider::Recommendation> results;
-        static std::mutex resultsMutex;
-        static bool isSearching = false;
-        static std::string statusMessage;
+        static ResultsView<OsuDirectProvider::Recommendation> results;
+        static std::atomic<bool> isSearching{false};
 
         // Filters
         static int currentStatusIdx = 1; // Default to Ranked
@@ -46,49 +46,47 @@ public:
 
         if (ImGui::Button("Get Recommendations")) {
             isSearching = true;
-            statusMessage = "Fetching recommendations...";
-            {
-                std::lock_guard<std::mutex> lock(resultsMutex);
-                results.clear();
-            }
+            int generation = results.Begin("Fetching recommendations...");
 
             int mode = modeValues[currentModeIdx];
             int status = statusValues[currentStatusIdx];
 
-            std::thread([=]() {
-                OsuDirectProvider provider;
-                auto res = provider.GetRecommendations(minStars, maxStars, mode, status);
-                
-                {
-                    std::lock_guard<std::mutex> lock(resultsMutex);
-                    results = res;
-                }
-                
-                statusMessage = res.empty() ? "No recommendations found." : "Found " + std::to_string(res.size()) + " maps. Fetching details...";
+            // Everything below runs on the network engine; callbacks fire on the network thread
+            OsuDirectProvider provider;
+            provider.GetRecommendationsAsync(minStars, maxStars, mode, status, [generation](std::vector<OsuDirectProvider::Recommendation> res) {
+                std::string found = res.empty() ? "No recommendations found." : "Found " + std::to_string(res.size()) + " maps. Fetching details...";
+                if (!results.Publish(generation, res, found)) return;
                 isSearching = false;
 
-                // Async fetch metadata
-                for (size_t i = 0; i < res.size(); ++i) {
-                    if (res[i].parentSetId > 0) {
-                        auto setInfo = provider.GetBeatmapSetInfo(std::to_wstring(res[i].parentSetId));
+                // Fetch metadata for every result concurrently; a newer request drops these updates
+                auto rows = std::make_shared<std::vector<OsuDirectProvider::Recommendation>>(std::move(res)); // Network thread only
+                auto remaining = std::make_shared<std::atomic<size_t>>(rows->size());
+                OsuDirectProvider metadataProvider;
+                for (size_t i = 0; i < rows->size(); ++i) {
+                    int parentSetId = (*rows)[i].parentSetId;
+                    auto onInfo = [i, generation, rows, remaining, found](std::optional<BeatmapSetInfo> setInfo) {
                         if (setInfo.has_value()) {
-                            std::lock_guard<std::mutex> lock(resultsMutex);
-                            // Verify index is still valid and ID matches (in case of new search)
-                            if (i < results.size() && results[i].parentSetId == res[i].parentSetId) {
-                                results[i].artist = std::string(setInfo->artist.begin(), setInfo->artist.end());
-                                results[i].title = std::string(setInfo->title.begin(), setInfo->title.end());
-                            }
+                            (*rows)[i].artist = std::string(setInfo->artist.begin(), setInfo->artist.end());
+                            (*rows)[i].title = std::string(setInfo->title.begin(), setInfo->title.end());
                         }
+                        results.Publish(generation, *rows, --(*remaining) == 0 ? "Ready." : found);
+                    };
+
+                    if (parentSetId > 0) {
+                        metadataProvider.GetBeatmapSetInfoAsync(std::to_wstring(parentSetId), onInfo);
+                    } else {
+                        onInfo(std::nullopt);
                     }
                 }
-                statusMessage = "Ready.";
-            }).detach();
+            });
         }
 
+        // This frame's copy; the network thread publishes the next one meanwhile
+        ResultsView<OsuDirectProvider::Recommendation>::ViewPtr shown = results.Get();
         if (isSearching) {
-            ImGui::TextDisabled("%s", statusMessage.c_str());
+            ImGui::TextDisabled("%s", shown->status.c_str());
         } else {
-            ImGui::Text("%s", statusMessage.c_str());
+            ImGui::Text("%s", shown->status.c_str());
         }
 
         ImGui::Separator();
@@ -104,9 +102,8 @@ public:
                 ImGui::TableSetupColumn("Action", ImGuiTableColumnFlags_WidthFixed, 90.0f);
                 ImGui::TableHeadersRow();
 
-                std::lock_guard<std::mutex> lock(resultsMutex);
                 int i = 0;
-                for (const auto& map : results) {
+                for (const auto& map : shown->rows) {
                     ImGui::PushID(i++);
                     ImGui::TableNextRow();
                     
@@ -134,9 +131,7 @@ public:
                             // Use ParentSetID for download
                             std::wstring artistW(map.artist.begin(), map.artist.end());
                             std::wstring titleW(map.title.begin(), map.title.end());
-                            std::thread([setId, artistW, titleW]() {
-                                DownloadBeatmap(setId, false, artistW, titleW); 
-                            }).detach(); 
+                            DownloadQueue::Instance().Push(setId, false, artistW, titleW);
                         }
                     }
                     ImGui::PopID();
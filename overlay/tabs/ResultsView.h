@@ -0,0 +1,68 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// A tab's result list, built on the network thread and drawn on the render thread.
+// Each change replaces the whole view, so a frame takes the current one under a lock
+// held only for the pointer copy and draws from it without blocking the network thread.
+// Every request gets a generation; updates from a superseded one are dropped.
+template <typename Row>
+class ResultsView {
+public:
+    struct View {
+        std::vector<Row> rows;
+        std::string status;
+    };
+    using ViewPtr = std::shared_ptr<const View>;
+
+    ResultsView() : m_view(std::make_shared<View>()) {}
+
+    ViewPtr Get() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_view;
+    }
+
+    // Clears the list for a new request and returns its generation
+    int Begin(const std::string& status) {
+        ViewPtr view = Make({}, status);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_view = std::move(view);
+        return ++m_generation;
+    }
+
+    // Drops whatever the current request still sends; the list stays as it is
+    void Abandon(const std::string& status) {
+        ++m_generation;
+        ViewPtr current = Get();
+        ViewPtr view = Make(current->rows, status);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_view == current) m_view = std::move(view);
+    }
+
+    // False if a newer request has started since
+    bool Publish(int generation, std::vector<Row> rows, const std::string& status) {
+        // Built before taking the lock, so the render thread never waits for the copy
+        ViewPtr view = Make(std::move(rows), status);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (generation != m_generation) return false;
+        m_view = std::move(view);
+        return true;
+    }
+
+    bool IsCurrent(int generation) const { return generation == m_generation; }
+
+private:
+    static ViewPtr Make(std::vector<Row> rows, const std::string& status) {
+        auto view = std::make_shared<View>();
+        view->rows = std::move(rows);
+        view->status = status;
+        return view;
+    }
+
+    std::mutex m_mutex;
+    ViewPtr m_view;
+    std::atomic<int> m_generation{0};
+};
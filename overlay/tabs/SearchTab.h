@@ -2,11 +2,14 @@
 #pragma once
 #include "OverlayTab.h"
 #include "providers/ProviderRegistry.h"
-#include "features/download_manager.h"
+#include "features/download_queue.h"
+#include "ResultsView.h"
 #include "imgui.h"
 #include <vector>
 #include <string>
-#include <future>
+#include <memory>
+#include <atomic>
+#include <chrono>
 
 // Include for HistoryManager
 #include "features/HistoryManager.h"
@@ -18,9 +21,9 @@ public:
     void Render() override {
         static char queryBuf[256] = "";
         static int currentProviderIdx = 0;
-        static std::vector<BeatmapSetInfo> results;
-        static bool isSearching = false;
-        static std::string statusMessage;
+        static ResultsView<BeatmapSetInfo> results;
+        static std::atomic<bool> isSearching{false};
+        static network::CancelTokenPtr searchCancel; // Only touched on the render thread
 
         const char* providers[] = { "osu.direct", "Nerinyan", "Catboy" };
 
@@ -54,11 +57,25 @@ public:
         ImGui::InputText("Query", queryBuf, IM_ARRAYSIZE(queryBuf));
         ImGui::SameLine();
         
-        if (ImGui::Button("Search") || (ImGui::IsItemFocused() && ImGui::IsKeyPressed(ImGuiKey_Enter))) {
+        bool startSearch = ImGui::Button("Search") || (ImGui::IsItemFocused() && ImGui::IsKeyPressed(ImGuiKey_Enter));
+        if (isSearching) {
+            ImGui::SameLine();
+            if (ImGui::Button("Cancel")) {
+                // Closes the request now instead of letting it finish in the background
+                if (searchCancel) searchCancel->Cancel();
+                searchCancel.reset();
+                results.Abandon("Search cancelled.");
+                isSearching = false;
+            }
+        }
+
+        if (startSearch) {
             if (strlen(queryBuf) > 0) {
+                // A superseded search stops using the connection and bandwidth right away
+                if (searchCancel) searchCancel->Cancel();
+                searchCancel = std::make_shared<network::CancellationToken>();
                 isSearching = true;
-                statusMessage = "Searching...";
-                results.clear();
+                int generation = results.Begin("Searching...");
                 
                 std::string query = queryBuf;
                 std::string providerName = providers[currentProviderIdx];
@@ -67,26 +84,44 @@ public:
                 if (statusValues[currentStatusIdx] != -999) filter.status = statusValues[currentStatusIdx];
                 if (modeValues[currentModeIdx] != -999) filter.mode = modeValues[currentModeIdx];
 
-                // Run search in a separate thread to avoid freezing UI
-                std::thread([query, providerName, filter]() {
-                    auto provider = ProviderRegistry::Instance().CreateProvider(providerName);
-                    if (provider) {
-                        auto res = provider->Search(query, filter);
-                        // Simple thread safety for demo (should use proper synchronization in prod)
-                        results = res;
-                        statusMessage = res.empty() ? "No results found." : "Found " + std::to_string(res.size()) + " maps.";
-                    } else {
-                        statusMessage = "Provider not found.";
-                    }
+                // Runs on the network engine; decoded rows are collected here and shown in
+                // batches, at most one publish per interval, so the list isn't copied per row.
+                // A newer search starts a new generation so late rows from this one are dropped.
+                auto provider = ProviderRegistry::Instance().CreateProvider(providerName);
+                if (provider) {
+                    struct Pending {
+                        std::vector<BeatmapSetInfo> rows;
+                        std::chrono::steady_clock::time_point lastPublish;
+                    };
+                    auto pending = std::make_shared<Pending>(); // Network thread only
+                    provider->SearchStreamAsync(query, filter,
+                        [generation, pending](const BeatmapSetInfo& info) {
+                            constexpr auto kPublishInterval = std::chrono::milliseconds(100);
+                            if (!results.IsCurrent(generation)) return;
+                            pending->rows.push_back(info);
+                            auto now = std::chrono::steady_clock::now();
+                            if (now - pending->lastPublish < kPublishInterval) return;
+                            pending->lastPublish = now;
+                            results.Publish(generation, pending->rows, "Searching... (" + std::to_string(pending->rows.size()) + " so far)");
+                        },
+                        [generation](std::vector<BeatmapSetInfo> res) {
+                            std::string status = res.empty() ? "No results found." : "Found " + std::to_string(res.size()) + " maps.";
+                            if (results.Publish(generation, std::move(res), status)) isSearching = false;
+                        },
+                        searchCancel);
+                } else {
+                    results.Publish(generation, {}, "Provider not found.");
                     isSearching = false;
-                }).detach();
+                }
             }
         }
 
+        // This frame's copy; the network thread publishes the next one meanwhile
+        ResultsView<BeatmapSetInfo>::ViewPtr shown = results.Get();
         if (isSearching) {
-            ImGui::TextDisabled("%s", statusMessage.c_str());
+            ImGui::TextDisabled("%s", shown->status.c_str());
         } else {
-            ImGui::Text("%s", statusMessage.c_str());
+            ImGui::Text("%s", shown->status.c_str());
         }
 
         ImGui::Separator();
@@ -104,7 +139,7 @@ public:
                 ImGui::TableHeadersRow();
 
                 int i = 0;
-                for (const auto& map : results) {
+                for (const auto& map : shown->rows) {
                     ImGui::PushID(i++);
                     ImGui::TableNextRow();
                     
@@ -133,11 +168,7 @@ public:
                         ImGui::EndDisabled();
                     } else {
                         if (ImGui::Button("Download", ImVec2(-1, 0))) {
-                            std::wstring artist = map.artist;
-                            std::wstring title = map.title;
-                            std::thread([mapId, artist, title]() {
-                                DownloadBeatmap(mapId, false, artist, title);
-                            }).detach();
+                            DownloadQueue::Instance().Push(mapId, false, map.artist, map.title);
                         }
                     }
                     ImGui::PopID();
@@ -2,6 +2,7 @@
 #include "OverlayTab.h"
 #include "config/config_manager.h"
 #include "providers/ProviderRegistry.h"
+#include "network/HttpRequest.h"
 #include "imgui.h"
 #include <string>
 #include <vector>
@@ -15,6 +16,11 @@ public:
         static int metadataMirrorIndex = 0;
         static bool autoOpen = false;
         static bool clipboardEnabled = true;
+        static bool memoryMappedOutput = false;
+        static bool hedgedDownloads = true;
+        static int globalLimitKBps = 0;
+        static int backgroundLimitKBps = 0;
+        static int retryCount = 2;
         static bool initSettings = false;
 
         if (!initSettings) {
@@ -22,6 +28,11 @@ public:
             metadataMirrorIndex = ConfigManager::Instance().GetMetadataMirrorIndex();
             autoOpen = ConfigManager::Instance().GetAutoOpen();
             clipboardEnabled = ConfigManager::Instance().IsClipboardEnabled();
+            memoryMappedOutput = ConfigManager::Instance().GetMemoryMappedOutput();
+            hedgedDownloads = ConfigManager::Instance().GetHedgedDownloads();
+            globalLimitKBps = ConfigManager::Instance().GetGlobalLimitKBps();
+            backgroundLimitKBps = ConfigManager::Instance().GetBackgroundLimitKBps();
+            retryCount = ConfigManager::Instance().GetRetryCount();
             initSettings = true;
         }
 
@@ -36,6 +47,12 @@ public:
             ConfigManager::Instance().SetDownloadMirrorIndex(mirrorIndex);
         }
 
+        // Connections per download for the selected mirror (1 = single stream)
+        int segments = ConfigManager::Instance().GetSegmentCount(providerNames[mirrorIndex]);
+        if (ImGui::SliderInt("Connections", &segments, 1, 16)) {
+            ConfigManager::Instance().SetSegmentCount(providerNames[mirrorIndex], segments);
+        }
+
         // Filter for Metadata Mirrors (osu.direct and Catboy)
         std::vector<int> allowedMetadataIndices;
         for (size_t i = 0; i < providerNames.size(); ++i) {
@@ -80,5 +97,36 @@ public:
         if (ImGui::Checkbox("Enable Clipboard Listener", &clipboardEnabled)) {
             ConfigManager::Instance().SetClipboardEnabled(clipboardEnabled);
         }
+
+        if (ImGui::Checkbox("Memory-Mapped Downloads", &memoryMappedOutput)) {
+            ConfigManager::Instance().SetMemoryMappedOutput(memoryMappedOutput);
+            network::HttpRequest::SetMemoryMappedOutput(memoryMappedOutput);
+        }
+
+        if (ImGui::Checkbox("Race Backup Mirror When Slow", &hedgedDownloads)) {
+            ConfigManager::Instance().SetHedgedDownloads(hedgedDownloads);
+        }
+
+        // Passes over the mirrors that failed with timeouts or server errors before giving up
+        ImGui::SliderInt("Retries", &retryCount, 0, 5);
+        if (ImGui::IsItemDeactivatedAfterEdit()) {
+            ConfigManager::Instance().SetRetryCount(retryCount);
+        }
+
+        // Limits apply while dragging; the config is written once the slider is released
+        bool limitsChanged = false;
+        bool limitsReleased = false;
+        limitsChanged |= ImGui::SliderInt("Global Limit", &globalLimitKBps, 0, 100000,
+                                          globalLimitKBps == 0 ? "Unlimited" : "%d KB/s", ImGuiSliderFlags_Logarithmic);
+        limitsReleased |= ImGui::IsItemDeactivatedAfterEdit();
+        limitsChanged |= ImGui::SliderInt("Download Limit", &backgroundLimitKBps, 0, 100000,
+                                          backgroundLimitKBps == 0 ? "Unlimited" : "%d KB/s", ImGuiSliderFlags_Logarithmic);
+        limitsReleased |= ImGui::IsItemDeactivatedAfterEdit();
+        if (limitsChanged) {
+            network::HttpRequest::SetBandwidthLimits(globalLimitKBps, backgroundLimitKBps);
+        }
+        if (limitsReleased) {
+            ConfigManager::Instance().SetBandwidthLimits(globalLimitKBps, backgroundLimitKBps);
+        }
     }
 };
@@ -1,25 +1,190 @@
 #pragma once
 #include "OverlayTab.h"
 #include "features/download_manager.h"
+#include "features/download_queue.h"
+#include "features/MirrorConcurrency.h"
+#include "features/DownloadStages.h"
+#include "network/HttpRequest.h"
 #include "imgui.h"
 #include <string>
+#include <cstdio>
+#include <memory>
+#include <vector>
 
 class StatusTab : public OverlayTab {
 public:
     std::string GetName() const override { return "Status"; }
 
+    static std::string FormatEta(double seconds) {
+        char text[32];
+        if (seconds >= 60) snprintf(text, sizeof(text), "%d min %02d s", (int)seconds / 60, (int)seconds % 60);
+        else snprintf(text, sizeof(text), "%d s", (int)seconds);
+        return text;
+    }
+
+    // One line per download: name, then phase, mirror, progress, rate and ETA
+    static void RenderRecord(const DownloadRecord& record) {
+        ImGui::Separator();
+        ImGui::TextWrapped("%s", record.name.c_str());
+
+        std::string status = DownloadPhaseName(record.phase);
+        if (!record.detail.empty()) status += ": " + record.detail;
+        if (!record.mirror.empty()) status += " (" + record.mirror + ")";
+        if (IsFinished(record.phase)) {
+            ImGui::TextDisabled("%s", status.c_str());
+            return;
+        }
+        ImGui::TextDisabled("%s", status.c_str());
+
+        if (record.phase == DownloadPhase::Transferring && record.totalBytes > 0) {
+            char overlay[96];
+            int len = snprintf(overlay, sizeof(overlay), "%.1f / %.1f MB", record.downloadedBytes / (1024.0 * 1024.0),
+                               record.totalBytes / (1024.0 * 1024.0));
+            if (record.rateBps > 0) {
+                len += snprintf(overlay + len, sizeof(overlay) - len, ", %.0f KB/s", record.rateBps / 1024.0);
+            }
+            if (record.etaSeconds >= 0) {
+                snprintf(overlay + len, sizeof(overlay) - len, ", %s", FormatEta(record.etaSeconds).c_str());
+            }
+            ImGui::ProgressBar((float)((double)record.downloadedBytes / record.totalBytes), ImVec2(-1, 0), overlay);
+        }
+    }
+
+    // Every queued, running and paused item with its controls
+    static void RenderQueue() {
+        std::vector<QueueEntry> entries = DownloadQueue::Instance().GetEntries();
+        if (entries.empty()) return;
+
+        ImGui::Separator();
+        ImGui::Text("Queue");
+        static const char* priorities[] = { DownloadPriorityName(DownloadPriority::Interactive),
+                                            DownloadPriorityName(DownloadPriority::UserAction),
+                                            DownloadPriorityName(DownloadPriority::Background) };
+        for (const QueueEntry& entry : entries) {
+            ImGui::PushID((int)entry.ticket);
+            int priority = (int)entry.priority;
+            ImGui::SetNextItemWidth(110.0f);
+            if (ImGui::Combo("##priority", &priority, priorities, IM_ARRAYSIZE(priorities))) {
+                DownloadQueue::Instance().Reprioritize(entry.ticket, (DownloadPriority)priority);
+            }
+            ImGui::SameLine();
+            if (entry.paused) {
+                if (ImGui::SmallButton("Resume")) DownloadQueue::Instance().Resume(entry.ticket);
+            } else {
+                if (ImGui::SmallButton("Pause")) DownloadQueue::Instance().Pause(entry.ticket);
+            }
+            ImGui::SameLine();
+            if (ImGui::SmallButton("Cancel")) DownloadQueue::Instance().Cancel(entry.ticket);
+            ImGui::SameLine();
+            const char* state = entry.paused ? "paused" : entry.running ? "running" : "waiting";
+            ImGui::TextDisabled("%s (%s)", entry.name.c_str(), state);
+            ImGui::PopID();
+        }
+    }
+
     void Render() override {
-        DownloadState state = GetDownloadState();
-        if (state.isDownloading) {
-            std::string filenameStr(state.filename.begin(), state.filename.end());
-            ImGui::Text("Downloading: %s", filenameStr.c_str());
-            ImGui::ProgressBar(state.progress / 100.0f, ImVec2(-1, 0), 
-                std::to_string((int)state.progress).c_str());
-            ImGui::Text("%.2f MB / %.2f MB", 
-                state.downloadedBytes / (1024.0f * 1024.0f), 
-                state.totalBytes / (1024.0f * 1024.0f));
+        // One snapshot for the whole frame, so the totals and the list agree
+        const DownloadSnapshot* downloads = &DownloadTable::Instance().Snapshot();
+        if (downloads->active > 0) {
+            ImGui::Text("Downloading %d beatmap(s)", downloads->active);
+            char overlay[64];
+            snprintf(overlay, sizeof(overlay), "%.2f / %.2f MB", downloads->downloadedBytes / (1024.0 * 1024.0),
+                     downloads->totalBytes / (1024.0 * 1024.0));
+            ImGui::ProgressBar(downloads->totalBytes > 0 ? (float)((double)downloads->downloadedBytes / downloads->totalBytes) : 0.0f,
+                               ImVec2(-1, 0), overlay);
+            ImGui::Text("%.2f MB/s", downloads->rateBps / (1024.0 * 1024.0));
+            if (downloads->etaSeconds >= 0) {
+                ImGui::SameLine();
+                ImGui::Text("- %s left", FormatEta(downloads->etaSeconds).c_str());
+            }
+            if (ImGui::Button("Cancel")) {
+                DownloadQueue::Instance().CancelCurrent();
+            }
+            size_t pending = DownloadQueue::Instance().GetPendingCount();
+            size_t active = DownloadQueue::Instance().GetActiveCount();
+            if (pending > 0) {
+                ImGui::SameLine();
+                if (ImGui::Button("Clear Queue")) {
+                    DownloadQueue::Instance().CancelAll();
+                }
+            }
+            if (pending > 0 || active > 1) {
+                ImGui::SameLine();
+                ImGui::TextDisabled("%zu running, %zu more queued", active, pending);
+            }
         } else {
             ImGui::Text("Idle. Waiting for beatmap link...");
         }
+
+        for (const DownloadRecord& record : downloads->items) {
+            RenderRecord(record);
+        }
+
+        RenderQueue();
+
+        network::ConnectionStats conn = network::HttpRequest::GetConnectionStats();
+        ImGui::TextDisabled("Connections: %llu reused / %llu new (%llu requests)",
+            (unsigned long long)conn.reusedConnections,
+            (unsigned long long)conn.newConnections,
+            (unsigned long long)conn.transfers);
+
+        std::string slots;
+        for (const MirrorSlots& mirror : MirrorConcurrency::Instance().GetSlots()) {
+            slots += (slots.empty() ? "" : ", ") + mirror.mirror + " " + std::to_string(mirror.active) + "/" + std::to_string(mirror.limit);
+        }
+        if (!slots.empty()) {
+            ImGui::TextDisabled("Downloads per mirror: %s", slots.c_str());
+        }
+
+        // Per stage: slots in use, queue, throughput and smoothed time in the stage
+        for (const StageStats& stage : DownloadStages::Instance().GetStats()) {
+            if (stage.completed == 0 && stage.active == 0 && stage.waiting == 0) continue;
+            ImGui::TextDisabled("%s: %d/%d busy, %d waiting, %.0f/min, %.1f s each (%.1f s queued)",
+                PipelineStageName(stage.stage), stage.active, stage.limit, stage.waiting,
+                stage.perMinute, stage.serviceSeconds, stage.waitSeconds);
+        }
+
+        network::WarmupStats warmup = network::HttpRequest::GetWarmupStats();
+        if (warmup.warmedOrigins > 0) {
+            ImGui::TextDisabled("Pre-warmed: %llu hosts, saved %.0f ms on %llu requests",
+                (unsigned long long)warmup.warmedOrigins,
+                warmup.savedSeconds * 1000.0,
+                (unsigned long long)warmup.hits);
+        }
+
+        network::SessionCacheStats sessions = network::HttpRequest::GetSessionCacheStats();
+        if (sessions.restoredSessions + sessions.restoredAddresses > 0) {
+            ImGui::TextDisabled("Restored from last session: %llu TLS sessions, %llu host addresses",
+                (unsigned long long)sessions.restoredSessions,
+                (unsigned long long)sessions.restoredAddresses);
+        }
+
+        network::CacheStats cache = network::HttpRequest::GetCacheStats();
+        if (cache.freshHits + cache.revalidated + cache.misses > 0) {
+            ImGui::TextDisabled("Response cache: %llu fresh, %llu not modified, %llu fetched (%zu KB on disk)",
+                (unsigned long long)cache.freshHits,
+                (unsigned long long)cache.revalidated,
+                (unsigned long long)cache.misses,
+                cache.diskBytes / 1024);
+        }
+
+        for (const network::HostBudget& budget : network::HttpRequest::GetRateLimits()) {
+            char line[256];
+            int len = snprintf(line, sizeof(line), "%s: ", budget.host.c_str());
+            if (budget.blockedSeconds > 0) {
+                len += snprintf(line + len, sizeof(line) - len, "rate limited, %.0f s left", budget.blockedSeconds);
+            } else if (budget.limit >= 0) {
+                len += snprintf(line + len, sizeof(line) - len, "%lld/%lld left", (long long)budget.remaining, (long long)budget.limit);
+                if (budget.resetSeconds > 0) {
+                    len += snprintf(line + len, sizeof(line) - len, ", resets in %.0f s", budget.resetSeconds);
+                }
+            } else {
+                len += snprintf(line + len, sizeof(line) - len, "ok");
+            }
+            if (budget.heldBack > 0) {
+                snprintf(line + len, sizeof(line) - len, " (%llu held back)", (unsigned long long)budget.heldBack);
+            }
+            ImGui::TextDisabled("%s", line);
+        }
     }
 };
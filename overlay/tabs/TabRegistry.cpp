@@ -6,6 +6,7 @@
 #include "HistoryTab.h"
 #include "SearchTab.h"
 #include "RecommendationTab.h"
+#include "ImportTab.h"
 #include <memory>
 
 namespace TabRegistry {
@@ -15,6 +16,7 @@ namespace TabRegistry {
         TabManager::Instance().RegisterTab(std::make_shared<HistoryTab>());
         TabManager::Instance().RegisterTab(std::make_shared<SearchTab>());
         TabManager::Instance().RegisterTab(std::make_shared<RecommendationTab>());
+        TabManager::Instance().RegisterTab(std::make_shared<ImportTab>());
         TabManager::Instance().RegisterTab(std::make_shared<SettingsTab>());
         TabManager::Instance().RegisterTab(std::make_shared<SpeedtestTab>());
     }
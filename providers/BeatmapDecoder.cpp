@@ -0,0 +1,105 @@
+#include "BeatmapDecoder.h"
+
+BeatmapSetDecoder::BeatmapSetDecoder(const BeatmapFieldSchema& schema, RecordFn onRecord)
+    : m_schema(schema), m_onRecord(std::move(onRecord)),
+      m_parser([this](JsonStreamParser::Event event, const std::string& value) { OnEvent(event, value); }) {}
+
+bool BeatmapSetDecoder::Feed(const char* data, size_t size) {
+    return m_parser.Feed(data, size);
+}
+
+bool BeatmapSetDecoder::Finish() {
+    return m_parser.Finish();
+}
+
+BeatmapSetDecoder::Field BeatmapSetDecoder::FieldForKey(const std::string& key) const {
+    if (key == m_schema.title) return Field::Title;
+    if (key == m_schema.artist) return Field::Artist;
+    if (key == m_schema.creator) return Field::Creator;
+    if (key == m_schema.id) return Field::Id;
+    if (key == m_schema.status) return Field::Status;
+    return Field::None;
+}
+
+void BeatmapSetDecoder::BeginRecord() {
+    m_current = BeatmapSetInfo();
+    m_current.title = L"Unknown";
+    m_current.artist = L"Unknown";
+    m_current.creator = L"Unknown";
+    m_current.id = L"0";
+    m_current.status = Provider::RankedStatusName(0);
+}
+
+void BeatmapSetDecoder::SetField(const std::string& value, bool isNumber) {
+    switch (m_field) {
+        case Field::Title:
+            if (!isNumber) m_current.title = std::wstring(value.begin(), value.end());
+            break;
+        case Field::Artist:
+            if (!isNumber) m_current.artist = std::wstring(value.begin(), value.end());
+            break;
+        case Field::Creator:
+            if (!isNumber) m_current.creator = std::wstring(value.begin(), value.end());
+            break;
+        case Field::Id:
+            if (isNumber) m_current.id = std::to_wstring(std::stoll(value));
+            break;
+        case Field::Status:
+            if (isNumber) m_current.status = Provider::RankedStatusName(std::stoi(value));
+            break;
+        default:
+            break;
+    }
+}
+
+void BeatmapSetDecoder::OnEvent(JsonStreamParser::Event event, const std::string& value) {
+    using Event = JsonStreamParser::Event;
+
+    switch (event) {
+        case Event::StartObject:
+        case Event::StartArray: {
+            if (m_depth == 0) m_topIsArray = (event == Event::StartArray);
+            bool isRecord = event == Event::StartObject && m_recordDepth < 0 &&
+                            (m_depth == 0 || (m_depth == 1 && m_topIsArray));
+            m_depth++;
+            if (isRecord) {
+                BeginRecord();
+                m_recordDepth = m_depth;
+            }
+            m_field = Field::None;
+            break;
+        }
+
+        case Event::EndObject:
+        case Event::EndArray:
+            if (event == Event::EndObject && m_depth == m_recordDepth) {
+                m_recordDepth = -1;
+                m_records++;
+                BeatmapSetInfo info = std::move(m_current);
+                if (m_onRecord) m_onRecord(std::move(info));
+            }
+            m_depth--;
+            m_field = Field::None;
+            break;
+
+        case Event::Key:
+            m_field = (m_depth == m_recordDepth) ? FieldForKey(value) : Field::None;
+            break;
+
+        case Event::String:
+        case Event::Number:
+            if (m_depth == m_recordDepth && m_field != Field::None) {
+                try {
+                    SetField(value, event == Event::Number);
+                } catch (const std::exception&) {
+                    // Out-of-range or fractional number: keep the default
+                }
+            }
+            m_field = Field::None;
+            break;
+
+        case Event::Literal:
+            m_field = Field::None;
+            break;
+    }
+}
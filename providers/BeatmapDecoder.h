@@ -0,0 +1,41 @@
+#pragma once
+#include "Provider.h"
+#include "utils/JsonStream.h"
+#include <functional>
+#include <string>
+
+// Decodes BeatmapSetInfo records from response bytes as they arrive. A record is
+// the top-level object or an object directly inside the top-level array; nested
+// objects (difficulty lists and such) are skipped. Each record is delivered as
+// soon as its closing brace has been read.
+class BeatmapSetDecoder {
+public:
+    using RecordFn = std::function<void(BeatmapSetInfo info)>;
+
+    BeatmapSetDecoder(const BeatmapFieldSchema& schema, RecordFn onRecord);
+
+    bool Feed(const char* data, size_t size);
+    bool Finish();
+
+    size_t GetRecordCount() const { return m_records; }
+    const std::string& GetError() const { return m_parser.GetError(); }
+
+private:
+    enum class Field { None, Title, Artist, Creator, Id, Status };
+
+    void OnEvent(JsonStreamParser::Event event, const std::string& value);
+    Field FieldForKey(const std::string& key) const;
+    void BeginRecord();
+    void SetField(const std::string& value, bool isNumber);
+
+    const BeatmapFieldSchema& m_schema;
+    RecordFn m_onRecord;
+    JsonStreamParser m_parser;
+
+    int m_depth = 0;
+    bool m_topIsArray = false;
+    int m_recordDepth = -1; // Depth of the record's members, -1 outside a record
+    Field m_field = Field::None;
+    BeatmapSetInfo m_current;
+    size_t m_records = 0;
+};
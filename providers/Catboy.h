@@ -6,6 +6,10 @@ public:
     std::wstring ResolveBeatmapSetId(const std::wstring& id, bool isBeatmapId) override;
     std::string GetDownloadUrl(const std::wstring& id, bool isBeatmapId) override;
     std::string GetName() const override { return "Catboy"; }
-    std::vector<BeatmapSetInfo> Search(const std::string& query, const SearchFilter& filter = {}) override;
-    std::optional<BeatmapSetInfo> GetBeatmapSetInfo(const std::wstring& setId) override;
+
+protected:
+    std::string GetSearchUrl(const std::string& query, const SearchFilter& filter) const override;
+    const BeatmapFieldSchema* GetSearchSchema() const override;
+    std::string GetBeatmapSetInfoUrl(const std::wstring& setId) const override;
+    const BeatmapFieldSchema* GetBeatmapSetInfoSchema() const override;
 };
@@ -20,10 +20,10 @@ std::string NerinyanProvider::GetDownloadUrl(const std::wstring& id, bool isBeat
 }
 
 #include "../network/HttpRequest.h"
-#include <nlohmann/json.hpp>
-#include <iostream>
 
-std::vector<BeatmapSetInfo> NerinyanProvider::Search(const std::string& query, const SearchFilter& filter) {
+static const BeatmapFieldSchema kSearchSchema = { "title", "artist", "creator", "id", "ranked" };
+
+std::string NerinyanProvider::GetSearchUrl(const std::string& query, const SearchFilter& filter) const {
     std::string encodedQuery = network::HttpRequest::UrlEncode(query);
     std::string url = "https://api.nerinyan.moe/search?q=" + encodedQuery + "&ps=20";
 
@@ -34,47 +34,9 @@ std::vector<BeatmapSetInfo> NerinyanProvider::Search(const std::string& query, c
     if (filter.status.has_value()) {
         url += "&s=" + std::to_string(filter.status.value());
     }
+    return url;
+}
 
-    std::string response;
-    
-    if (network::HttpRequest::Get(url, response)) {
-        try {
-            auto json = nlohmann::json::parse(response);
-            std::vector<BeatmapSetInfo> results;
-            
-            for (const auto& item : json) {
-                BeatmapSetInfo info;
-                
-                std::string title = item.value("title", "Unknown");
-                info.title = std::wstring(title.begin(), title.end());
-                
-                std::string artist = item.value("artist", "Unknown");
-                info.artist = std::wstring(artist.begin(), artist.end());
-                
-                std::string creator = item.value("creator", "Unknown");
-                info.creator = std::wstring(creator.begin(), creator.end());
-                
-                int id = item.value("id", 0);
-                info.id = std::to_wstring(id);
-                
-                int status = item.value("ranked", 0);
-                switch (status) {
-                    case -2: info.status = "Graveyard"; break;
-                    case -1: info.status = "WIP"; break;
-                    case 0: info.status = "Pending"; break;
-                    case 1: info.status = "Ranked"; break;
-                    case 2: info.status = "Approved"; break;
-                    case 3: info.status = "Qualified"; break;
-                    case 4: info.status = "Loved"; break;
-                    default: info.status = "Unknown"; break;
-                }
-
-                results.push_back(info);
-            }
-            return results;
-        } catch (const std::exception& e) {
-            std::cerr << "JSON Parse Error: " << e.what() << std::endl;
-        }
-    }
-    return {};
+const BeatmapFieldSchema* NerinyanProvider::GetSearchSchema() const {
+    return &kSearchSchema;
 }
@@ -11,11 +11,21 @@ public:
         std::string artist;
         std::string title;
     };
+    using RecommendationCallback = std::function<void(std::vector<Recommendation> results)>;
 
     std::wstring ResolveBeatmapSetId(const std::wstring& id, bool isBeatmapId) override;
     std::string GetDownloadUrl(const std::wstring& id, bool isBeatmapId) override;
     std::string GetName() const override { return "osu.direct"; }
-    std::vector<BeatmapSetInfo> Search(const std::string& query, const SearchFilter& filter = {}) override;
-    std::optional<BeatmapSetInfo> GetBeatmapSetInfo(const std::wstring& setId) override;
     std::vector<Recommendation> GetRecommendations(float minStars, float maxStars, int mode = 0, int status = 1);
+    void GetRecommendationsAsync(float minStars, float maxStars, int mode, int status, RecommendationCallback callback);
+
+protected:
+    std::string GetSearchUrl(const std::string& query, const SearchFilter& filter) const override;
+    const BeatmapFieldSchema* GetSearchSchema() const override;
+    std::string GetBeatmapSetInfoUrl(const std::wstring& setId) const override;
+    const BeatmapFieldSchema* GetBeatmapSetInfoSchema() const override;
+
+private:
+    static std::string GetRecommendationsUrl(float minStars, float maxStars, int mode, int status);
+    static std::vector<Recommendation> ParseRecommendations(const std::string& response);
 };
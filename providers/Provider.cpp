@@ -0,0 +1,116 @@
+#include "Provider.h"
+#include "BeatmapDecoder.h"
+#include "../network/HttpRequest.h"
+#include "../network/RateLimiter.h"
+#include <iostream>
+#include <memory>
+
+std::string Provider::RankedStatusName(int status) {
+    switch (status) {
+        case -2: return "Graveyard";
+        case -1: return "WIP";
+        case 0: return "Pending";
+        case 1: return "Ranked";
+        case 2: return "Approved";
+        case 3: return "Qualified";
+        case 4: return "Loved";
+        default: return "Unknown";
+    }
+}
+
+// Records decoded before a transfer or parse error are kept
+static void FinishDecode(BeatmapSetDecoder& decoder, bool transferOk, const char* what) {
+    if (transferOk && !decoder.Finish()) {
+        std::cerr << "JSON Parse Error (" << what << "): " << decoder.GetError() << std::endl;
+    }
+}
+
+std::vector<BeatmapSetInfo> Provider::Search(const std::string& query, const SearchFilter& filter,
+                                             network::CancelTokenPtr cancel) {
+    std::string url = GetSearchUrl(query, filter);
+    const BeatmapFieldSchema* schema = GetSearchSchema();
+    if (url.empty() || !schema) return {};
+
+    std::vector<BeatmapSetInfo> results;
+    BeatmapSetDecoder decoder(*schema, [&results](BeatmapSetInfo info) {
+        results.push_back(std::move(info));
+    });
+    bool ok = network::HttpRequest::GetStream(url, [&decoder](const char* data, size_t size) {
+        return decoder.Feed(data, size);
+    }, nullptr, cancel);
+    FinishDecode(decoder, ok, "Search");
+    return results;
+}
+
+void Provider::SearchAsync(const std::string& query, const SearchFilter& filter, SearchCallback callback,
+                           network::CancelTokenPtr cancel) {
+    SearchStreamAsync(query, filter, nullptr, std::move(callback), cancel);
+}
+
+void Provider::SearchStreamAsync(const std::string& query, const SearchFilter& filter,
+                                 RecordCallback onRecord, SearchCallback done, network::CancelTokenPtr cancel) {
+    std::string url = GetSearchUrl(query, filter);
+    const BeatmapFieldSchema* schema = GetSearchSchema();
+    if (url.empty() || !schema) {
+        if (done) done({});
+        return;
+    }
+
+    // The caller's provider object may be gone by the time the response arrives,
+    // so the decoder only holds on to the static schema
+    auto results = std::make_shared<std::vector<BeatmapSetInfo>>();
+    auto decoder = std::make_shared<BeatmapSetDecoder>(*schema, [results, onRecord](BeatmapSetInfo info) {
+        if (onRecord) onRecord(info);
+        results->push_back(std::move(info));
+    });
+    network::HttpRequest::StartGetStream(url,
+        [decoder](const char* data, size_t size) { return decoder->Feed(data, size); },
+        [decoder, results, done](const network::HttpResult& result) {
+            FinishDecode(*decoder, result.success, "Search");
+            if (done) done(std::move(*results));
+        }, cancel);
+}
+
+std::chrono::milliseconds Provider::GetBeatmapSetInfoDelay(const std::wstring& setId) const {
+    std::string url = GetBeatmapSetInfoUrl(setId);
+    if (url.empty()) return std::chrono::milliseconds(0);
+    return network::RateLimiter::Instance().Delay(url);
+}
+
+std::optional<BeatmapSetInfo> Provider::GetBeatmapSetInfo(const std::wstring& setId, network::CancelTokenPtr cancel) {
+    std::string url = GetBeatmapSetInfoUrl(setId);
+    const BeatmapFieldSchema* schema = GetBeatmapSetInfoSchema();
+    if (url.empty() || !schema) return std::nullopt;
+
+    // Some mirrors wrap the set in an array; the first record is the one we want
+    std::optional<BeatmapSetInfo> info;
+    BeatmapSetDecoder decoder(*schema, [&info](BeatmapSetInfo record) {
+        if (!info) info = std::move(record);
+    });
+    bool ok = network::HttpRequest::GetStream(url, [&decoder](const char* data, size_t size) {
+        return decoder.Feed(data, size);
+    }, nullptr, cancel);
+    FinishDecode(decoder, ok, "GetBeatmapSetInfo");
+    return ok ? info : std::nullopt;
+}
+
+void Provider::GetBeatmapSetInfoAsync(const std::wstring& setId, SetInfoCallback callback,
+                                      network::CancelTokenPtr cancel) {
+    std::string url = GetBeatmapSetInfoUrl(setId);
+    const BeatmapFieldSchema* schema = GetBeatmapSetInfoSchema();
+    if (url.empty() || !schema) {
+        if (callback) callback(std::nullopt);
+        return;
+    }
+
+    auto info = std::make_shared<std::optional<BeatmapSetInfo>>();
+    auto decoder = std::make_shared<BeatmapSetDecoder>(*schema, [info](BeatmapSetInfo record) {
+        if (!*info) *info = std::move(record);
+    });
+    network::HttpRequest::StartGetStream(url,
+        [decoder](const char* data, size_t size) { return decoder->Feed(data, size); },
+        [decoder, info, callback](const network::HttpResult& result) {
+            FinishDecode(*decoder, result.success, "GetBeatmapSetInfo");
+            if (callback) callback(result.success ? std::move(*info) : std::nullopt);
+        }, cancel);
+}
@@ -1,8 +1,11 @@
 #pragma once
 #include <string>
 #include <vector>
+#include <functional>
 
 #include <optional>
+#include <chrono>
+#include "network/CancellationToken.h"
 
 struct SearchFilter {
     std::optional<int> status;
@@ -17,12 +20,53 @@ struct BeatmapSetInfo {
     std::string status;
 };
 
+// JSON keys a provider uses for each BeatmapSetInfo field
+struct BeatmapFieldSchema {
+    const char* title;
+    const char* artist;
+    const char* creator;
+    const char* id;
+    const char* status; // Integer ranked status, mapped through RankedStatusName
+};
+
 class Provider {
 public:
+    // Async callbacks run on the network thread
+    using SearchCallback = std::function<void(std::vector<BeatmapSetInfo> results)>;
+    using SetInfoCallback = std::function<void(std::optional<BeatmapSetInfo> info)>;
+    using RecordCallback = std::function<void(const BeatmapSetInfo& info)>;
+
     virtual ~Provider() = default;
     virtual std::wstring ResolveBeatmapSetId(const std::wstring& id, bool isBeatmapId) = 0;
     virtual std::string GetDownloadUrl(const std::wstring& id, bool isBeatmapId) = 0;
     virtual std::string GetName() const = 0;
-    virtual std::vector<BeatmapSetInfo> Search(const std::string& query, const SearchFilter& filter = {}) { return {}; }
-    virtual std::optional<BeatmapSetInfo> GetBeatmapSetInfo(const std::wstring& setId) { return std::nullopt; }
+
+    // Search and metadata responses are decoded while they download, using the
+    // provider's URL builder and field schema below. A cancelled token closes the
+    // request; callbacks still run, with whatever was decoded before it stopped.
+    std::vector<BeatmapSetInfo> Search(const std::string& query, const SearchFilter& filter = {},
+                                       network::CancelTokenPtr cancel = nullptr);
+    void SearchAsync(const std::string& query, const SearchFilter& filter, SearchCallback callback,
+                     network::CancelTokenPtr cancel = nullptr);
+    // onRecord fires for each result as soon as it is decoded, then done gets the full list
+    void SearchStreamAsync(const std::string& query, const SearchFilter& filter,
+                           RecordCallback onRecord, SearchCallback done,
+                           network::CancelTokenPtr cancel = nullptr);
+    std::optional<BeatmapSetInfo> GetBeatmapSetInfo(const std::wstring& setId, network::CancelTokenPtr cancel = nullptr);
+    void GetBeatmapSetInfoAsync(const std::wstring& setId, SetInfoCallback callback,
+                                network::CancelTokenPtr cancel = nullptr);
+
+    bool SupportsBeatmapSetInfo() const { return !GetBeatmapSetInfoUrl(L"1").empty() && GetBeatmapSetInfoSchema(); }
+    // Time until the metadata host stops rate limiting us, zero if a request may go out now
+    std::chrono::milliseconds GetBeatmapSetInfoDelay(const std::wstring& setId) const;
+
+    static std::string RankedStatusName(int status);
+
+protected:
+    // Empty URL or null schema means the provider does not support the endpoint.
+    // Schemas must have static storage: async requests can outlive the provider.
+    virtual std::string GetSearchUrl(const std::string& query, const SearchFilter& filter) const { return ""; }
+    virtual const BeatmapFieldSchema* GetSearchSchema() const { return nullptr; }
+    virtual std::string GetBeatmapSetInfoUrl(const std::wstring& setId) const { return ""; }
+    virtual const BeatmapFieldSchema* GetBeatmapSetInfoSchema() const { return nullptr; }
 };
@@ -5,7 +5,7 @@
 
 std::wstring Resolver::ResolveSetIdFromBeatmapId(const std::wstring& beatmapId) {
     std::string idStr(beatmapId.begin(), beatmapId.end());
-    std::string osuUrl = "https://osu.ppy.sh/b/" + idStr;
+    std::string osuUrl = GetOrigin() + "/b/" + idStr;
     std::string redirectUrl;
     std::string error;
     
@@ -6,4 +6,7 @@ public:
     // Resolves a Beatmap ID (from /b/ link) to a Beatmap Set ID (from /beatmapsets/ link)
     // Returns empty string if resolution fails or if input is not a valid ID
     static std::wstring ResolveSetIdFromBeatmapId(const std::wstring& beatmapId);
+
+    // Host the resolver talks to, for connection pre-warming
+    static std::string GetOrigin() { return "https://osu.ppy.sh"; }
 };
@@ -0,0 +1,135 @@
+// Drives downloads and mirror failover through FakeTransport, without a network.
+// Built as its own console program so the fake never ships in the DLL.
+// Exit code is the number of failed checks.
+#include "network/FakeTransport.h"
+#include "network/HttpRequest.h"
+#include "network/PartFile.h"
+#include "network/PayloadCheck.h"
+#include "features/HedgedDownload.h"
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using network::FakeNetworkProfile;
+using network::FakeResponse;
+using network::FakeTransport;
+
+static int g_failures = 0;
+
+static void Check(bool condition, const std::string& what) {
+    std::cout << (condition ? "[PASS] " : "[FAIL] ") << what << std::endl;
+    if (!condition) g_failures++;
+}
+
+static std::wstring TempPath(const std::wstring& name) {
+    std::filesystem::path path = std::filesystem::temp_directory_path() / (L"fake_harness_" + name + L".osz");
+    std::filesystem::remove(path);
+    return path.wstring();
+}
+
+static void RemoveDownload(const std::wstring& path) {
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+    std::filesystem::remove(network::PartFile::PartPath(path), ec);
+}
+
+static FakeNetworkProfile Paced(int64_t bandwidthBps) {
+    FakeNetworkProfile profile;
+    profile.latencyMs = 20;
+    profile.bandwidthBps = bandwidthBps;
+    return profile;
+}
+
+static void PlainDownload() {
+    std::wstring path = TempPath(L"plain");
+    std::string error;
+    bool ok = network::HttpRequest::Download("https://good.test/d/1", path, nullptr, &error, 30);
+    Check(ok, "plain download succeeds" + (error.empty() ? "" : " (" + error + ")"));
+    Check(ok && network::ValidateZipArchive(path), "plain download is a valid archive");
+    RemoveDownload(path);
+}
+
+static void FailoverOnServerError() {
+    std::wstring path = TempPath(L"server_error");
+    HedgeOutcome outcome = RunHedgedDownload({ { "broken", "https://broken.test/d/2" }, { "good", "https://good.test/d/2" } },
+                                             path, nullptr, 30, false);
+    Check(outcome.success && outcome.mirror == "good", "503 fails over to the next mirror");
+    Check(!outcome.attempts.empty() && outcome.attempts[0].mirror == "broken" && outcome.attempts[0].statusCode == 503,
+          "503 attempt is recorded");
+    RemoveDownload(path);
+}
+
+static void FailoverOnErrorPage() {
+    std::wstring path = TempPath(L"error_page");
+    HedgeOutcome outcome = RunHedgedDownload({ { "html", "https://html.test/d/3" }, { "good", "https://good.test/d/3" } },
+                                             path, nullptr, 30, false);
+    Check(outcome.success && outcome.mirror == "good", "error page fails over to the next mirror");
+    Check(!outcome.attempts.empty() && outcome.attempts[0].invalidPayload, "error page is reported as an invalid payload");
+    Check(outcome.success && network::ValidateZipArchive(path), "failover result is a valid archive");
+    RemoveDownload(path);
+}
+
+static void FailoverOnReset() {
+    std::wstring path = TempPath(L"reset");
+    HedgeOutcome outcome = RunHedgedDownload({ { "flaky", "https://flaky.test/d/4" }, { "good", "https://good.test/d/4" } },
+                                             path, nullptr, 30, false);
+    Check(outcome.success && outcome.mirror == "good", "dropped connection fails over to the next mirror");
+    RemoveDownload(path);
+}
+
+static void CancelStopsEveryMirror() {
+    std::wstring path = TempPath(L"cancel");
+    auto cancel = std::make_shared<network::CancellationToken>();
+    std::thread canceller([cancel] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        cancel->Cancel();
+    });
+    auto start = std::chrono::steady_clock::now();
+    HedgeOutcome outcome = RunHedgedDownload({ { "slow", "https://slow.test/d/5" }, { "good", "https://good.test/d/5" } },
+                                             path, nullptr, 30, true, cancel);
+    canceller.join();
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    Check(outcome.cancelled && !outcome.success, "cancelling stops the download");
+    Check(seconds < 5, "cancel takes effect promptly");
+    RemoveDownload(path);
+}
+
+int main() {
+    network::HttpRequest::GlobalInit();
+
+    auto fake = std::make_shared<FakeTransport>(1);
+    fake->AddBeatmapArchive("https://good.test/", 256 * 1024, Paced(4 * 1024 * 1024));
+    fake->AddBeatmapArchive("https://slow.test/", 4 * 1024 * 1024, Paced(64 * 1024));
+
+    FakeResponse broken;
+    broken.statusCode = 503;
+    fake->AddResponse("https://broken.test/", broken);
+
+    FakeResponse html;
+    html.body = "<html><body>Beatmap not found</body></html>";
+    html.contentType = "text/html";
+    fake->AddResponse("https://html.test/", html);
+
+    FakeNetworkProfile resetting = Paced(1024 * 1024);
+    resetting.resetRate = 1;
+    fake->AddBeatmapArchive("https://flaky.test/", 256 * 1024, resetting);
+
+    network::HttpRequest::SetTransport(fake);
+
+    PlainDownload();
+    FailoverOnServerError();
+    FailoverOnErrorPage();
+    FailoverOnReset();
+    CancelStopsEveryMirror();
+
+    network::HttpRequest::SetTransport(nullptr);
+    fake.reset();
+    network::HttpRequest::GlobalCleanup();
+
+    std::cout << (g_failures == 0 ? "All checks passed" : std::to_string(g_failures) + " check(s) failed") << std::endl;
+    return g_failures;
+}
@@ -0,0 +1,277 @@
+#include "JsonStream.h"
+
+// Deeper nesting than this is treated as malformed input
+static const size_t kMaxDepth = 64;
+static const std::string kNoValue;
+
+static bool IsWhitespace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static bool IsDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// JSON number grammar: -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+static bool IsJsonNumber(const std::string& text) {
+    size_t i = 0, n = text.size();
+    if (i < n && text[i] == '-') ++i;
+    if (i >= n || !IsDigit(text[i])) return false;
+    if (text[i++] != '0') {
+        while (i < n && IsDigit(text[i])) ++i;
+    }
+    if (i < n && text[i] == '.') {
+        if (++i >= n || !IsDigit(text[i])) return false;
+        while (i < n && IsDigit(text[i])) ++i;
+    }
+    if (i < n && (text[i] == 'e' || text[i] == 'E')) {
+        ++i;
+        if (i < n && (text[i] == '+' || text[i] == '-')) ++i;
+        if (i >= n || !IsDigit(text[i])) return false;
+        while (i < n && IsDigit(text[i])) ++i;
+    }
+    return i == n;
+}
+
+JsonStreamParser::JsonStreamParser(EventFn onEvent) : m_onEvent(std::move(onEvent)) {}
+
+bool JsonStreamParser::Feed(const char* data, size_t size) {
+    for (size_t i = 0; i < size && !m_failed; ++i, ++m_offset) {
+        Step(data[i]);
+    }
+    return !m_failed;
+}
+
+bool JsonStreamParser::Finish() {
+    if (m_failed) return false;
+    // A top-level number or literal has no terminator of its own
+    if ((m_state == State::Number || m_state == State::Literal) && m_stack.empty()) {
+        if (!FlushScalar()) return false;
+    }
+    if (m_state != State::Done) return Fail("Unexpected end of input");
+    return true;
+}
+
+bool JsonStreamParser::Fail(const std::string& error) {
+    if (!m_failed) {
+        m_failed = true;
+        m_error = error + " at offset " + std::to_string(m_offset);
+    }
+    return false;
+}
+
+void JsonStreamParser::EndValue() {
+    m_state = m_stack.empty() ? State::Done : State::AfterValue;
+}
+
+bool JsonStreamParser::StartValue(char c) {
+    switch (c) {
+        case '{':
+        case '[':
+            if (m_stack.size() >= kMaxDepth) return Fail("Nesting too deep");
+            m_stack.push_back(c);
+            m_onEvent(c == '{' ? Event::StartObject : Event::StartArray, kNoValue);
+            m_state = (c == '{') ? State::KeyOrEnd : State::ArrayValueOrEnd;
+            return true;
+        case '"':
+            m_buffer.clear();
+            m_isKey = false;
+            m_state = State::String;
+            return true;
+        case 't':
+        case 'f':
+        case 'n':
+            m_buffer.assign(1, c);
+            m_state = State::Literal;
+            return true;
+        default:
+            if (c == '-' || (c >= '0' && c <= '9')) {
+                m_buffer.assign(1, c);
+                m_state = State::Number;
+                return true;
+            }
+            return Fail(std::string("Unexpected character '") + c + "'");
+    }
+}
+
+bool JsonStreamParser::CloseContainer(char c) {
+    char open = (c == '}') ? '{' : '[';
+    if (m_stack.empty() || m_stack.back() != open) return Fail(std::string("Unexpected '") + c + "'");
+    m_stack.pop_back();
+    m_onEvent(c == '}' ? Event::EndObject : Event::EndArray, kNoValue);
+    EndValue();
+    return true;
+}
+
+bool JsonStreamParser::FlushScalar() {
+    if (m_state == State::Literal) {
+        if (m_buffer != "true" && m_buffer != "false" && m_buffer != "null") {
+            return Fail("Invalid literal '" + m_buffer + "'");
+        }
+        m_onEvent(Event::Literal, m_buffer);
+    } else {
+        if (!IsJsonNumber(m_buffer)) return Fail("Invalid number '" + m_buffer + "'");
+        m_onEvent(Event::Number, m_buffer);
+    }
+    EndValue();
+    return true;
+}
+
+void JsonStreamParser::AppendCodePoint(unsigned int cp) {
+    if (cp < 0x80) {
+        m_buffer += (char)cp;
+    } else if (cp < 0x800) {
+        m_buffer += (char)(0xC0 | (cp >> 6));
+        m_buffer += (char)(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        m_buffer += (char)(0xE0 | (cp >> 12));
+        m_buffer += (char)(0x80 | ((cp >> 6) & 0x3F));
+        m_buffer += (char)(0x80 | (cp & 0x3F));
+    } else {
+        m_buffer += (char)(0xF0 | (cp >> 18));
+        m_buffer += (char)(0x80 | ((cp >> 12) & 0x3F));
+        m_buffer += (char)(0x80 | ((cp >> 6) & 0x3F));
+        m_buffer += (char)(0x80 | (cp & 0x3F));
+    }
+}
+
+bool JsonStreamParser::Step(char c) {
+    switch (m_state) {
+        case State::Value:
+            if (IsWhitespace(c)) return true;
+            return StartValue(c);
+
+        case State::ArrayValueOrEnd:
+            if (IsWhitespace(c)) return true;
+            if (c == ']') return CloseContainer(c);
+            return StartValue(c);
+
+        case State::KeyOrEnd:
+        case State::Key:
+            if (IsWhitespace(c)) return true;
+            if (c == '}' && m_state == State::KeyOrEnd) return CloseContainer(c);
+            if (c != '"') return Fail("Expected object key");
+            m_buffer.clear();
+            m_isKey = true;
+            m_state = State::String;
+            return true;
+
+        case State::Colon:
+            if (IsWhitespace(c)) return true;
+            if (c != ':') return Fail("Expected ':'");
+            m_state = State::Value;
+            return true;
+
+        case State::AfterValue:
+            if (IsWhitespace(c)) return true;
+            if (c == ',') {
+                m_state = (m_stack.back() == '{') ? State::Key : State::Value;
+                return true;
+            }
+            if (c == '}' || c == ']') return CloseContainer(c);
+            return Fail("Expected ',' or end of container");
+
+        case State::String:
+            if (m_highSurrogate && c != '\\') {
+                AppendCodePoint(0xFFFD);
+                m_highSurrogate = 0;
+            }
+            if (c == '\\') {
+                m_state = State::Escape;
+            } else if (c == '"') {
+                if (m_highSurrogate) {
+                    AppendCodePoint(0xFFFD);
+                    m_highSurrogate = 0;
+                }
+                if (m_isKey) {
+                    m_onEvent(Event::Key, m_buffer);
+                    m_state = State::Colon;
+                } else {
+                    m_onEvent(Event::String, m_buffer);
+                    EndValue();
+                }
+            } else if ((unsigned char)c < 0x20) {
+                return Fail("Control character in string");
+            } else {
+                m_buffer += c;
+            }
+            return true;
+
+        case State::Escape:
+            if (c == 'u') {
+                m_unicode = 0;
+                m_unicodeDigits = 0;
+                m_state = State::Unicode;
+                return true;
+            }
+            if (m_highSurrogate) {
+                AppendCodePoint(0xFFFD);
+                m_highSurrogate = 0;
+            }
+            switch (c) {
+                case '"': m_buffer += '"'; break;
+                case '\\': m_buffer += '\\'; break;
+                case '/': m_buffer += '/'; break;
+                case 'b': m_buffer += '\b'; break;
+                case 'f': m_buffer += '\f'; break;
+                case 'n': m_buffer += '\n'; break;
+                case 'r': m_buffer += '\r'; break;
+                case 't': m_buffer += '\t'; break;
+                default: return Fail("Invalid escape");
+            }
+            m_state = State::String;
+            return true;
+
+        case State::Unicode: {
+            unsigned int digit;
+            if (c >= '0' && c <= '9') digit = c - '0';
+            else if (c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+            else return Fail("Invalid \\u escape");
+
+            m_unicode = (m_unicode << 4) | digit;
+            if (++m_unicodeDigits < 4) return true;
+
+            m_state = State::String;
+            if (m_unicode >= 0xD800 && m_unicode <= 0xDBFF) {
+                if (m_highSurrogate) AppendCodePoint(0xFFFD);
+                m_highSurrogate = m_unicode;
+            } else if (m_unicode >= 0xDC00 && m_unicode <= 0xDFFF) {
+                if (m_highSurrogate) {
+                    AppendCodePoint(0x10000 + ((m_highSurrogate - 0xD800) << 10) + (m_unicode - 0xDC00));
+                    m_highSurrogate = 0;
+                } else {
+                    AppendCodePoint(0xFFFD);
+                }
+            } else {
+                if (m_highSurrogate) {
+                    AppendCodePoint(0xFFFD);
+                    m_highSurrogate = 0;
+                }
+                AppendCodePoint(m_unicode);
+            }
+            return true;
+        }
+
+        case State::Number:
+            if ((c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-') {
+                m_buffer += c;
+                return true;
+            }
+            if (!FlushScalar()) return false;
+            return Step(c);
+
+        case State::Literal:
+            if (c >= 'a' && c <= 'z') {
+                m_buffer += c;
+                return true;
+            }
+            if (!FlushScalar()) return false;
+            return Step(c);
+
+        case State::Done:
+            if (IsWhitespace(c)) return true;
+            return Fail("Trailing data after JSON value");
+    }
+    return true;
+}
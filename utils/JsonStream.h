@@ -0,0 +1,47 @@
+#pragma once
+#include <functional>
+#include <string>
+#include <vector>
+
+// Push-style JSON tokenizer: bytes can be fed in arbitrary chunks (e.g. straight
+// from a curl write callback) and events fire as soon as each token completes,
+// without ever building a document tree.
+class JsonStreamParser {
+public:
+    enum class Event { StartObject, EndObject, StartArray, EndArray, Key, String, Number, Literal };
+    // value is the key, the unescaped string (UTF-8), the number text or true/false/null
+    using EventFn = std::function<void(Event event, const std::string& value)>;
+
+    explicit JsonStreamParser(EventFn onEvent);
+
+    // Returns false once the input is not valid JSON; later calls are ignored
+    bool Feed(const char* data, size_t size);
+    // Returns true if exactly one complete value was read
+    bool Finish();
+
+    bool Failed() const { return m_failed; }
+    const std::string& GetError() const { return m_error; }
+
+private:
+    enum class State { Value, ArrayValueOrEnd, KeyOrEnd, Key, Colon, AfterValue, String, Escape, Unicode, Number, Literal, Done };
+
+    bool Step(char c);
+    bool StartValue(char c);
+    bool CloseContainer(char c);
+    bool FlushScalar();
+    void EndValue();
+    void AppendCodePoint(unsigned int cp);
+    bool Fail(const std::string& error);
+
+    EventFn m_onEvent;
+    State m_state = State::Value;
+    std::vector<char> m_stack; // '{' or '[' for each open container
+    std::string m_buffer;
+    bool m_isKey = false;
+    unsigned int m_unicode = 0;
+    int m_unicodeDigits = 0;
+    unsigned int m_highSurrogate = 0;
+    bool m_failed = false;
+    std::string m_error;
+    size_t m_offset = 0;
+};
@@ -0,0 +1,52 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Hands immutable values from writers to a single reader thread. The reader
+// gets the latest value without taking a lock, allocating or freeing; it may
+// use it until its next Load. Writers, which the owner serializes, free the
+// values the reader has moved past.
+//
+// The reader announces what it is about to use, then checks that it is still
+// current; a writer frees nothing the reader has announced.
+template <typename T>
+class SnapshotCell {
+public:
+    explicit SnapshotCell(std::unique_ptr<const T> initial) : m_current(initial.get()) {
+        m_owned.push_back(std::move(initial));
+    }
+    SnapshotCell(const SnapshotCell&) = delete;
+    SnapshotCell& operator=(const SnapshotCell&) = delete;
+
+    // Writers only, one at a time
+    void Store(std::unique_ptr<const T> value) {
+        m_current.store(value.get());
+        m_owned.push_back(std::move(value));
+
+        const T* current = m_current.load();
+        const T* reading = m_reading.load();
+        m_owned.erase(std::remove_if(m_owned.begin(), m_owned.end(),
+                                     [&](const std::unique_ptr<const T>& owned) {
+                                         return owned.get() != current && owned.get() != reading;
+                                     }),
+                      m_owned.end());
+    }
+
+    // Reader thread only; the reference stays valid until its next Load
+    const T& Load() {
+        const T* value = m_current.load();
+        for (;;) {
+            m_reading.store(value);
+            const T* again = m_current.load();
+            if (again == value) return *value;
+            value = again;
+        }
+    }
+
+private:
+    std::atomic<const T*> m_current;
+    std::atomic<const T*> m_reading{nullptr};
+    std::vector<std::unique_ptr<const T>> m_owned; // Current, announced and not yet freed; writers only
+};
@@ -0,0 +1,24 @@
+#pragma once
+#include <windows.h>
+#include <string>
+
+// UTF-8 <-> UTF-16 for the overlay, logs and files; Windows APIs take the wide form
+inline std::string ToUtf8(const std::wstring& text) {
+    std::string utf8;
+    int len = WideCharToMultiByte(CP_UTF8, 0, text.c_str(), (int)text.size(), NULL, 0, NULL, NULL);
+    if (len > 0) {
+        utf8.resize(len);
+        WideCharToMultiByte(CP_UTF8, 0, text.c_str(), (int)text.size(), &utf8[0], len, NULL, NULL);
+    }
+    return utf8;
+}
+
+inline std::wstring FromUtf8(const std::string& text) {
+    std::wstring wide;
+    int len = MultiByteToWideChar(CP_UTF8, 0, text.c_str(), (int)text.size(), NULL, 0);
+    if (len > 0) {
+        wide.resize(len);
+        MultiByteToWideChar(CP_UTF8, 0, text.c_str(), (int)text.size(), &wide[0], len);
+    }
+    return wide;
+}